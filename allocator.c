@@ -0,0 +1,104 @@
+#include "allocator.h"
+#include "pageStorage.h"
+#include "slab.h"
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+/** The bytes malloc is assumed to spend on every block (a chunk header and rounding) */
+#define MALLOC_OVERHEAD_ESTIMATE 16
+
+static inline bool isSlabSize(size_t size) {
+    return size <= SLAB_MAX_OBJECT_SIZE;
+}
+
+static void* defaultAllocate(void* context, size_t size) {
+    (void)context;
+    if (isSlabSize(size)) {
+        return slabAlloc(size);
+    }
+    return pageStorageResize(NULL, 0, size);
+}
+
+static void defaultDeallocate(void* context, void* block, size_t size) {
+    (void)context;
+    if (isSlabSize(size)) {
+        slabFree(block, size);
+        return;
+    }
+    pageStorageFree(block, size);
+}
+
+static void* defaultReallocate(void* context, void* block, size_t old_size, size_t new_size) {
+    if (block == NULL) {
+        return defaultAllocate(context, new_size);
+    }
+    if (!isSlabSize(old_size) && !isSlabSize(new_size)) {
+        return pageStorageResize(block, old_size, new_size);
+    }
+    //moving from or into a slab - copied
+    void* new_block = defaultAllocate(context, new_size);
+    if (new_block == NULL) {
+        return NULL;
+    }
+    memcpy(new_block, block, old_size < new_size ? old_size : new_size);
+    defaultDeallocate(context, block, old_size);
+    return new_block;
+}
+
+static const Allocator default_allocator = {
+    defaultAllocate,
+    defaultReallocate,
+    defaultDeallocate,
+    NULL
+};
+
+const Allocator* allocatorGetDefault() {
+    return &default_allocator;
+}
+
+bool allocatorIsDefault(const Allocator* allocator) {
+    return allocator != NULL && allocator->allocate == defaultAllocate
+           && allocator->reallocate == defaultReallocate && allocator->deallocate == defaultDeallocate;
+}
+
+bool allocatorIsValid(const Allocator* allocator) {
+    return allocator != NULL && allocator->allocate != NULL && allocator->reallocate != NULL
+           && allocator->deallocate != NULL;
+}
+
+char* allocatorCopyString(const Allocator* allocator, const char* string) {
+    if (allocator == NULL || string == NULL) {
+        return NULL;
+    }
+    size_t size = strlen(string) + 1;
+    char* copy = allocator->allocate(allocator->context, size);
+    if (copy == NULL) {
+        return NULL;
+    }
+    return memcpy(copy, string, size);
+}
+
+void allocatorFreeString(const Allocator* allocator, char* string) {
+    if (allocator == NULL || string == NULL) {
+        return;
+    }
+    allocator->deallocate(allocator->context, string, strlen(string) + 1);
+}
+
+size_t allocatorEstimateOverhead(const Allocator* allocator, const void* block, size_t size) {
+    if (allocator == NULL || size == 0) {
+        return 0;
+    }
+    if (!allocatorIsDefault(allocator)) {
+        return MALLOC_OVERHEAD_ESTIMATE;
+    }
+    if (isSlabSize(size)) {
+        return slabGetObjectSize(size) - size;
+    }
+    size_t mapped_size = pageStorageMappedSize((void*)block, size);
+    if (mapped_size > 0) {
+        return mapped_size - size;
+    }
+    return MALLOC_OVERHEAD_ESTIMATE;
+}
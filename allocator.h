@@ -0,0 +1,91 @@
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+/**
+* Allocator
+*
+* Describes where a container (a Map or an Election, and everything they own)
+* takes its memory from. An allocator is a set of functions and a context
+* pointer which is passed to each of them, so allocations can be routed to
+* arenas, pools or accounting allocators.
+* The size of a block is passed back when it is resized or deallocated, so
+* allocators don't need to keep per-block headers.
+*
+* The default allocator serves small blocks from the slab allocator, and large
+* arrays from page storage (huge-page mappings), everything else from malloc.
+*
+* The following functions are available:
+*   allocatorGetDefault   - Returns the default allocator.
+*   allocatorIsDefault    - Checks whether an allocator is the default one.
+*   allocatorIsValid      - Checks that an allocator has all its functions.
+*   allocatorCopyString   - Allocates a copy of a string.
+*   allocatorFreeString   - Deallocates a string allocated by allocatorCopyString.
+*   allocatorEstimateOverhead - Estimates the bytes spent on a block beyond its size.
+*/
+
+/** Type for defining an allocator */
+typedef struct Allocator_t {
+    /** Returns a new block of size bytes, NULL if the allocation failed */
+    void* (*allocate)(void* context, size_t size);
+    /** Resizes a block of old_size bytes, NULL if it failed (the block is then untouched) */
+    void* (*reallocate)(void* context, void* block, size_t old_size, size_t new_size);
+    /** Deallocates a block of size bytes */
+    void (*deallocate)(void* context, void* block, size_t size);
+    /** Passed as is to each of the functions */
+    void* context;
+} Allocator;
+
+/**
+* allocatorGetDefault: Returns the default allocator.
+*/
+const Allocator* allocatorGetDefault();
+
+/**
+* allocatorIsDefault: Checks whether an allocator uses the default functions.
+*
+* @param allocator - The allocator to check.
+* @return
+* 	true - if the allocator is not NULL and uses the default functions.
+* 	false - otherwise.
+*/
+bool allocatorIsDefault(const Allocator* allocator);
+
+/**
+* allocatorIsValid: Checks that an allocator is not NULL and has all its functions.
+*/
+bool allocatorIsValid(const Allocator* allocator);
+
+/**
+* allocatorCopyString: Allocates a copy of a string with the given allocator.
+*
+* @return
+* 	NULL - if a NULL was sent or the allocation failed.
+* 	The copy otherwise. It must be deallocated with allocatorFreeString.
+*/
+char* allocatorCopyString(const Allocator* allocator, const char* string);
+
+/**
+* allocatorFreeString: Deallocates a string allocated by allocatorCopyString.
+* The string must still have the length it was copied with.
+* If the string is NULL nothing will be done.
+*/
+void allocatorFreeString(const Allocator* allocator, char* string);
+
+/**
+* allocatorEstimateOverhead: Estimates how many bytes an allocator spends on a
+* block beyond the size that was asked for. For the default allocator this is
+* the rounding of slab objects to their size class, the rounding of mappings
+* to huge pages, or a malloc header. Other allocators are assumed to cost a
+* malloc header per block.
+*
+* @param allocator - The allocator the block was taken from.
+* @param block - The block, may be NULL to estimate a block of that size in general.
+* @param size - The size the block was allocated with.
+* @return
+* 	0 if the allocator is NULL or the size is 0, the estimate otherwise.
+*/
+size_t allocatorEstimateOverhead(const Allocator* allocator, const void* block, size_t size);
+
+#endif /* ALLOCATOR_H_ */
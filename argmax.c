@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread
+#include "argmax.h"
+#include <pthread.h>
+#include <limits.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_SIMD_PATH 1
+#include <immintrin.h>
+#else
+#define HAS_SIMD_PATH 0
+#endif
+
+#define NOT_FOUND -1
+
+typedef int (*ArgmaxKernel)(const int* values, const int* keys, int count);
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+//the version picked for this cpu, and its name
+static ArgmaxKernel argmax_kernel;
+static const char* argmax_kernel_name;
+
+//the version for any cpu, one pass
+static int argmaxPortable(const int* values, const int* keys, int count) {
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (values[i] > values[best] || (values[i] == values[best] && keys != NULL && keys[i] < keys[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+#if HAS_SIMD_PATH
+//every kernel makes three passes: the largest value, the lowest key among it, and where that is
+
+__attribute__((target("sse4.1")))
+static int horizontalMax128(__m128i vector) {
+    vector = _mm_max_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(1, 0, 3, 2)));
+    vector = _mm_max_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(vector);
+}
+
+__attribute__((target("sse4.1")))
+static int horizontalMin128(__m128i vector) {
+    vector = _mm_min_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(1, 0, 3, 2)));
+    vector = _mm_min_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(vector);
+}
+
+__attribute__((target("sse4.1")))
+static int argmaxSse41(const int* values, const int* keys, int count) {
+    const int lanes = 4;
+    int whole = count - count % lanes;
+    __m128i max_vector = _mm_set1_epi32(INT_MIN);
+    for (int i = 0; i < whole; i += lanes) {
+        max_vector = _mm_max_epi32(max_vector, _mm_loadu_si128((const __m128i*)(values + i)));
+    }
+    int max_value = horizontalMax128(max_vector);
+    for (int i = whole; i < count; i++) {
+        max_value = values[i] > max_value ? values[i] : max_value;
+    }
+    max_vector = _mm_set1_epi32(max_value);
+    int min_key = INT_MAX;
+    if (keys != NULL) {
+        __m128i min_vector = _mm_set1_epi32(INT_MAX);
+        for (int i = 0; i < whole; i += lanes) {
+            __m128i is_max = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i)), max_vector);
+            __m128i key = _mm_blendv_epi8(min_vector, _mm_loadu_si128((const __m128i*)(keys + i)), is_max);
+            min_vector = _mm_min_epi32(min_vector, key);
+        }
+        min_key = horizontalMin128(min_vector);
+        for (int i = whole; i < count; i++) {
+            min_key = values[i] == max_value && keys[i] < min_key ? keys[i] : min_key;
+        }
+    }
+    __m128i key_vector = _mm_set1_epi32(min_key);
+    for (int i = 0; i < whole; i += lanes) {
+        __m128i found = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i)), max_vector);
+        if (keys != NULL) {
+            found = _mm_and_si128(found, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(keys + i)), key_vector));
+        }
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(found));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (int i = whole; i < count; i++) {
+        if (values[i] == max_value && (keys == NULL || keys[i] == min_key)) {
+            return i;
+        }
+    }
+    return NOT_FOUND; //can't get here, the largest value is somewhere
+}
+
+__attribute__((target("avx2")))
+static int argmaxAvx2(const int* values, const int* keys, int count) {
+    const int lanes = 8;
+    int whole = count - count % lanes;
+    __m256i max_vector = _mm256_set1_epi32(INT_MIN);
+    for (int i = 0; i < whole; i += lanes) {
+        max_vector = _mm256_max_epi32(max_vector, _mm256_loadu_si256((const __m256i*)(values + i)));
+    }
+    int max_value = horizontalMax128(_mm_max_epi32(_mm256_castsi256_si128(max_vector),
+                                                   _mm256_extracti128_si256(max_vector, 1)));
+    for (int i = whole; i < count; i++) {
+        max_value = values[i] > max_value ? values[i] : max_value;
+    }
+    max_vector = _mm256_set1_epi32(max_value);
+    int min_key = INT_MAX;
+    if (keys != NULL) {
+        __m256i min_vector = _mm256_set1_epi32(INT_MAX);
+        for (int i = 0; i < whole; i += lanes) {
+            __m256i is_max = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i)), max_vector);
+            __m256i key = _mm256_blendv_epi8(min_vector, _mm256_loadu_si256((const __m256i*)(keys + i)), is_max);
+            min_vector = _mm256_min_epi32(min_vector, key);
+        }
+        min_key = horizontalMin128(_mm_min_epi32(_mm256_castsi256_si128(min_vector),
+                                                 _mm256_extracti128_si256(min_vector, 1)));
+        for (int i = whole; i < count; i++) {
+            min_key = values[i] == max_value && keys[i] < min_key ? keys[i] : min_key;
+        }
+    }
+    __m256i key_vector = _mm256_set1_epi32(min_key);
+    for (int i = 0; i < whole; i += lanes) {
+        __m256i found = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i)), max_vector);
+        if (keys != NULL) {
+            found = _mm256_and_si256(found,
+                                     _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(keys + i)), key_vector));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(found));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (int i = whole; i < count; i++) {
+        if (values[i] == max_value && (keys == NULL || keys[i] == min_key)) {
+            return i;
+        }
+    }
+    return NOT_FOUND; //can't get here, the largest value is somewhere
+}
+#endif
+
+static void initialize() {
+    argmax_kernel = argmaxPortable;
+    argmax_kernel_name = "portable";
+#if HAS_SIMD_PATH
+    if (__builtin_cpu_supports("avx2")) {
+        argmax_kernel = argmaxAvx2;
+        argmax_kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        argmax_kernel = argmaxSse41;
+        argmax_kernel_name = "sse4.1";
+    }
+#endif
+}
+
+int argmaxFind(const int* values, const int* keys, int count) {
+    if (values == NULL || count <= 0) {
+        return NOT_FOUND;
+    }
+    pthread_once(&kernel_once, initialize);
+    return argmax_kernel(values, keys, count);
+}
+
+const char* argmaxGetKernelName() {
+    pthread_once(&kernel_once, initialize);
+    return argmax_kernel_name;
+}
@@ -0,0 +1,38 @@
+#ifndef ARGMAX_H_
+#define ARGMAX_H_
+
+#include <stdbool.h>
+/**
+* Argmax
+*
+* Finds the largest of an array of ints - the votes of the tribes of an area -
+* breaking ties by the lowest key (the tribe ids) or the lowest index.
+* The search runs with AVX2 or SSE4.1 when the cpu has them, picked once per
+* process, and portable C otherwise. It reads the values about twice (and the
+* keys once), so on long arrays it runs at memory speed.
+*
+* The following functions are available:
+*   argmaxFind			- Returns the index of the largest value.
+*   argmaxGetKernelName	- Returns the name of the version picked for this cpu.
+*/
+
+/**
+* argmaxFind: Returns the index of the largest value of an array. Of equal
+* values, the one with the lowest key wins, or the lowest index if keys is NULL.
+*
+* @param values - The values to search.
+* @param keys - The key of every value, or NULL.
+* @param count - The number of values (and keys).
+* @return
+* 	-1 if values is NULL or count is not positive.
+* 	The index of the largest value otherwise.
+*/
+int argmaxFind(const int* values, const int* keys, int count);
+
+/**
+* argmaxGetKernelName: Returns the name of the version of argmaxFind picked for
+* this cpu: "avx2", "sse4.1" or "portable".
+*/
+const char* argmaxGetKernelName();
+
+#endif /* ARGMAX_H_ */
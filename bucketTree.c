@@ -0,0 +1,209 @@
+#include "bucketTree.h"
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+struct BucketTreeNode_t {
+    const char* key;
+    uint32_t hash;
+    int index;
+    int height; //the height of the subtree, a leaf has height 1
+    int size; //the number of nodes in the subtree
+    struct BucketTreeNode_t* left;
+    struct BucketTreeNode_t* right;
+};
+
+//orders elements by hash first, so most comparisons never touch the keys
+static int compare(const char* key, uint32_t hash, BucketTree node) {
+    if (hash != node->hash) {
+        return hash < node->hash ? -1 : 1;
+    }
+    return strcmp(key, node->key);
+}
+
+static inline int height(BucketTree node) {
+    return node == NULL ? 0 : node->height;
+}
+
+static inline int size(BucketTree node) {
+    return node == NULL ? 0 : node->size;
+}
+
+static void update(BucketTree node) {
+    int left_height = height(node->left), right_height = height(node->right);
+    node->height = 1 + (left_height > right_height ? left_height : right_height);
+    node->size = 1 + size(node->left) + size(node->right);
+}
+
+static BucketTree rotateRight(BucketTree node) {
+    BucketTree left = node->left;
+    node->left = left->right;
+    left->right = node;
+    update(node);
+    update(left);
+    return left;
+}
+
+static BucketTree rotateLeft(BucketTree node) {
+    BucketTree right = node->right;
+    node->right = right->left;
+    right->left = node;
+    update(node);
+    update(right);
+    return right;
+}
+
+//restores the AVL balance of a node whose subtrees differ in height by at most 2
+static BucketTree rebalance(BucketTree node) {
+    update(node);
+    int balance = height(node->left) - height(node->right);
+    if (balance > 1) {
+        if (height(node->left->left) < height(node->left->right)) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        if (height(node->right->right) < height(node->right->left)) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+static BucketTree findNode(BucketTree tree, const char* key, uint32_t hash) {
+    while (tree != NULL) {
+        int comparison = compare(key, hash, tree);
+        if (comparison == 0) {
+            return tree;
+        }
+        tree = comparison < 0 ? tree->left : tree->right;
+    }
+    return NULL;
+}
+
+int bucketTreeFind(BucketTree tree, const char* key, uint32_t hash) {
+    BucketTree node = findNode(tree, key, hash);
+    return node == NULL ? BUCKET_TREE_NOT_FOUND : node->index;
+}
+
+static BucketTree insertNode(BucketTree tree, BucketTree node) {
+    if (tree == NULL) {
+        return node;
+    }
+    if (compare(node->key, node->hash, tree) < 0) {
+        tree->left = insertNode(tree->left, node);
+    } else {
+        tree->right = insertNode(tree->right, node);
+    }
+    return rebalance(tree);
+}
+
+bool bucketTreeInsert(BucketTree* tree, const char* key, uint32_t hash, int index,
+                      const Allocator* allocator) {
+    assert(tree != NULL && key != NULL && allocator != NULL);
+    BucketTree node = bucketTreeCreateNode(allocator);
+    if (node == NULL) {
+        return false;
+    }
+    bucketTreeInsertNode(tree, node, key, hash, index);
+    return true;
+}
+
+BucketTree bucketTreeCreateNode(const Allocator* allocator) {
+    assert(allocator != NULL);
+    BucketTree node = allocator->allocate(allocator->context, sizeof(*node));
+    if (node != NULL) { //no children, so bucketTreeDestroy can deallocate it unused
+        node->left = NULL;
+        node->right = NULL;
+    }
+    return node;
+}
+
+void bucketTreeInsertNode(BucketTree* tree, BucketTree node, const char* key, uint32_t hash, int index) {
+    assert(tree != NULL && node != NULL && key != NULL);
+    node->key = key;
+    node->hash = hash;
+    node->index = index;
+    node->height = 1;
+    node->size = 1;
+    node->left = NULL;
+    node->right = NULL;
+    *tree = insertNode(*tree, node);
+}
+
+//detaches the leftmost node of a subtree into *minimum, returns the remaining subtree
+static BucketTree detachMinimum(BucketTree tree, BucketTree* minimum) {
+    if (tree->left == NULL) {
+        *minimum = tree;
+        return tree->right;
+    }
+    tree->left = detachMinimum(tree->left, minimum);
+    return rebalance(tree);
+}
+
+static BucketTree removeNode(BucketTree tree, const char* key, uint32_t hash, const Allocator* allocator) {
+    if (tree == NULL) {
+        return NULL;
+    }
+    int comparison = compare(key, hash, tree);
+    if (comparison < 0) {
+        tree->left = removeNode(tree->left, key, hash, allocator);
+        return rebalance(tree);
+    }
+    if (comparison > 0) {
+        tree->right = removeNode(tree->right, key, hash, allocator);
+        return rebalance(tree);
+    }
+    BucketTree replacement = NULL;
+    if (tree->left == NULL || tree->right == NULL) {
+        replacement = tree->left != NULL ? tree->left : tree->right;
+    } else { //the successor takes the place of the removed node
+        BucketTree rest = detachMinimum(tree->right, &replacement);
+        replacement->left = tree->left;
+        replacement->right = rest;
+        replacement = rebalance(replacement);
+    }
+    allocator->deallocate(allocator->context, tree, sizeof(*tree));
+    return replacement;
+}
+
+void bucketTreeRemove(BucketTree* tree, const char* key, uint32_t hash, const Allocator* allocator) {
+    assert(tree != NULL && key != NULL && allocator != NULL);
+    *tree = removeNode(*tree, key, hash, allocator);
+}
+
+void bucketTreeSetIndex(BucketTree tree, const char* key, uint32_t hash, int index) {
+    BucketTree node = findNode(tree, key, hash);
+    assert(node != NULL);
+    if (node != NULL) {
+        node->index = index;
+    }
+}
+
+int bucketTreeGetSize(BucketTree tree) {
+    return size(tree);
+}
+
+void bucketTreeForEach(BucketTree tree, void (*function)(int index, void* context), void* context) {
+    if (tree == NULL) {
+        return;
+    }
+    bucketTreeForEach(tree->left, function, context);
+    function(tree->index, context);
+    bucketTreeForEach(tree->right, function, context);
+}
+
+void bucketTreeDestroy(BucketTree tree, const Allocator* allocator) {
+    if (tree == NULL) {
+        return;
+    }
+    bucketTreeDestroy(tree->left, allocator);
+    bucketTreeDestroy(tree->right, allocator);
+    allocator->deallocate(allocator->context, tree, sizeof(*tree));
+}
+
+size_t bucketTreeGetNodeSize() {
+    return sizeof(struct BucketTreeNode_t);
+}
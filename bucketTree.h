@@ -0,0 +1,136 @@
+#ifndef BUCKET_TREE_H_
+#define BUCKET_TREE_H_
+
+#include "allocator.h"
+#include <stdbool.h>
+#include <stdint.h>
+/**
+* Bucket tree
+*
+* Implements a balanced (AVL) search tree over the elements of one bucket of
+* the map. The map falls back to a tree when the collision chain of a bucket
+* grows too long, so a lookup in that bucket takes O(log n) even when an
+* adversary manages to send many keys with colliding hashes.
+* The nodes are ordered by hash and then by key (using strcmp), and hold the
+* index of their element in the map. The tree doesn't own the keys.
+* Every function that allocates or deallocates nodes gets the allocator of the
+* map the tree belongs to.
+*
+* The following functions are available:
+*   bucketTreeFind      - Returns the index of the element with a given key.
+*   bucketTreeInsert    - Adds an element to the tree.
+*   bucketTreeCreateNode - Allocates a node for a later insertion that must not fail.
+*   bucketTreeInsertNode - Adds an element to the tree in a node allocated before.
+*   bucketTreeRemove    - Removes an element from the tree.
+*   bucketTreeSetIndex  - Updates the index of an element which was moved.
+*   bucketTreeGetSize   - Returns the number of elements in the tree.
+*   bucketTreeForEach   - Calls a function on the index of every element.
+*   bucketTreeDestroy   - Deallocates all the nodes of a tree.
+*   bucketTreeGetNodeSize - Returns the size of a node.
+*/
+
+/** Type for defining the tree, an empty tree is NULL */
+typedef struct BucketTreeNode_t* BucketTree;
+
+/** The value returned when an element is not in the tree */
+#define BUCKET_TREE_NOT_FOUND -1
+
+/**
+* bucketTreeFind: Searches the tree for an element.
+*
+* @param tree - The tree to search.
+* @param key - The key of the element.
+* @param hash - The hash of the key.
+* @return
+* 	BUCKET_TREE_NOT_FOUND if the key is not in the tree.
+* 	The index of the element otherwise.
+*/
+int bucketTreeFind(BucketTree tree, const char* key, uint32_t hash);
+
+/**
+* bucketTreeInsert: Adds an element, whose key must not be in the tree yet.
+*
+* @param tree - A pointer to the tree, updated to the new root.
+* @param key - The key of the element, must stay valid while it is in the tree.
+* @param hash - The hash of the key.
+* @param index - The index of the element in the map.
+* @param allocator - The allocator to take the node from.
+* @return
+* 	false if allocations failed, in that case the tree is left as it was.
+* 	true otherwise.
+*/
+bool bucketTreeInsert(BucketTree* tree, const char* key, uint32_t hash, int index,
+                      const Allocator* allocator);
+
+/**
+* bucketTreeCreateNode: Allocates a node ahead of an insertion, for a caller that
+* can't let the insertion fail once it starts. A node that ends up unused is
+* deallocated with bucketTreeDestroy.
+*
+* @param allocator - The allocator of the tree.
+* @return
+* 	NULL if allocations failed.
+* 	The node otherwise.
+*/
+BucketTree bucketTreeCreateNode(const Allocator* allocator);
+
+/**
+* bucketTreeInsertNode: Adds an element, whose key must not be in the tree yet, in
+* a node returned by bucketTreeCreateNode. Never fails.
+*
+* @param tree - A pointer to the tree, updated to the new root.
+* @param node - The node to hold the element, owned by the tree from now on.
+* @param key - The key of the element, must stay valid while it is in the tree.
+* @param hash - The hash of the key.
+* @param index - The index of the element in the map.
+*/
+void bucketTreeInsertNode(BucketTree* tree, BucketTree node, const char* key, uint32_t hash, int index);
+
+/**
+* bucketTreeRemove: Removes an element from the tree. If it is not there nothing will be done.
+*
+* @param tree - A pointer to the tree, updated to the new root.
+* @param key - The key of the element.
+* @param hash - The hash of the key.
+* @param allocator - The allocator of the tree.
+*/
+void bucketTreeRemove(BucketTree* tree, const char* key, uint32_t hash, const Allocator* allocator);
+
+/**
+* bucketTreeSetIndex: Updates the index of an element, after the map moved it.
+*
+* @param tree - The tree which holds the element.
+* @param key - The key of the element.
+* @param hash - The hash of the key.
+* @param index - The new index of the element.
+*/
+void bucketTreeSetIndex(BucketTree tree, const char* key, uint32_t hash, int index);
+
+/**
+* bucketTreeGetSize: Returns the number of elements in the tree (0 for an empty tree).
+*/
+int bucketTreeGetSize(BucketTree tree);
+
+/**
+* bucketTreeForEach: Calls a function on the index of every element of the tree.
+*
+* @param tree - The tree to go over.
+* @param function - The function to call.
+* @param context - Passed as is to every call of the function.
+*/
+void bucketTreeForEach(BucketTree tree, void (*function)(int index, void* context), void* context);
+
+/**
+* bucketTreeDestroy: Deallocates all the nodes of a tree.
+*
+* @param tree - The tree to deallocate. If NULL nothing will be done.
+* @param allocator - The allocator of the tree.
+*/
+void bucketTreeDestroy(BucketTree tree, const Allocator* allocator);
+
+/**
+* bucketTreeGetNodeSize: Returns the number of bytes allocated for every element of a tree.
+*/
+size_t bucketTreeGetNodeSize();
+
+#endif /* BUCKET_TREE_H_ */
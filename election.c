@@ -1,45 +1,46 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread rwlocks
 #include "election.h"
-#include "mapIdList.h"
+#include "idTable.h"
+#include "voteMatrix.h"
+#include "threadPool.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include "keyValue.h"
 #include <assert.h>
+#include <limits.h>
 #include "utils.h"
 #define LOWER_CASE_A 'a'
 #define LOWER_CASE_Z 'z'
 #define SPACE ' '
 #define ELEMENT_NOT_FOUND -1
-#define ADD_REMOVE_VOTE_VARIABLES 3
-#define FIRST_ELEMENT 0
-#define SECOND_ELEMENT 1
-#define THIRD_ELEMENT 2
+/** Enough characters for any int and its terminating null */
+#define MAX_INT_STRING_LENGTH 12
+/** The areas of a task of electionComputeAreasToTribesMappingParallel */
+#define PARALLEL_TASK_AREAS 1024
+/** Batches are sorted by area a byte of the id at a time */
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+/** The locks the areas of a concurrent election are spread over, 1 << AREA_LOCK_BITS of them */
+#define AREA_LOCK_BITS 6
+#define AREA_LOCK_STRIPES (1 << AREA_LOCK_BITS)
+/** The bytes of a cache line, every area lock takes whole lines of its own */
+#define CACHE_LINE 64
+/** The bytes of the area locks, with room to start them at a cache line */
+#define AREA_LOCKS_SIZE (sizeof(AreaLock) * AREA_LOCK_STRIPES + CACHE_LINE)
+/** Spreads the area ids over the area locks (Fibonacci hashing: the high bits of the product) */
+#define AREA_LOCK_MULTIPLIER 0x9E3779B1u
 
-//destroys the election and returns the matching output message 
+//destroys the election and returns the matching output message. a concurrent election may be
+//used by other threads, so it is left as it is
 #define DESTROY_AND_RETURN_ELECTION(election) \
         do { \
-            electionDestroy(election); \
+            if (!(election)->concurrent) { \
+                electionDestroy(election); \
+            } \
             return ELECTION_OUT_OF_MEMORY;\
-        } while(0) 
-
-
-//frees temporary resources var1, var2, var3. enter NULL if there is no need of one of them.
-#define FREE_TEMP_RESOURCES(var1,var2,var3) \
-        do { \
-            freeResource(var1); \
-            freeResource(var2); \
-            freeResource(var3); \
         } while(0)
 
 
-//checks if sscanf worked properly. frees the resources if there is a need to free.
-#define SSCANF_CHECK_AND_FREE(element, to_free, to_return) \
-        do { \
-            if (element == ELEMENT_NOT_FOUND) { \
-                freeResource(to_free); \
-                return to_return; \
-            } \
-        } while(0)
-
 //validate the resources of function election add/remove vote.
 #define VOTE_RESOURCES_VALIDATATION \
         do { \
@@ -49,28 +50,90 @@
             } \
         } while(0)
 
-//validate that the allocations while casting from int to str works properly, also checks if tribe&area exists
-//should insert true inside boolean while using the macro inside add, false inside remove. 
-#define VOTE_STR_ALLOCATION_AND_CHECK(boolean) \
-        do { \
-            ElectionResult result = allocateStrVariables(election, area_id, tribe_id, \
-                            num_of_votes, string_variables, boolean); \
-            if (result != ELECTION_SUCCESS) { \
-                return result; \
-            } \
-        } while(0)
-        
+//a lock of the areas of a concurrent election whose ids fall on it, padded to whole cache lines. the
+//locks start at a cache line (the allocator does not align them), so no two share one
+typedef union AreaLock_t {
+    pthread_mutex_t lock;
+    char lines[(sizeof(pthread_mutex_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE];
+} AreaLock;
+
+//ids are kept as ints everywhere, they are formatted as strings only for the computed mapping
 struct election_t {
-    Map tribes;
-    Map areas;
-    MapIdList votes;
+    Allocator allocator; //a copy of the allocator everything the election holds is taken from
+    IdTable tribes; //tribe id -> the tribe's name
+    IdTable areas; //area id -> the area's name
+    VoteMatrix votes; //the votes of every tribe in every area
+    ThreadPool pool; //kept between parallel computations, NULL until the first one
+    bool concurrent; //see electionCreateConcurrent, the locks below are only used if it is set
+    pthread_rwlock_t structure_lock; //held shared by votes and reads, exclusive by everything else
+    void* area_locks_block; //holds the locks, AREA_LOCKS_SIZE bytes
+    AreaLock* area_locks; //AREA_LOCK_STRIPES locks, a vote holds the lock of its area
+    pthread_mutex_t pool_lock; //one parallel computation at a time
 };
 
-//checks if the user entered NULL as the argument to free, and if it is NULL it wont do anything.
-static inline void freeResource(void* resource){
-    if (resource != NULL) {
-        free(resource);
-    } 
+//the job of electionComputeAreasToTribesMappingParallel: every task formats the areas and
+//the winners of PARALLEL_TASK_AREAS areas into its part of the strings
+typedef struct WinnersJob_t {
+    VoteMatrix votes;
+    int default_tribe;
+    int area_count;
+    char (*strings)[2][MAX_INT_STRING_LENGTH]; //the area and the winner of every area
+} WinnersJob;
+
+//a vote of a batch, batches are sorted by area so every area is looked up once
+typedef struct BatchVote_t {
+    int area_id;
+    int item; //the position of the vote in the batch, keeps the order of the votes of an area
+} BatchVote;
+
+//adds or removes the votes of many tribes in one area, see voteMatrixAddAreaVotes
+typedef VoteMatrixResult (*AreaVotesFunction)(VoteMatrix matrix, int area_id, int count, const int* tribe_ids,
+                                              const int* votes);
+
+//adds or removes votes of a tribe in an area, see voteMatrixAddVotes
+typedef VoteMatrixResult (*VoteFunction)(VoteMatrix matrix, int area_id, int tribe_id, int votes);
+
+//returns the total votes of an area or a tribe, see voteMatrixGetAreaTotal
+typedef long long (*TotalFunction)(VoteMatrix matrix, int id);
+
+//the writer path of a concurrent election: nothing else runs meanwhile
+static void lockStructure(Election election) {
+    if (election->concurrent) {
+        pthread_rwlock_wrlock(&election->structure_lock);
+    }
+}
+
+//the reader path of a concurrent election: runs with other readers and with votes
+static void lockShared(Election election) {
+    if (election->concurrent) {
+        pthread_rwlock_rdlock(&election->structure_lock);
+    }
+}
+
+static void unlockStructure(Election election) {
+    if (election->concurrent) {
+        pthread_rwlock_unlock(&election->structure_lock);
+    }
+}
+
+static AreaLock* areaLock(Election election, int area_id) {
+    //the low bits of the product only permute the low bits of the id, the high bits mix all of them
+    return &election->area_locks[((uint32_t)area_id * AREA_LOCK_MULTIPLIER) >> (32 - AREA_LOCK_BITS)];
+}
+
+//the path of a vote in a concurrent election: runs with everything shared but votes of the same area
+static void lockArea(Election election, int area_id) {
+    if (election->concurrent) {
+        pthread_rwlock_rdlock(&election->structure_lock);
+        pthread_mutex_lock(&areaLock(election, area_id)->lock);
+    }
+}
+
+static void unlockArea(Election election, int area_id) {
+    if (election->concurrent) {
+        pthread_mutex_unlock(&areaLock(election, area_id)->lock);
+        pthread_rwlock_unlock(&election->structure_lock);
+    }
 }
 
 // checks the tribe and area name and returns true if the tribe/area name is valid
@@ -87,44 +150,6 @@ static bool checkValidationTribeOrAreaName(const char* name) {
     return true;
 }
 
-//counts the digit of the entered number and returns the counter
-static int countDigits(int number) {
-    if (number == 0) {
-        return 1;
-    }
-    int counter = 0;
-    while(number > 0) {
-        counter++;
-        number = number/10;
-    }
-    return counter;
-}
-
-// converts integer to string format (char*) and returns the string
-static char* convertIntToString(int number) {
-    if (number < 0) {
-        return NULL;
-    }
-    char* str_number= malloc(countDigits(number)+1);
-    if(str_number == NULL){
-        return NULL;
-    }
-    if (sprintf(str_number,"%d",number) < 0) {
-        FREE_TEMP_RESOURCES(str_number,NULL,NULL);
-        return NULL;
-    }
-    return str_number;
-}
-
-// converts string format (char*) to integer and returns the integer
-static int convertStringToInt(const char* string) {
-    int string_to_int = 0;
-    if (sscanf(string, "%d", &string_to_int) == EOF) {
-        return ELEMENT_NOT_FOUND;
-    }
-    return string_to_int;
-}
-
 //checks the inputs: election - not null, id - not negative, name - not null. (id&name of the tribe or area).
 static ElectionResult addOrSetValidation (Election election, int id, const char* name) {
     if(election == NULL || name == NULL) {
@@ -150,137 +175,180 @@ static ElectionResult addRemoveVoteValidation(Election election, int area_id, in
     return ELECTION_SUCCESS;
 }
 
-// allocates the string variables for the add/remove votes function, and checks if the area/tribe exists already
-static ElectionResult allocateStrVariables(Election election, int area_id, int tribe_id,
-                                                int num_of_votes, char** string_variables, bool add_or_remove) {
-    string_variables[FIRST_ELEMENT] = convertIntToString(area_id);
-    if(string_variables[FIRST_ELEMENT] == NULL){
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if(!mapContains(election->areas,string_variables[FIRST_ELEMENT])){
-        FREE_TEMP_RESOURCES(string_variables[FIRST_ELEMENT],NULL,NULL);
+//checks that the area and the tribe of a vote exist
+static ElectionResult checkVoteIds(Election election, int area_id, int tribe_id) {
+    if (idTableGet(election->areas, area_id) == NULL) {
         return ELECTION_AREA_NOT_EXIST;
     }
-    string_variables[SECOND_ELEMENT] = convertIntToString(tribe_id);
-    if(string_variables[SECOND_ELEMENT] == NULL){
-        FREE_TEMP_RESOURCES(string_variables[FIRST_ELEMENT],NULL,NULL);
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if(!mapContains(election->tribes,string_variables[SECOND_ELEMENT])) {
-        FREE_TEMP_RESOURCES(string_variables[FIRST_ELEMENT],string_variables[SECOND_ELEMENT],NULL);
+    if (idTableGet(election->tribes, tribe_id) == NULL) {
         return ELECTION_TRIBE_NOT_EXIST;
     }
-    if(add_or_remove){
-        string_variables[THIRD_ELEMENT] = convertIntToString(num_of_votes);
-        if(string_variables[THIRD_ELEMENT] == NULL){
-            FREE_TEMP_RESOURCES(string_variables[FIRST_ELEMENT],string_variables[SECOND_ELEMENT],NULL);
-            DESTROY_AND_RETURN_ELECTION(election);
+    return ELECTION_SUCCESS;
+}
+
+//sorts the votes of a batch by area, keeping the order of the votes of every area: a radix sort
+//of the bytes of the ids up to the highest byte of max_area, through a buffer of count votes
+static void sortBatchByArea(BatchVote* batch, BatchVote* buffer, int count, int max_area) {
+    BatchVote* from = batch;
+    BatchVote* to = buffer;
+    int id_bits = (int)sizeof(max_area) * CHAR_BIT;
+    for (int shift = 0; shift == 0 || (shift < id_bits && (max_area >> shift) > 0); shift += RADIX_BITS) {
+        int positions[RADIX_SIZE] = {0};
+        for (int i = 0; i < count; i++) {
+            positions[(from[i].area_id >> shift) & (RADIX_SIZE - 1)]++;
         }
+        for (int digit = 0, position = 0; digit < RADIX_SIZE; digit++) {
+            int digit_count = positions[digit];
+            positions[digit] = position;
+            position += digit_count;
+        }
+        for (int i = 0; i < count; i++) {
+            to[positions[(from[i].area_id >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+        }
+        BatchVote* sorted = to;
+        to = from;
+        from = sorted;
+    }
+    if (from != batch) {
+        memcpy(batch, from, (size_t)count * sizeof(*batch));
     }
-    FREE_TEMP_RESOURCES(string_variables[FIRST_ELEMENT],NULL,NULL);
-    return ELECTION_SUCCESS;
 }
 
-//finds the lowest tribe id and returns the id inside a given election
-static int calculateLowestTribeId(Election election) {
-    assert(election != NULL && mapGetFirst(election->tribes) != NULL); // no need to check election or the tribes again.
-    int lowest_tribe_id = convertStringToInt(mapGetFirst(election->tribes));
-    SSCANF_CHECK_AND_FREE(lowest_tribe_id,NULL, ELEMENT_NOT_FOUND); //no need to free
-    MAP_FOREACH(tribes_iter, election->tribes) {
-        int id_to_check = convertStringToInt(tribes_iter);
-        SSCANF_CHECK_AND_FREE(id_to_check,NULL, ELEMENT_NOT_FOUND); //no need to free
+//adds a copy of a name to one of the election's tables, an existing id is reported before an invalid name
+static ElectionResult addName(Election election, IdTable table, int id, const char* name,
+                              ElectionResult already_exists) {
+    if (!checkValidationTribeOrAreaName(name)) {
+        return idTableGet(table, id) != NULL ? already_exists : ELECTION_INVALID_NAME;
+    }
+    char* name_copy = allocatorCopyString(&election->allocator, name);
+    if (name_copy == NULL) {
+        return ELECTION_OUT_OF_MEMORY;
     }
+    IdTableResult result = idTableAdd(table, id, name_copy); //looks the id up once, adding it if it is new
+    if (result != ID_TABLE_SUCCESS) {
+        allocatorFreeString(&election->allocator, name_copy);
+        return result == ID_TABLE_ID_ALREADY_EXISTS ? already_exists : ELECTION_OUT_OF_MEMORY;
+    }
+    return ELECTION_SUCCESS;
+}
 
-    return lowest_tribe_id;
+//deallocates the names held by one of the election's tables, and the table
+static void destroyNames(Election election, IdTable table) {
+    const int* ids;
+    void* const* names;
+    int number_of_names = idTableGetEntries(table, &ids, &names);
+    for (int i = 0; i < number_of_names; i++) {
+        allocatorFreeString(&election->allocator, names[i]);
+    }
+    idTableDestroy(table);
 }
 
-// aux function for the mapping areas to tribes - updates the areas_to_tribes_mapping with the fitting values
-static bool electionComputeAreasToTribesMappingAux (Election election, Map areas_to_tribes_mapping){
-    assert(election != NULL && areas_to_tribes_mapping != NULL);
-    MAP_FOREACH(area_iter, election->areas) { //looping through the areas
-        bool no_tribe_exists = true;
-        int area_iter_int = convertStringToInt(area_iter);
-        SSCANF_CHECK_AND_FREE(area_iter_int,NULL, false);
-        Map area_votes_map = mapIdListGetMap(election->votes, area_iter_int); // the map of the current area_id
-        assert (area_votes_map != NULL); //shouldnt be NULL
-        int max_votes = 0;
-        char* max_vote_tribe="";
-        MAP_FOREACH(vote_tribe_iter, area_votes_map) { //looping through the vote's map
-            no_tribe_exists = false;
-            assert(mapGet(area_votes_map, vote_tribe_iter) != NULL); // we know there shouldnt be NULL inside
-            int current_tribe_votes = convertStringToInt(mapGet(area_votes_map, vote_tribe_iter));
-            SSCANF_CHECK_AND_FREE(current_tribe_votes,NULL, false);
-            if (current_tribe_votes > max_votes) {
-                max_votes = current_tribe_votes;
-                max_vote_tribe = vote_tribe_iter;
-            }
-            if(current_tribe_votes == max_votes ){ //updates the id to the smallest one
-                int vote_tribe_iter_int = convertStringToInt(vote_tribe_iter);
-                SSCANF_CHECK_AND_FREE(vote_tribe_iter_int,NULL, false);
-                int max_vote_tribe_int = convertStringToInt(max_vote_tribe);
-                SSCANF_CHECK_AND_FREE(max_vote_tribe_int,NULL, false);
-                if(vote_tribe_iter_int < max_vote_tribe_int){
-                    max_vote_tribe = vote_tribe_iter;
-                }
-            }
-        }
-        if (!no_tribe_exists) { //inserting the most voted tribe in the area to the map
-            MapResult result = mapPut(areas_to_tribes_mapping, area_iter, max_vote_tribe);
-            if (result != MAP_SUCCESS) {
-                return false;
-            }
-        }
-        else {
-            char* lowest_tribe_id_str = convertIntToString(calculateLowestTribeId(election));
-            if (lowest_tribe_id_str == NULL) { //program ran out of memory
-                electionDestroy(election);
-                return false;
-            }
-            MapResult result = mapPut(areas_to_tribes_mapping, area_iter, lowest_tribe_id_str);
-            if (result != MAP_SUCCESS) {
-                FREE_TEMP_RESOURCES(lowest_tribe_id_str,NULL,NULL);
-                return false;
-            }
-            FREE_TEMP_RESOURCES(lowest_tribe_id_str,NULL,NULL);
+//finds the lowest tribe id inside a given election
+static int calculateLowestTribeId(Election election) {
+    const int* tribe_ids;
+    void* const* tribe_names;
+    int number_of_tribes = idTableGetEntries(election->tribes, &tribe_ids, &tribe_names);
+    assert(number_of_tribes > 0); // no need to check the tribes again.
+    int lowest_tribe_id = tribe_ids[0];
+    for (int i = 1; i < number_of_tribes; i++) {
+        if (tribe_ids[i] < lowest_tribe_id) {
+            lowest_tribe_id = tribe_ids[i];
         }
     }
-    return true;
+    return lowest_tribe_id;
+}
+
+//voteMatrixForEachWinner function: puts an area and its winner in the mapping
+static bool putAreaWinner(int area_id, int tribe_id, void* areas_to_tribes_mapping) {
+    char area_string[MAX_INT_STRING_LENGTH], winner_string[MAX_INT_STRING_LENGTH];
+    sprintf(area_string, "%d", area_id); //the only place ids become strings
+    sprintf(winner_string, "%d", tribe_id);
+    return mapPut(areas_to_tribes_mapping, area_string, winner_string) == MAP_SUCCESS;
 }
 
 Election electionCreate() {
-    Election election = malloc(sizeof(*election));
+    return electionCreateWithAllocator(allocatorGetDefault());
+}
+
+Election electionCreateWithAllocator(const Allocator* allocator) {
+    if (!allocatorIsValid(allocator)) {
+        return NULL;
+    }
+    Election election = allocator->allocate(allocator->context, sizeof(*election));
     if (election == NULL) {
         return NULL;
     }
-    election->tribes = mapCreate();
+    election->allocator = *allocator;
+    election->tribes = idTableCreate(allocator);
     if (election->tribes == NULL) {
-        free(election);
+        allocator->deallocate(allocator->context, election, sizeof(*election));
         return NULL;
     }
-    election->areas = mapCreate();
-    if (election->tribes == NULL) {
-        mapDestroy(election->tribes);
-        free(election);
+    election->areas = idTableCreate(allocator);
+    if (election->areas == NULL) {
+        idTableDestroy(election->tribes);
+        allocator->deallocate(allocator->context, election, sizeof(*election));
         return NULL;
     }
-    election->votes = mapIdListCreate();
+    election->pool = NULL;
+    election->concurrent = false;
+    election->area_locks_block = NULL;
+    election->area_locks = NULL;
+    election->votes = voteMatrixCreate(allocator);
     if (election->votes == NULL) {
-        mapDestroy(election->tribes);
-        mapDestroy(election->areas);
-        free(election);
+        idTableDestroy(election->tribes);
+        idTableDestroy(election->areas);
+        allocator->deallocate(allocator->context, election, sizeof(*election));
         return NULL;
     }
     return election;
 }
 
+const Allocator* electionGetAllocator(Election election) {
+    return election == NULL ? NULL : &election->allocator;
+}
+
+Election electionCreateConcurrent() {
+    Election election = electionCreate();
+    if (election == NULL) {
+        return NULL;
+    }
+    election->area_locks_block = election->allocator.allocate(election->allocator.context, AREA_LOCKS_SIZE);
+    if (election->area_locks_block == NULL) {
+        electionDestroy(election);
+        return NULL;
+    }
+    election->area_locks = (AreaLock*)(((uintptr_t)election->area_locks_block + CACHE_LINE - 1)
+                                       & ~(uintptr_t)(CACHE_LINE - 1));
+    pthread_rwlock_init(&election->structure_lock, NULL);
+    pthread_mutex_init(&election->pool_lock, NULL);
+    for (int i = 0; i < AREA_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&election->area_locks[i].lock, NULL);
+    }
+    election->concurrent = true;
+    return election;
+}
+
 void electionDestroy (Election election) {
     if (election == NULL) {
         return;
     }
-    mapDestroy(election->tribes);
-    mapDestroy(election->areas);
-    mapIdListDestroy(election->votes);
-    free(election);
+    Allocator allocator = election->allocator; //the election holds the allocator, keep it until the end
+    destroyNames(election, election->tribes);
+    destroyNames(election, election->areas);
+    voteMatrixDestroy(election->votes);
+    threadPoolDestroy(election->pool);
+    if (election->concurrent) {
+        pthread_rwlock_destroy(&election->structure_lock);
+        pthread_mutex_destroy(&election->pool_lock);
+        for (int i = 0; i < AREA_LOCK_STRIPES; i++) {
+            pthread_mutex_destroy(&election->area_locks[i].lock);
+        }
+    }
+    if (election->area_locks_block != NULL) {
+        allocator.deallocate(allocator.context, election->area_locks_block, AREA_LOCKS_SIZE);
+    }
+    allocator.deallocate(allocator.context, election, sizeof(*election));
 }
 
 ElectionResult electionAddTribe(Election election, int tribe_id, const char* tribe_name) {
@@ -288,149 +356,182 @@ ElectionResult electionAddTribe(Election election, int tribe_id, const char* tri
     if (validation != ELECTION_SUCCESS) {
         return validation;
     }
-    char *str_id = convertIntToString(tribe_id);
-    if(str_id == NULL){
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if(mapContains(election->tribes,str_id)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_TRIBE_ALREADY_EXIST;
-    }
-    if(!checkValidationTribeOrAreaName(tribe_name)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_INVALID_NAME;
+    lockStructure(election);
+    ElectionResult result = addName(election, election->tribes, tribe_id, tribe_name,
+                                    ELECTION_TRIBE_ALREADY_EXIST);
+    if (result == ELECTION_SUCCESS && election->concurrent
+        && voteMatrixAddTribe(election->votes, tribe_id) != VOTE_MATRIX_SUCCESS) { //so votes never add columns
+        allocatorFreeString(&election->allocator, idTableRemove(election->tribes, tribe_id));
+        result = ELECTION_OUT_OF_MEMORY;
     }
-    //at this stage we know that the key (tribe id) doesnt exist.
-    MapResult result = mapPut(election->tribes, str_id, tribe_name);
-    if (result == MAP_OUT_OF_MEMORY) {
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
+    unlockStructure(election);
+    if (result == ELECTION_OUT_OF_MEMORY) {
         DESTROY_AND_RETURN_ELECTION(election);
     }
-    FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-    return ELECTION_SUCCESS;
+    return result;
 }
 
 
 ElectionResult electionAddArea(Election election, int area_id, const char* area_name){
-    ElectionResult result = addOrSetValidation(election,area_id, area_name);
-    if(result != ELECTION_SUCCESS){
-        return result;
+    ElectionResult validation = addOrSetValidation(election,area_id, area_name);
+    if(validation != ELECTION_SUCCESS){
+        return validation;
     }
-    char *str_id = convertIntToString(area_id);
-    if(str_id == NULL){
-        DESTROY_AND_RETURN_ELECTION(election);
+    lockStructure(election);
+    ElectionResult result = addName(election, election->areas, area_id, area_name, ELECTION_AREA_ALREADY_EXIST);
+    if (result == ELECTION_SUCCESS && voteMatrixAddArea(election->votes, area_id) != VOTE_MATRIX_SUCCESS) {
+        //the inputs were checked already, only an allocation can fail here
+        allocatorFreeString(&election->allocator, idTableRemove(election->areas, area_id));
+        result = ELECTION_OUT_OF_MEMORY;
     }
-    if(mapContains(election->areas,str_id)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_AREA_ALREADY_EXIST;
+    unlockStructure(election);
+    if (result == ELECTION_OUT_OF_MEMORY) {
+        DESTROY_AND_RETURN_ELECTION(election);
     }
-    if(!checkValidationTribeOrAreaName(area_name)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_INVALID_NAME;
+    return result;
+}
+
+//applies a vote of a checked election and votes: with the shared function under the area's lock in a
+//concurrent election, and with the exclusive one alone if the shared one can't
+static ElectionResult applyVote(Election election, int area_id, int tribe_id, int num_of_votes,
+                                VoteFunction apply_shared, VoteFunction apply_exclusive) {
+    lockArea(election, area_id);
+    ElectionResult result = checkVoteIds(election, area_id, tribe_id);
+    VoteMatrixResult matrix_result = VOTE_MATRIX_SUCCESS;
+    if (result == ELECTION_SUCCESS) {
+        matrix_result = (election->concurrent ? apply_shared : apply_exclusive)(election->votes, area_id, tribe_id,
+                                                                                num_of_votes);
+    }
+    unlockArea(election, area_id);
+    if (matrix_result == VOTE_MATRIX_NEEDS_EXCLUSIVE) { //the votes change more than their own area
+        lockStructure(election);
+        result = checkVoteIds(election, area_id, tribe_id); //the area or the tribe may be gone meanwhile
+        if (result == ELECTION_SUCCESS) {
+            matrix_result = apply_exclusive(election->votes, area_id, tribe_id, num_of_votes);
+        }
+        unlockStructure(election);
     }
-    //at this stage we know that the key (area id) doesnt exist.
-    MapResult area_map_result = mapPut(election->areas, str_id, area_name);
-    if (area_map_result == MAP_OUT_OF_MEMORY) {
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
+    if (result == ELECTION_SUCCESS && matrix_result != VOTE_MATRIX_SUCCESS) {
         DESTROY_AND_RETURN_ELECTION(election);
     }
-    MapIdListResult area_votes_result = mapIdListAdd(election->votes, area_id);
-    if (area_votes_result != MAP_ID_LIST_SUCCESS) { //shouldnt enter here as we checked the inputs already
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_NULL_ARGUMENT;
-    }
-    FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-    return ELECTION_SUCCESS;
+    return result;
 }
 
 ElectionResult electionAddVote (Election election, int area_id, int tribe_id, int num_of_votes) {
     VOTE_RESOURCES_VALIDATATION;
-    char* string_variables[ADD_REMOVE_VOTE_VARIABLES]; //contains the string variables we need to use
-    VOTE_STR_ALLOCATION_AND_CHECK(true);
-    char* tribe_string = string_variables[SECOND_ELEMENT];
-    char* num_of_votes_string = string_variables[THIRD_ELEMENT];
-    Map map_area_id = mapIdListGetMap(election->votes,area_id);
-    if(map_area_id == NULL) {
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,NULL);
+    return applyVote(election, area_id, tribe_id, num_of_votes, voteMatrixAddVotesShared, voteMatrixAddVotes);
+}
+
+ElectionResult electionRemoveVote(Election election, int area_id, int tribe_id, int num_of_votes) {
+    VOTE_RESOURCES_VALIDATATION;
+    //if the user removes more votes then the current votes, enters 0.
+    return applyVote(election, area_id, tribe_id, num_of_votes, voteMatrixRemoveVotesShared, voteMatrixRemoveVotes);
+}
+
+//applies a batch of votes: checks them all, sorts the valid ones by area (unless they are sorted
+//already), and passes the votes of every area to the matrix at once
+static ElectionResult applyVotesBatch(Election election, int count, const int* area_ids, const int* tribe_ids,
+                                      const int* num_of_votes, ElectionResult* results,
+                                      AreaVotesFunction apply_area_votes) {
+    if (election == NULL || area_ids == NULL || tribe_ids == NULL || num_of_votes == NULL || results == NULL) {
         return ELECTION_NULL_ARGUMENT;
     }
-    if (!mapContains(map_area_id, tribe_string)){
-        if(mapPut(map_area_id, tribe_string, num_of_votes_string) != MAP_SUCCESS){
-            FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,NULL);
-            DESTROY_AND_RETURN_ELECTION(election);
+    if (count <= 0) {
+        return count == 0 ? ELECTION_SUCCESS : ELECTION_ERROR;
+    }
+    //the batch, then the tribes and the votes of one area (which are the buffer of the sort before)
+    size_t scratch_size = (size_t)count * (sizeof(BatchVote) + 2 * sizeof(int));
+    BatchVote* batch = election->allocator.allocate(election->allocator.context, scratch_size);
+    if (batch == NULL) {
+        return ELECTION_OUT_OF_MEMORY;
+    }
+    int* area_tribes = (int*)(batch + count);
+    int* area_votes = area_tribes + count;
+    bool failed = false, sorted = true;
+    int valid = 0, max_area = 0;
+    for (int i = 0; i < count; i++) {
+        results[i] = addRemoveVoteValidation(election, area_ids[i], tribe_ids[i], num_of_votes[i]);
+        if (results[i] != ELECTION_SUCCESS) {
+            failed = true;
+            continue;
+        }
+        sorted = sorted && (valid == 0 || batch[valid - 1].area_id <= area_ids[i]);
+        max_area = area_ids[i] > max_area ? area_ids[i] : max_area;
+        batch[valid].area_id = area_ids[i];
+        batch[valid++].item = i;
+    }
+    if (!sorted) {
+        sortBatchByArea(batch, (BatchVote*)area_tribes, valid, max_area);
+    }
+    for (int first = 0, end; first < valid; first = end) {
+        int area_id = batch[first].area_id;
+        bool area_exists = idTableGet(election->areas, area_id) != NULL;
+        int area_count = 0;
+        for (end = first; end < valid && batch[end].area_id == area_id; end++) {
+            int item = batch[end].item;
+            if (!area_exists) {
+                results[item] = ELECTION_AREA_NOT_EXIST;
+            } else if (idTableGet(election->tribes, tribe_ids[item]) == NULL) {
+                results[item] = ELECTION_TRIBE_NOT_EXIST;
+            }
+            if (results[item] != ELECTION_SUCCESS) {
+                failed = true;
+                continue;
+            }
+            area_tribes[area_count] = tribe_ids[item];
+            area_votes[area_count++] = num_of_votes[item];
+        }
+        if (area_count > 0
+            && apply_area_votes(election->votes, area_id, area_count, area_tribes, area_votes) != VOTE_MATRIX_SUCCESS) {
+            election->allocator.deallocate(election->allocator.context, batch, scratch_size);
+            return ELECTION_OUT_OF_MEMORY;
         }
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,NULL);
-        return ELECTION_SUCCESS;
-    }
-    int current_num_of_votes = convertStringToInt(mapGet(map_area_id, tribe_string));
-    if (current_num_of_votes == ELEMENT_NOT_FOUND) {
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,NULL);
-        return ELECTION_ERROR;
-    }
-    char* num_of_votes_update_string = convertIntToString(current_num_of_votes + num_of_votes);
-    if (num_of_votes_update_string == NULL) {
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,NULL);
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if (mapPut(map_area_id, tribe_string, num_of_votes_update_string) != MAP_SUCCESS) {
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,num_of_votes_update_string);
-        DESTROY_AND_RETURN_ELECTION(election);
     }
-    FREE_TEMP_RESOURCES(tribe_string,num_of_votes_string,num_of_votes_update_string);
-    return ELECTION_SUCCESS;
+    election->allocator.deallocate(election->allocator.context, batch, scratch_size);
+    return failed ? ELECTION_ERROR : ELECTION_SUCCESS;
 }
 
-ElectionResult electionRemoveVote(Election election, int area_id, int tribe_id, int num_of_votes) {
-    VOTE_RESOURCES_VALIDATATION; 
-    char* string_variables[ADD_REMOVE_VOTE_VARIABLES];
-    VOTE_STR_ALLOCATION_AND_CHECK(false);
-    char* tribe_string = string_variables[SECOND_ELEMENT];
-    Map map_area_id = mapIdListGetMap(election->votes,area_id);
-    if(map_area_id == NULL) {
-        FREE_TEMP_RESOURCES(tribe_string,NULL,NULL);
+//applies a batch on the writer path, a batch has votes of many areas
+static ElectionResult applyVotesBatchExclusively(Election election, int count, const int* area_ids,
+                                                 const int* tribe_ids, const int* num_of_votes,
+                                                 ElectionResult* results, AreaVotesFunction apply_area_votes) {
+    if (election == NULL) {
         return ELECTION_NULL_ARGUMENT;
     }
-    if (!mapContains(map_area_id, tribe_string)){
-        FREE_TEMP_RESOURCES(tribe_string,NULL,NULL);
-        return ELECTION_SUCCESS;
-    }
-    int current_num_of_votes = convertStringToInt(mapGet(map_area_id, tribe_string));
-    SSCANF_CHECK_AND_FREE(current_num_of_votes, tribe_string, ELECTION_ERROR);
-    if (current_num_of_votes < num_of_votes) { //if the user removes more votes then the current votes, enters 0.
-        num_of_votes = current_num_of_votes;
-    }
-    char* num_of_votes_update_string = convertIntToString(current_num_of_votes - num_of_votes);
-    if (num_of_votes_update_string == NULL) {
-        FREE_TEMP_RESOURCES(tribe_string,NULL,NULL);
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if (mapPut(map_area_id, tribe_string, num_of_votes_update_string) != MAP_SUCCESS) {
-        FREE_TEMP_RESOURCES(tribe_string,num_of_votes_update_string,NULL);
+    lockStructure(election);
+    ElectionResult result = applyVotesBatch(election, count, area_ids, tribe_ids, num_of_votes, results,
+                                            apply_area_votes);
+    unlockStructure(election);
+    if (result == ELECTION_OUT_OF_MEMORY) {
         DESTROY_AND_RETURN_ELECTION(election);
     }
-    FREE_TEMP_RESOURCES(tribe_string,num_of_votes_update_string,NULL);
-    return ELECTION_SUCCESS;
+    return result;
+}
+
+ElectionResult electionAddVotesBatch(Election election, int count, const int* area_ids, const int* tribe_ids,
+                                     const int* num_of_votes, ElectionResult* results) {
+    return applyVotesBatchExclusively(election, count, area_ids, tribe_ids, num_of_votes, results,
+                                      voteMatrixAddAreaVotes);
+}
+
+ElectionResult electionRemoveVotesBatch(Election election, int count, const int* area_ids, const int* tribe_ids,
+                                        const int* num_of_votes, ElectionResult* results) {
+    return applyVotesBatchExclusively(election, count, area_ids, tribe_ids, num_of_votes, results,
+                                      voteMatrixRemoveAreaVotes);
 }
 
 char* electionGetTribeName (Election election, int tribe_id){
     if(election == NULL){
         return NULL;
     }
-    char *str_id = convertIntToString(tribe_id);
-    if(str_id == NULL){
-        return NULL;
-    }
-    char *str_name = mapGet(election->tribes,str_id);
-    if (str_name == NULL) {
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return NULL;
+    lockShared(election);
+    const char* str_name = idTableGet(election->tribes, tribe_id);
+    char *returned_name = str_name == NULL ? NULL : malloc(strlen(str_name)+1); //assuming the user frees it later
+    if(returned_name != NULL){
+        strcpy(returned_name,str_name);
     }
-    FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-    char *returned_name = malloc(strlen(str_name)+1); //assuming the user frees it later
-    if(returned_name == NULL){
-        return NULL;
-    }
-    return strcpy(returned_name,str_name);
+    unlockStructure(election);
+    return returned_name;
 }
 
 ElectionResult electionSetTribeName (Election election, int tribe_id, const char* tribe_name){
@@ -438,27 +539,27 @@ ElectionResult electionSetTribeName (Election election, int tribe_id, const char
     if (validation != ELECTION_SUCCESS) {
         return validation;
     }
-    char *str_id = convertIntToString(tribe_id);
-    if(str_id == NULL){
-        DESTROY_AND_RETURN_ELECTION(election);
-    }
-    if(!mapContains(election->tribes,str_id)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_TRIBE_NOT_EXIST;
-    }
-    if(!checkValidationTribeOrAreaName(tribe_name)){
-        FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-        return ELECTION_INVALID_NAME;
-    }
-    MapResult result = mapPut(election->tribes,str_id,tribe_name);
-    FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-    if(result == MAP_NULL_ARGUMENT){
-        return ELECTION_NULL_ARGUMENT;
+    lockStructure(election);
+    ElectionResult result = ELECTION_SUCCESS;
+    if(idTableGet(election->tribes, tribe_id) == NULL){
+        result = ELECTION_TRIBE_NOT_EXIST;
+    } else if(!checkValidationTribeOrAreaName(tribe_name)){
+        result = ELECTION_INVALID_NAME;
+    } else {
+        char* name_copy = allocatorCopyString(&election->allocator, tribe_name);
+        void* previous_name = NULL;
+        if (name_copy == NULL) {
+            result = ELECTION_OUT_OF_MEMORY;
+        } else {
+            idTableSet(election->tribes, tribe_id, name_copy, &previous_name); //the id exists, it can't fail
+            allocatorFreeString(&election->allocator, previous_name);
+        }
     }
-    if(result == MAP_OUT_OF_MEMORY){
+    unlockStructure(election);
+    if (result == ELECTION_OUT_OF_MEMORY) {
         DESTROY_AND_RETURN_ELECTION(election);
     }
-    return ELECTION_SUCCESS;
+    return result;
 }
 
 ElectionResult electionRemoveTribe (Election election, int tribe_id){
@@ -468,70 +569,350 @@ ElectionResult electionRemoveTribe (Election election, int tribe_id){
     if (tribe_id < 0) {
         return ELECTION_INVALID_ID;
     }
-    char *str_id = convertIntToString(tribe_id);
-    if(str_id == NULL){
-        DESTROY_AND_RETURN_ELECTION(election);
+    lockStructure(election);
+    char* tribe_name = idTableRemove(election->tribes, tribe_id);
+    if(tribe_name != NULL){
+        allocatorFreeString(&election->allocator, tribe_name);
+        voteMatrixRemoveTribe(election->votes, tribe_id); //votes of a removed tribe don't count
     }
-    MapResult result = mapRemove(election->tribes,str_id);
-    FREE_TEMP_RESOURCES(str_id,NULL,NULL);
-    if(result == MAP_NULL_ARGUMENT){
+    unlockStructure(election);
+    return tribe_name == NULL ? ELECTION_TRIBE_NOT_EXIST : ELECTION_SUCCESS;
+}
+
+ElectionResult electionRemoveAreasBatch(Election election, AreaBatchConditionFunction should_delete_areas,
+                                        void* context) {
+    if (election == NULL || should_delete_areas == NULL) {
         return ELECTION_NULL_ARGUMENT;
     }
-    if(result == MAP_ITEM_DOES_NOT_EXIST){
-        return ELECTION_TRIBE_NOT_EXIST;
+    lockStructure(election);
+    const int* area_ids;
+    void* const* area_names;
+    int num_of_areas = idTableGetEntries(election->areas, &area_ids, &area_names);
+    size_t mask_size = (num_of_areas / ELECTION_MASK_BITS + 1) * sizeof(uint64_t);
+    uint64_t* remove_mask = election->allocator.allocate(election->allocator.context, mask_size);
+    if (remove_mask == NULL) {
+        unlockStructure(election);
+        DESTROY_AND_RETURN_ELECTION(election);
+    }
+    memset(remove_mask, 0, mask_size); //no area is marked until the condition marks it
+    should_delete_areas(area_ids, num_of_areas, remove_mask, context);
+    //the votes go first: if they fail nothing was removed
+    if (voteMatrixRemoveAreas(election->votes, num_of_areas, area_ids, remove_mask) != VOTE_MATRIX_SUCCESS) {
+        unlockStructure(election);
+        election->allocator.deallocate(election->allocator.context, remove_mask, mask_size);
+        DESTROY_AND_RETURN_ELECTION(election);
+    }
+    for (int i = 0; i < num_of_areas; i++) {
+        if ((remove_mask[i / ELECTION_MASK_BITS] >> (i % ELECTION_MASK_BITS)) & 1) {
+            allocatorFreeString(&election->allocator, area_names[i]);
+        }
     }
+    idTableRemoveMarked(election->areas, remove_mask);
+    unlockStructure(election);
+    election->allocator.deallocate(election->allocator.context, remove_mask, mask_size);
     return ELECTION_SUCCESS;
 }
 
+typedef struct AreaCondition_t {
+    AreaConditionFunction should_delete_area;
+} AreaCondition;
+
+//asks an AreaConditionFunction about every area
+static void markAreasByCondition(const int* area_ids, int count, uint64_t* remove_mask, void* context) {
+    AreaConditionFunction should_delete_area = ((const AreaCondition*)context)->should_delete_area;
+    for (int i = 0; i < count; i++) {
+        if (should_delete_area(area_ids[i])) {
+            remove_mask[i / ELECTION_MASK_BITS] |= (uint64_t)1 << (i % ELECTION_MASK_BITS);
+        }
+    }
+}
+
 ElectionResult electionRemoveAreas(Election election, AreaConditionFunction should_delete_area) {
     if (election == NULL || should_delete_area == NULL) {
         return ELECTION_NULL_ARGUMENT;
     }
-    if (election->areas == NULL) {
+    AreaCondition condition = {should_delete_area};
+    return electionRemoveAreasBatch(election, markAreasByCondition, &condition);
+}
+
+typedef struct AreaRange_t {
+    int low;
+    int high;
+} AreaRange;
+
+//marks the ids in a range a word at a time, with one unsigned compare and no branch per id
+static void markAreaRange(const int* area_ids, int count, uint64_t* remove_mask, void* context) {
+    const AreaRange* range = context;
+    unsigned int low = (unsigned int)range->low;
+    unsigned int width = (unsigned int)range->high - low;
+    for (int first = 0; first < count; first += ELECTION_MASK_BITS) {
+        int size = count - first < ELECTION_MASK_BITS ? count - first : ELECTION_MASK_BITS;
+        uint64_t word = 0;
+        for (int bit = 0; bit < size; bit++) {
+            word |= (uint64_t)((unsigned int)area_ids[first + bit] - low <= width) << bit;
+        }
+        remove_mask[first / ELECTION_MASK_BITS] = word;
+    }
+}
+
+ElectionResult electionRemoveAreaRange(Election election, int low, int high) {
+    if (election == NULL) {
         return ELECTION_NULL_ARGUMENT;
     }
-    int num_of_areas = mapGetSize(election->areas);
-    char** areas_to_remove = malloc(sizeof(char*)*num_of_areas);
-    if (areas_to_remove == NULL) {
-        DESTROY_AND_RETURN_ELECTION(election);
+    if (low > high) {
+        return ELECTION_ERROR;
     }
-    int areas_to_remove_counter = 0;
-    MAP_FOREACH(iter, election->areas) {
-        int area_id = convertStringToInt(iter);
-        SSCANF_CHECK_AND_FREE(area_id, areas_to_remove, ELECTION_ERROR);
-        if (should_delete_area(area_id)) { //checking which areas need to be removed
-            assert(area_id>=0);
-            areas_to_remove[areas_to_remove_counter] = iter; //insert them to the array
-            areas_to_remove_counter++;
-        }
+    AreaRange range = {low, high};
+    return electionRemoveAreasBatch(election, markAreaRange, &range);
+}
+
+//computes the mapping, the caller holds the structure at least shared
+static Map computeMapping(Election election) {
+    Map areas_to_tribes_mapping = mapCreateWithAllocator(&election->allocator);
+    if (areas_to_tribes_mapping == NULL) {
+        return NULL;
     }
-    for (int i=0; i<areas_to_remove_counter; i++) {//looping through the array and removing
-        int area_id_to_remove = convertStringToInt(areas_to_remove[i]);
-        SSCANF_CHECK_AND_FREE(area_id_to_remove, areas_to_remove, ELECTION_ERROR);
-        if(mapIdListRemove(election->votes, area_id_to_remove) != MAP_ID_LIST_SUCCESS) { //no need to check the id
-            return ELECTION_NULL_ARGUMENT;
-        }
-        if(mapRemove(election->areas, areas_to_remove[i]) != MAP_SUCCESS){ //no need to check if the key exists
-            return ELECTION_NULL_ARGUMENT;
-        }
+    if (idTableGetSize(election->areas) == 0 || idTableGetSize(election->tribes) == 0) { // no tribes or areas
+        return areas_to_tribes_mapping;
     }
-    FREE_TEMP_RESOURCES(areas_to_remove,NULL,NULL);
-    return ELECTION_SUCCESS;
+    if (!voteMatrixForEachWinner(election->votes, calculateLowestTribeId(election), putAreaWinner,
+                                 areas_to_tribes_mapping)) { //out of memory
+        mapDestroy(areas_to_tribes_mapping);
+        return NULL;
+    }
+    return areas_to_tribes_mapping;
 }
 
 Map electionComputeAreasToTribesMapping (Election election) {
     if (election == NULL) {
         return NULL;
     }
-    Map areas_to_tribes_mapping = mapCreate();
+    lockShared(election);
+    Map areas_to_tribes_mapping = computeMapping(election);
+    unlockStructure(election);
+    return areas_to_tribes_mapping;
+}
+
+//threadPoolRun function: formats the areas and the winners of one task
+static void formatWinners(int task, int worker, void* context) {
+    WinnersJob* job = context;
+    int area_ids[PARALLEL_TASK_AREAS], winners[PARALLEL_TASK_AREAS];
+    int first = task * PARALLEL_TASK_AREAS;
+    int count = job->area_count - first < PARALLEL_TASK_AREAS ? job->area_count - first : PARALLEL_TASK_AREAS;
+    voteMatrixGetWinners(job->votes, first, count, job->default_tribe, area_ids, winners);
+    for (int i = 0; i < count; i++) {
+        sprintf(job->strings[first + i][0], "%d", area_ids[i]);
+        sprintf(job->strings[first + i][1], "%d", winners[i]);
+    }
+}
+
+//returns the election's pool of thread_count workers, creating it if needed. NULL if that failed
+static ThreadPool getThreadPool(Election election, int thread_count) {
+    if (threadPoolGetSize(election->pool) != thread_count) {
+        threadPoolDestroy(election->pool);
+        election->pool = threadPoolCreate(thread_count, &election->allocator);
+    }
+    return election->pool;
+}
+
+//computes the mapping on the election's pool, the caller holds the pool and the structure at least shared
+static Map computeMappingParallel(Election election, int thread_count) {
+    int area_count = voteMatrixGetAreaCount(election->votes);
+    if (thread_count == 1 || area_count == 0 || idTableGetSize(election->tribes) == 0) {
+        return computeMapping(election);
+    }
+    Map areas_to_tribes_mapping = mapCreateWithAllocator(&election->allocator);
     if (areas_to_tribes_mapping == NULL) {
         return NULL;
     }
-    if (mapGetSize(election->areas) == 0 || mapGetSize(election->tribes) == 0) { // no tribes or areas
-        return areas_to_tribes_mapping;
+    size_t strings_size = (size_t)area_count * 2 * MAX_INT_STRING_LENGTH;
+    WinnersJob job = { election->votes, calculateLowestTribeId(election), area_count, NULL };
+    job.strings = election->allocator.allocate(election->allocator.context, strings_size);
+    ThreadPool pool = getThreadPool(election, thread_count);
+    if (job.strings == NULL || pool == NULL) {
+        if (job.strings != NULL) {
+            election->allocator.deallocate(election->allocator.context, job.strings, strings_size);
+        }
+        mapDestroy(areas_to_tribes_mapping);
+        return NULL;
+    }
+    threadPoolRun(pool, (area_count + PARALLEL_TASK_AREAS - 1) / PARALLEL_TASK_AREAS, formatWinners, &job);
+    for (int i = 0; i < area_count; i++) { //the map is not thread safe, this part stays on one thread
+        if (mapPut(areas_to_tribes_mapping, job.strings[i][0], job.strings[i][1]) != MAP_SUCCESS) {
+            mapDestroy(areas_to_tribes_mapping);
+            areas_to_tribes_mapping = NULL;
+            break;
+        }
     }
-    if(!electionComputeAreasToTribesMappingAux(election,areas_to_tribes_mapping)) { //no tribes in the map
+    election->allocator.deallocate(election->allocator.context, job.strings, strings_size);
+    return areas_to_tribes_mapping;
+}
+
+Map electionComputeAreasToTribesMappingParallel(Election election, int thread_count) {
+    if (election == NULL || thread_count <= 0) {
         return NULL;
     }
+    if (election->concurrent) { //one computation at a time runs on the pool
+        pthread_mutex_lock(&election->pool_lock);
+    }
+    lockShared(election);
+    Map areas_to_tribes_mapping = computeMappingParallel(election, thread_count);
+    unlockStructure(election);
+    if (election->concurrent) {
+        pthread_mutex_unlock(&election->pool_lock);
+    }
     return areas_to_tribes_mapping;
-}
\ No newline at end of file
+}
+
+//sets the total of every id, -1 for an id that is not in the table. returns false if any was not
+static bool readTotals(Election election, IdTable table, TotalFunction get_total, int count, const int* ids,
+                       long long* totals) {
+    bool all_found = true;
+    lockShared(election);
+    for (int i = 0; i < count; i++) {
+        bool found = idTableGet(table, ids[i]) != NULL;
+        totals[i] = found ? get_total(election->votes, ids[i]) : ELEMENT_NOT_FOUND;
+        all_found = all_found && found;
+    }
+    unlockStructure(election);
+    return all_found;
+}
+
+ElectionResult electionGetTribeTotal(Election election, int tribe_id, long long* total) {
+    if (election == NULL || total == NULL) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (tribe_id < 0) {
+        return ELECTION_INVALID_ID;
+    }
+    return readTotals(election, election->tribes, voteMatrixGetTribeTotal, 1, &tribe_id, total)
+           ? ELECTION_SUCCESS : ELECTION_TRIBE_NOT_EXIST;
+}
+
+ElectionResult electionGetAreaTotal(Election election, int area_id, long long* total) {
+    if (election == NULL || total == NULL) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (area_id < 0) {
+        return ELECTION_INVALID_ID;
+    }
+    return readTotals(election, election->areas, voteMatrixGetAreaTotal, 1, &area_id, total)
+           ? ELECTION_SUCCESS : ELECTION_AREA_NOT_EXIST;
+}
+
+ElectionResult electionGetTribeTotals(Election election, int count, const int* tribe_ids, long long* totals) {
+    if (election == NULL || (count > 0 && (tribe_ids == NULL || totals == NULL))) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (count < 0) {
+        return ELECTION_ERROR;
+    }
+    return readTotals(election, election->tribes, voteMatrixGetTribeTotal, count, tribe_ids, totals)
+           ? ELECTION_SUCCESS : ELECTION_ERROR;
+}
+
+ElectionResult electionGetAreaTotals(Election election, int count, const int* area_ids, long long* totals) {
+    if (election == NULL || (count > 0 && (area_ids == NULL || totals == NULL))) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (count < 0) {
+        return ELECTION_ERROR;
+    }
+    return readTotals(election, election->areas, voteMatrixGetAreaTotal, count, area_ids, totals)
+           ? ELECTION_SUCCESS : ELECTION_ERROR;
+}
+
+//locks what a ranking reads: an area's row as its votes do, or only the structure for the totals
+static void lockRanking(Election election, int area_id) {
+    if (area_id == ELECTION_NATIONAL) {
+        lockShared(election);
+    } else {
+        lockArea(election, area_id);
+    }
+}
+
+static void unlockRanking(Election election, int area_id) {
+    if (area_id == ELECTION_NATIONAL) {
+        unlockStructure(election);
+    } else {
+        unlockArea(election, area_id);
+    }
+}
+
+ElectionResult electionGetTopTribes(Election election, int area_id, int k, int* tribe_ids, long long* votes,
+                                    int* count) {
+    if (election == NULL || count == NULL || (k > 0 && (tribe_ids == NULL || votes == NULL))) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (area_id < 0 && area_id != ELECTION_NATIONAL) {
+        return ELECTION_INVALID_ID;
+    }
+    if (k < 0) {
+        return ELECTION_ERROR;
+    }
+    lockRanking(election, area_id);
+    VoteMatrixResult result = area_id == ELECTION_NATIONAL
+                              ? voteMatrixGetTopTotals(election->votes, k, tribe_ids, votes, count)
+                              : voteMatrixGetTopTribes(election->votes, area_id, k, tribe_ids, votes, count);
+    unlockRanking(election, area_id);
+    if (result == VOTE_MATRIX_AREA_DOES_NOT_EXIST) {
+        return ELECTION_AREA_NOT_EXIST;
+    }
+    return result == VOTE_MATRIX_SUCCESS ? ELECTION_SUCCESS : ELECTION_OUT_OF_MEMORY;
+}
+
+ElectionResult electionGetTribeRank(Election election, int area_id, int tribe_id, int* rank) {
+    if (election == NULL || rank == NULL) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if ((area_id < 0 && area_id != ELECTION_NATIONAL) || tribe_id < 0) {
+        return ELECTION_INVALID_ID;
+    }
+    lockRanking(election, area_id);
+    ElectionResult result = ELECTION_SUCCESS;
+    if (area_id != ELECTION_NATIONAL && idTableGet(election->areas, area_id) == NULL) {
+        result = ELECTION_AREA_NOT_EXIST;
+    } else if (idTableGet(election->tribes, tribe_id) == NULL) {
+        result = ELECTION_TRIBE_NOT_EXIST;
+    } else {
+        *rank = area_id == ELECTION_NATIONAL ? voteMatrixGetTotalRank(election->votes, tribe_id)
+                                             : voteMatrixGetRank(election->votes, area_id, tribe_id);
+    }
+    unlockRanking(election, area_id);
+    return result;
+}
+
+//the memory of one of the election's tables, with the names it holds as payload
+static MapMemoryUsage namesMemoryUsage(Election election, IdTable table) {
+    MapMemoryUsage usage = idTableMemoryUsage(table);
+    const int* ids;
+    void* const* names;
+    int number_of_names = idTableGetEntries(table, &ids, &names);
+    for (int i = 0; i < number_of_names; i++) {
+        size_t name_size = strlen(names[i]) + 1;
+        usage.payload_bytes += name_size;
+        usage.overhead_bytes += allocatorEstimateOverhead(&election->allocator, names[i], name_size);
+    }
+    usage.total_bytes = usage.payload_bytes + usage.structure_bytes + usage.overhead_bytes;
+    return usage;
+}
+
+ElectionMemoryUsage electionMemoryUsage(Election election) {
+    ElectionMemoryUsage usage;
+    memset(&usage, 0, sizeof(usage));
+    usage.largest_vote_row_area = ELEMENT_NOT_FOUND;
+    if (election == NULL) {
+        return usage;
+    }
+    lockStructure(election); //the sizes of the rows change with votes
+    usage.tribes = namesMemoryUsage(election, election->tribes);
+    usage.areas = namesMemoryUsage(election, election->areas);
+    VoteMatrixMemoryUsage votes_usage = voteMatrixMemoryUsage(election->votes);
+    usage.votes = votes_usage.tallies;
+    usage.largest_vote_row_area = votes_usage.largest_row_area;
+    usage.largest_vote_row_bytes = votes_usage.largest_row_bytes;
+    usage.total_bytes = sizeof(*election) + allocatorEstimateOverhead(&election->allocator, election, sizeof(*election))
+                        + usage.tribes.total_bytes + usage.areas.total_bytes + usage.votes.total_bytes;
+    unlockStructure(election);
+    return usage;
+}
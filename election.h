@@ -5,6 +5,7 @@
 #ifndef MTM_ELECTION_H
 #define MTM_ELECTION_H
 #include "map.h"
+#include <stdint.h>
 
 typedef struct election_t* Election;
 
@@ -24,8 +25,77 @@ typedef enum ElectionResult_t {
 
 typedef bool (*AreaConditionFunction) (int);
 
+/** The areas marked by every word of a mask, see AreaBatchConditionFunction */
+#define ELECTION_MASK_BITS 64
+
+/**
+* Type of a function that picks areas to remove from an array of area ids, all
+* at once: it sets bit i % ELECTION_MASK_BITS of remove_mask[i / ELECTION_MASK_BITS]
+* to remove area_ids[i]. The mask comes zeroed, with room for count bits.
+*/
+typedef void (*AreaBatchConditionFunction) (const int* area_ids, int count, uint64_t* remove_mask, void* context);
+
+/** The area id that stands for all the areas together, see electionGetTopTribes */
+#define ELECTION_NATIONAL (-1)
+
+/** A breakdown of the memory held by an election, see electionMemoryUsage */
+typedef struct ElectionMemoryUsage_t {
+    MapMemoryUsage tribes;          // the table of the tribe names
+    MapMemoryUsage areas;           // the table of the area names
+    MapMemoryUsage votes;           // the vote matrix, with its sparse rows
+    int largest_vote_row_area;      // the area with the largest vote row, -1 if there are no areas
+    size_t largest_vote_row_bytes;  // the bytes of that vote row
+    size_t total_bytes;             // everything above and the election itself
+} ElectionMemoryUsage;
+
 Election electionCreate();
 
+/**
+* electionCreateWithAllocator: Creates a new empty election which takes all the
+* memory it holds (its tables, the names and the vote matrix) from the given
+* allocator. The map returned by electionComputeAreasToTribesMapping uses the
+* same allocator. Names returned by electionGetTribeName are still allocated
+* with malloc, so they can be freed with free.
+*
+* @param allocator - The allocator to use. It is copied, but its context must
+*       stay valid for as long as the election (and maps computed from it) exist.
+* @return
+*   NULL - if the allocator is NULL or missing a function, or allocations failed.
+*   A new Election in case of success.
+*/
+Election electionCreateWithAllocator(const Allocator* allocator);
+
+/**
+* electionGetAllocator: Returns the allocator an election takes its memory from,
+* for modules that work on the election to take their own memory from it too.
+* It lives in the election, so it is copied by anyone who may outlive it.
+*
+* @return
+*   NULL - if a NULL pointer was sent.
+*   The allocator of the election otherwise.
+*/
+const Allocator* electionGetAllocator(Election election);
+
+/**
+* electionCreateConcurrent: Creates a new empty election, with the default
+* allocator, whose functions may be called from many threads at once.
+* Votes (electionAddVote and electionRemoveVote) of different areas run in
+* parallel, under one of 64 locks the areas are spread over, each on a cache
+* line of its own. Computing a mapping and electionGetTribeName run with them.
+* Adding, renaming and removing tribes and areas, vote batches and
+* electionMemoryUsage run alone, as does a vote that makes an area's votes
+* change their layout. The conditions of electionRemoveAreas and
+* electionRemoveAreasBatch run under that lock, so they must not call back into
+* the election. An allocation failure returns ELECTION_OUT_OF_MEMORY
+* but does not destroy the election, as other threads may still use it.
+* An ingest (see electionIngest.h) still needs the election to itself.
+*
+* @return
+*   NULL - if allocations failed.
+*   A new Election in case of success.
+*/
+Election electionCreateConcurrent();
+
 void electionDestroy(Election election);
 
 ElectionResult electionAddTribe (Election election, int tribe_id, const char* tribe_name);
@@ -38,12 +108,210 @@ ElectionResult electionAddVote (Election election, int area_id, int tribe_id, in
 
 ElectionResult electionRemoveVote(Election election, int area_id, int tribe_id, int num_of_votes);
 
+/**
+* electionAddVotesBatch: Adds a batch of votes, given as parallel arrays, with
+* the same result for every vote as electionAddVote. The votes are checked
+* first, then grouped by area, so every area is looked up once and its votes
+* are added together. Votes of the same area and tribe are added in the order
+* of the batch.
+*
+* @param election - The election to change.
+* @param count - The number of votes in the batch.
+* @param area_ids - The area of every vote.
+* @param tribe_ids - The tribe of every vote.
+* @param num_of_votes - The number of votes of every vote.
+* @param results - Set to the result of every vote, as electionAddVote returns it.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent (nothing is done).
+*   ELECTION_ERROR if count is negative (nothing is done), or any vote failed
+*   (see results, the other votes are added).
+*   ELECTION_OUT_OF_MEMORY if allocations failed (the election is destroyed, as
+*   electionAddVote does).
+*   ELECTION_SUCCESS if every vote was added.
+*/
+ElectionResult electionAddVotesBatch(Election election, int count, const int* area_ids, const int* tribe_ids,
+                                     const int* num_of_votes, ElectionResult* results);
+
+/**
+* electionRemoveVotesBatch: Removes a batch of votes, with the same result for
+* every vote as electionRemoveVote. Works like electionAddVotesBatch.
+*/
+ElectionResult electionRemoveVotesBatch(Election election, int count, const int* area_ids, const int* tribe_ids,
+                                        const int* num_of_votes, ElectionResult* results);
+
 ElectionResult electionSetTribeName (Election election, int tribe_id, const char* tribe_name);
 
+/**
+* electionRemoveTribe: Removes a tribe and its votes in every area, so the
+* mapping never names a removed tribe and a tribe added again with the same id
+* starts without votes. Only the areas the tribe has votes in are visited.
+*/
 ElectionResult electionRemoveTribe (Election election, int tribe_id);
 
 ElectionResult electionRemoveAreas(Election election, AreaConditionFunction should_delete_area);
 
+/**
+* electionRemoveAreasBatch: Removes the areas a condition picks, with their
+* names and votes. The condition is called once, with the ids of all the areas,
+* so it can check them in a tight loop. The areas picked are removed in one
+* sweep over the areas (electionRemoveAreas works the same way).
+* In a concurrent election the condition (of electionRemoveAreas too) runs while
+* the election is locked for the removal, so it must not call functions of the
+* election: they would wait for the removal, which waits for the condition.
+*
+* @param election - The election to remove the areas from.
+* @param should_delete_areas - Fills the mask of the areas to remove.
+* @param context - Passed as is to should_delete_areas.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_OUT_OF_MEMORY if allocations failed (the election is destroyed, as
+*   electionRemoveAreas does).
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionRemoveAreasBatch(Election election, AreaBatchConditionFunction should_delete_areas,
+                                        void* context);
+
+/**
+* electionRemoveAreaRange: Removes the areas with ids from low to high (both
+* included), with their names and votes, as electionRemoveAreasBatch does.
+*
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_ERROR if low is greater than high (nothing is done).
+*   ELECTION_OUT_OF_MEMORY if allocations failed (the election is destroyed).
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionRemoveAreaRange(Election election, int low, int high);
+
 Map electionComputeAreasToTribesMapping (Election election);
 
+/**
+* electionComputeAreasToTribesMappingParallel: Computes the same map as
+* electionComputeAreasToTribesMapping, finding and formatting the winners of
+* the areas on thread_count threads (the calling thread is one of them).
+* The areas are split into tasks of 1024 areas that idle threads steal from
+* busy ones; the map itself is filled on the calling thread. The threads are
+* kept by the election for the next call with the same thread_count, and
+* stopped by electionDestroy. The election must not be changed meanwhile.
+*
+* @param election - The election to compute.
+* @param thread_count - The number of threads, 1 computes it on the calling thread only.
+* @return
+*   NULL if a NULL pointer was sent, thread_count is not positive, or allocations failed.
+*   The map of every area to its winning tribe otherwise.
+*/
+Map electionComputeAreasToTribesMappingParallel(Election election, int thread_count);
+
+/**
+* electionGetTribeTotal: Sets total to the votes of a tribe in all the areas.
+* The totals are kept as votes are added and removed (and as areas are removed),
+* so this is O(1).
+*
+* @param election - The election to read.
+* @param tribe_id - The tribe.
+* @param total - Set to the votes of the tribe.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_INVALID_ID if the id is negative.
+*   ELECTION_TRIBE_NOT_EXIST if the tribe is not in the election.
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionGetTribeTotal(Election election, int tribe_id, long long* total);
+
+/**
+* electionGetAreaTotal: Sets total to the votes of all the tribes in an area,
+* as electionGetTribeTotal does for a tribe. Votes of removed tribes are not counted.
+* @return
+*   ELECTION_AREA_NOT_EXIST if the area is not in the election. Otherwise the
+*   results of electionGetTribeTotal.
+*/
+ElectionResult electionGetAreaTotal(Election election, int area_id, long long* total);
+
+/**
+* electionGetTribeTotals: Sets the totals of many tribes at once, as
+* electionGetTribeTotal does (a concurrent election is locked once).
+*
+* @param election - The election to read.
+* @param count - The number of tribes.
+* @param tribe_ids - The tribes.
+* @param totals - Set to the votes of every tribe, -1 for a tribe that is not
+*       in the election.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_ERROR if count is negative (nothing is set), or a tribe is not in
+*   the election (the other totals are set).
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionGetTribeTotals(Election election, int count, const int* tribe_ids, long long* totals);
+
+/**
+* electionGetAreaTotals: Sets the totals of many areas at once, as
+* electionGetTribeTotals does for tribes.
+*/
+ElectionResult electionGetAreaTotals(Election election, int count, const int* area_ids, long long* totals);
+
+/**
+* electionGetTopTribes: Lists the k tribes with the most votes in an area, or in
+* all the areas together (their totals). The order is the order of the winner:
+* more votes first, then the lower tribe id. Tribes without votes are not
+* listed, so there may be fewer than k.
+* An area with many tribes keeps a tournament tree over its votes as they
+* change, and the list is read off it in O(k log tribes); other areas take one
+* pass over their tribes with votes, O(tribes in the area * log k). The
+* national list is read off standings ordered by the tribes' totals in
+* O(k + log tribes), after the tribes that got or lost votes since the last
+* national query are moved to their places, O(log tribes) each.
+*
+* @param election - The election to read.
+* @param area_id - The area, or ELECTION_NATIONAL.
+* @param k - The most tribes to list.
+* @param tribe_ids - Set to the listed tribes, room for k.
+* @param votes - Set to their votes, room for k.
+* @param count - Set to the number of tribes listed.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_INVALID_ID if the area id is negative (and not ELECTION_NATIONAL).
+*   ELECTION_ERROR if k is negative.
+*   ELECTION_AREA_NOT_EXIST if the area is not in the election.
+*   ELECTION_OUT_OF_MEMORY if allocations failed (the election is not changed).
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionGetTopTribes(Election election, int area_id, int k, int* tribe_ids, long long* votes,
+                                    int* count);
+
+/**
+* electionGetTribeRank: Sets rank to the place of a tribe in an area, or in all
+* the areas together: 1 and the number of tribes with more votes. Tied tribes
+* share a place, and a tribe without votes comes after all the tribes with votes.
+* O(log tribes) nationally (and, as in electionGetTopTribes, O(log tribes) for
+* every tribe whose votes changed since the last national query); in an area
+* with many tribes O(rank * log tribes), in other areas O(tribes in the area).
+*
+* @param election - The election to read.
+* @param area_id - The area, or ELECTION_NATIONAL.
+* @param tribe_id - The tribe.
+* @param rank - Set to the place of the tribe.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_INVALID_ID if an id is negative (and the area is not ELECTION_NATIONAL).
+*   ELECTION_AREA_NOT_EXIST if the area is not in the election.
+*   ELECTION_TRIBE_NOT_EXIST if the tribe is not in the election.
+*   ELECTION_SUCCESS otherwise.
+*/
+ElectionResult electionGetTribeRank(Election election, int area_id, int tribe_id, int* rank);
+
+/**
+* electionMemoryUsage: Returns a breakdown of the memory held by the election:
+* a MapMemoryUsage (payload, structure, slack and allocator overhead estimate)
+* of its tribe and area tables and of its vote matrix, and the area with the
+* largest vote row.
+* Goes over everything the election holds, O(size).
+*
+* @param election - The election to measure.
+* @return
+*   All zeros (and no largest area) if a NULL pointer was sent.
+*   The breakdown otherwise.
+*/
+ElectionMemoryUsage electionMemoryUsage(Election election);
+
 #endif //MTM_ELECTION_H
@@ -0,0 +1,701 @@
+#define _POSIX_C_SOURCE 200809L //needed for read and clock_gettime
+#include "electionIngest.h"
+#include "intMap.h"
+#include "threadPool.h"
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HAS_SWAR_PATH 1
+#else
+#define HAS_SWAR_PATH 0
+#endif
+
+/** The bytes of the read buffer, a CSV line longer than that is malformed */
+#define BUFFER_SIZE (1 << 20)
+/** Bytes after the buffer, so a parser may load a word at any byte of it */
+#define BUFFER_PADDING 16
+/** The votes passed to the election at a time */
+#define INGEST_BATCH 4096
+/** The bytes of a binary record: three 32 bit ints */
+#define RECORD_SIZE 12
+/** The bytes of a task of electionIngestParallel, a whole number of records */
+#define TASK_SIZE (RECORD_SIZE * (1 << 17))
+/** The tasks of every thread in a round of electionIngestParallel, so idle threads can steal some */
+#define ROUND_TASKS_PER_THREAD 4
+/** The bytes electionIngestParallel reads between merges of the shards into the election */
+#define CHECKPOINT_SIZE (1LL << 28)
+/** The bytes of a cache line, the shards of two workers never share one */
+#define CACHE_LINE 64
+/** The most digits of an int */
+#define MAX_INT_DIGITS 10
+#define DECIMAL_BASE 10
+#define NANOSECONDS 1e9
+#define NO_AREA -1
+/** The characters of a word, the SWAR parser takes 8 digits at a time */
+#define WORD_CHARACTERS 8
+#define BYTE_BITS 8
+#define HIGH_NIBBLES 0xF0F0F0F0F0F0F0F0ULL
+#define LOW_NIBBLES 0x0F0F0F0F0F0F0F0FULL
+#define DIGIT_NIBBLES 0x3030303030303030ULL
+/** Added to every byte, '9' + 6 still has the high nibble of a digit and ':' does not */
+#define DIGIT_CARRY 0x0606060606060606ULL
+
+/** Type of a function the parsers pass every record to, returns false if it ran out of memory */
+typedef bool (*RecordFunction)(void* context, int area_id, int tribe_id, int num_of_votes);
+
+//the state of an ingest: the counters, the batch being filled and the read buffer
+typedef struct Ingest_t {
+    Election election;
+    Allocator allocator; //a copy of the election's, the ingest outlives an election that ran out of memory
+    ElectionIngestStats stats;
+    ElectionIngestProgressFunction progress;
+    void* context;
+    struct timespec start;
+    int count; //the votes in the batch
+    int area_ids[INGEST_BATCH];
+    int tribe_ids[INGEST_BATCH];
+    int num_of_votes[INGEST_BATCH];
+    int records[INGEST_BATCH]; //the records behind every vote of the batch, more than 1 for merged tallies
+    ElectionResult results[INGEST_BATCH];
+    char* buffer; //buffer_size bytes and BUFFER_PADDING more
+    size_t buffer_size;
+} Ingest;
+
+//the tallies of one worker of electionIngestParallel: the sum of the votes of every area and
+//tribe its records had, with no sharing between workers
+typedef struct IngestShard_t {
+    const Allocator* allocator; //the ingest's, everything the shard holds is taken from it
+    IntMap areas; //area id -> index in tribes
+    IntMap* tribes; //tribe id -> index in votes and records, for every area
+    int tribes_capacity;
+    int last_area; //the last area of a record and its index in tribes, records of an area tend to come together
+    int last_area_index;
+    int* votes; //votes and records share one block of 2 * entries_capacity ints
+    int* records; //the records behind every tally
+    int entries_capacity;
+    int entry_count;
+    long long record_count; //the counters of the records since the last round
+    long long invalid_records;
+    long long malformed;
+    bool out_of_memory;
+    char padding[CACHE_LINE];
+} IngestShard;
+
+//the state of electionIngestParallel, a round of the buffer is split into tasks of lines or records
+typedef struct ParallelIngest_t {
+    Allocator allocator; //a copy of the election's, as Ingest keeps
+    Ingest* ingest;
+    ElectionIngestFormat format;
+    IngestShard* shards; //a shard for every worker
+    int shard_count;
+    size_t* task_starts; //the tasks of a round: task i is [task_starts[i], task_starts[i + 1]) of the buffer
+    int task_capacity;
+} ParallelIngest;
+
+static void* growArray(const Allocator* allocator, void* array, size_t item_size, int capacity, int new_capacity) {
+    return allocator->reallocate(allocator->context, array, (size_t)capacity * item_size,
+                                 (size_t)new_capacity * item_size);
+}
+
+static void freeArray(const Allocator* allocator, void* array, size_t item_size, int capacity) {
+    if (array != NULL) {
+        allocator->deallocate(allocator->context, array, (size_t)capacity * item_size);
+    }
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / NANOSECONDS;
+}
+
+static void reportProgress(Ingest* ingest) {
+    ingest->stats.seconds = secondsSince(&ingest->start);
+    if (ingest->progress != NULL) {
+        ingest->progress(&ingest->stats, ingest->context);
+    }
+}
+
+//passes the batch to the election and counts its results, every vote for all the records behind it
+static ElectionResult flushBatch(Ingest* ingest) {
+    if (ingest->count == 0) {
+        return ELECTION_SUCCESS;
+    }
+    ElectionResult result = electionAddVotesBatch(ingest->election, ingest->count, ingest->area_ids,
+                                                  ingest->tribe_ids, ingest->num_of_votes, ingest->results);
+    if (result == ELECTION_OUT_OF_MEMORY) { //the election is gone
+        return result;
+    }
+    for (int i = 0; i < ingest->count; i++) {
+        if (ingest->results[i] == ELECTION_SUCCESS) {
+            ingest->stats.votes_added += ingest->records[i];
+        } else {
+            ingest->stats.votes_rejected += ingest->records[i];
+        }
+    }
+    ingest->count = 0;
+    return ELECTION_SUCCESS;
+}
+
+static ElectionResult addVotes(Ingest* ingest, int area_id, int tribe_id, int num_of_votes, int records) {
+    ingest->area_ids[ingest->count] = area_id;
+    ingest->tribe_ids[ingest->count] = tribe_id;
+    ingest->num_of_votes[ingest->count] = num_of_votes;
+    ingest->records[ingest->count++] = records;
+    return ingest->count == INGEST_BATCH ? flushBatch(ingest) : ELECTION_SUCCESS;
+}
+
+//RecordFunction of electionIngestFile: adds a record to the batch, passing full batches on
+static bool addRecord(void* context, int area_id, int tribe_id, int num_of_votes) {
+    Ingest* ingest = context;
+    ingest->stats.records++;
+    if (addVotes(ingest, area_id, tribe_id, num_of_votes, 1) != ELECTION_SUCCESS) {
+        return false;
+    }
+    if (ingest->count == 0) { //a batch was added
+        reportProgress(ingest);
+    }
+    return true;
+}
+
+#if HAS_SWAR_PATH
+//the number of digits at the start of 8 characters loaded into a word (the first one is the low byte)
+static inline int countDigits(uint64_t word) {
+    uint64_t not_digits = ((word & HIGH_NIBBLES) ^ DIGIT_NIBBLES) | (((word + DIGIT_CARRY) & HIGH_NIBBLES) ^ DIGIT_NIBBLES);
+    return not_digits == 0 ? WORD_CHARACTERS : __builtin_ctzll(not_digits) / BYTE_BITS;
+}
+
+//the value of the first count (1 to 8) digits of a word: they are shifted to its top, so the
+//bytes below are leading zeros, and every step joins pairs of neighbours into one number
+static inline int convertDigits(uint64_t word, int count) {
+    uint64_t digits = (word & LOW_NIBBLES) << (BYTE_BITS * (WORD_CHARACTERS - count));
+    digits = ((digits * (10 * 0x100 + 1)) >> 8) & 0x00FF00FF00FF00FFULL;
+    digits = ((digits * (100 * 0x10000 + 1)) >> 16) & 0x0000FFFF0000FFFFULL;
+    return (int)((digits * (10000 * 0x100000000ULL + 1)) >> 32);
+}
+#endif
+
+//parses a decimal int at the cursor, and moves the cursor after it. the text must have
+//BUFFER_PADDING readable bytes after its end
+static bool parseInt(const char** cursor, int* value) {
+    const char* position = *cursor;
+    bool negative = *position == '-';
+    position += negative;
+    long long result = 0;
+    int digits = 0;
+#if HAS_SWAR_PATH
+    uint64_t word;
+    memcpy(&word, position, sizeof(word));
+    digits = countDigits(word);
+    if (digits > 0) {
+        result = convertDigits(word, digits);
+        position += digits;
+    }
+#endif
+    for (; *position >= '0' && *position <= '9'; position++) { //the digits after the first 8, if any
+        if (++digits > MAX_INT_DIGITS) {
+            return false;
+        }
+        result = result * DECIMAL_BASE + (*position - '0');
+    }
+    if (digits == 0 || result > INT_MAX) {
+        return false;
+    }
+    *value = (int)(negative ? -result : result);
+    *cursor = position;
+    return true;
+}
+
+//parses the CSV lines of [position, end), the last one ends with '\n', and passes every vote on.
+//returns false if the function ran out of memory
+static bool parseLines(const char* position, const char* end, RecordFunction function, void* context,
+                       long long* malformed) {
+    while (position < end) {
+        const char* cursor = position;
+        int area_id, tribe_id, num_of_votes;
+        bool parsed = parseInt(&cursor, &area_id) && *cursor++ == ',' && parseInt(&cursor, &tribe_id)
+                      && *cursor++ == ',' && parseInt(&cursor, &num_of_votes);
+        if (parsed && *cursor == '\r') {
+            cursor++;
+        }
+        if (parsed && *cursor == '\n') {
+            if (!function(context, area_id, tribe_id, num_of_votes)) {
+                return false;
+            }
+            position = cursor + 1;
+            continue;
+        }
+        const char* line_end = memchr(position, '\n', end - position);
+        bool empty = line_end == position || (line_end == position + 1 && *position == '\r');
+        if (!empty) {
+            (*malformed)++;
+        }
+        position = line_end + 1;
+    }
+    return true;
+}
+
+//a 32 bit little endian int of a binary record
+static int readRecordInt(const unsigned char* bytes) {
+    uint32_t value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16
+                     | (uint32_t)bytes[3] << 24;
+    return (int)value; //two's complement, as every supported compiler converts it
+}
+
+//passes the votes of the binary records of [record, end) on. returns false if the function ran out of memory
+static bool parseRecords(const unsigned char* record, const unsigned char* end, RecordFunction function,
+                         void* context) {
+    for (; record + RECORD_SIZE <= end; record += RECORD_SIZE) {
+        if (!function(context, readRecordInt(record), readRecordInt(record + sizeof(int32_t)),
+                      readRecordInt(record + 2 * sizeof(int32_t)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//reads into the buffer after the kept bytes. returns the bytes read, -1 if reading failed
+static long long readBlock(Ingest* ingest, int fd, size_t kept) {
+    ssize_t bytes;
+    do {
+        bytes = read(fd, ingest->buffer + kept, ingest->buffer_size - kept);
+    } while (bytes < 0 && errno == EINTR);
+    if (bytes > 0) {
+        ingest->stats.bytes_read += bytes;
+    }
+    return bytes;
+}
+
+//finds the end of the last complete line of the buffer's first size bytes, 0 if it has none
+static size_t lastLineEnd(const Ingest* ingest, size_t size) {
+    while (size > 0 && ingest->buffer[size - 1] != '\n') {
+        size--;
+    }
+    return size;
+}
+
+static ElectionResult ingestCsv(Ingest* ingest, int fd) {
+    size_t kept = 0; //the start of a line that did not fit in the last block
+    bool skipping = false; //inside a line longer than the buffer
+    while (true) {
+        long long bytes = readBlock(ingest, fd, kept);
+        if (bytes < 0) {
+            return ELECTION_ERROR;
+        }
+        size_t size = kept + (size_t)bytes;
+        if (bytes == 0) { //the end of the file, the last line may have no '\n'
+            if (size > 0 && !skipping) {
+                ingest->buffer[size++] = '\n'; //there is room in the padding
+                bool added = parseLines(ingest->buffer, ingest->buffer + size, addRecord, ingest,
+                                        &ingest->stats.malformed);
+                return added ? ELECTION_SUCCESS : ELECTION_OUT_OF_MEMORY;
+            }
+            return ELECTION_SUCCESS;
+        }
+        size_t lines_end = lastLineEnd(ingest, size);
+        if (lines_end == 0) { //no complete line yet
+            if (size == ingest->buffer_size) {
+                ingest->stats.malformed += !skipping;
+                skipping = true;
+                size = 0;
+            }
+            kept = size;
+            continue;
+        }
+        char* first_line = ingest->buffer;
+        if (skipping) { //the rest of the long line
+            first_line = (char*)memchr(first_line, '\n', size) + 1;
+            skipping = false;
+        }
+        if (!parseLines(first_line, ingest->buffer + lines_end, addRecord, ingest, &ingest->stats.malformed)) {
+            return ELECTION_OUT_OF_MEMORY;
+        }
+        kept = size - lines_end;
+        memmove(ingest->buffer, ingest->buffer + lines_end, kept);
+    }
+}
+
+static ElectionResult ingestBinary(Ingest* ingest, int fd) {
+    size_t kept = 0; //the start of a record that did not fit in the last block
+    while (true) {
+        long long bytes = readBlock(ingest, fd, kept);
+        if (bytes < 0) {
+            return ELECTION_ERROR;
+        }
+        if (bytes == 0) {
+            ingest->stats.malformed += kept > 0;
+            return ELECTION_SUCCESS;
+        }
+        size_t size = kept + (size_t)bytes;
+        size_t records_end = size - size % RECORD_SIZE;
+        const unsigned char* buffer = (const unsigned char*)ingest->buffer;
+        if (!parseRecords(buffer, buffer + records_end, addRecord, ingest)) {
+            return ELECTION_OUT_OF_MEMORY;
+        }
+        kept = size - records_end;
+        memmove(ingest->buffer, ingest->buffer + records_end, kept);
+    }
+}
+
+//allocates an ingest with a buffer of buffer_size bytes from the election's allocator. NULL if
+//allocations failed
+static Ingest* createIngest(Election election, size_t buffer_size, ElectionIngestProgressFunction progress,
+                            void* context) {
+    const Allocator* allocator = electionGetAllocator(election);
+    Ingest* ingest = allocator->allocate(allocator->context, sizeof(*ingest));
+    if (ingest == NULL) {
+        return NULL;
+    }
+    ingest->allocator = *allocator;
+    ingest->buffer = allocator->allocate(allocator->context, buffer_size + BUFFER_PADDING);
+    if (ingest->buffer == NULL) {
+        allocator->deallocate(allocator->context, ingest, sizeof(*ingest));
+        return NULL;
+    }
+    memset(ingest->buffer + buffer_size, 0, BUFFER_PADDING);
+    ingest->buffer_size = buffer_size;
+    memset(&ingest->stats, 0, sizeof(ingest->stats));
+    ingest->election = election;
+    ingest->progress = progress;
+    ingest->context = context;
+    ingest->count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ingest->start);
+    return ingest;
+}
+
+static void destroyIngest(Ingest* ingest) {
+    Allocator allocator = ingest->allocator; //the ingest holds the allocator, keep it until the end
+    allocator.deallocate(allocator.context, ingest->buffer, ingest->buffer_size + BUFFER_PADDING);
+    allocator.deallocate(allocator.context, ingest, sizeof(*ingest));
+}
+
+//adds the last batch, reports the counters and deallocates the ingest
+static ElectionResult finishIngest(Ingest* ingest, ElectionResult result, ElectionIngestStats* stats) {
+    if (result != ELECTION_OUT_OF_MEMORY) { //the votes before a read error are added too
+        result = flushBatch(ingest) == ELECTION_SUCCESS ? result : ELECTION_OUT_OF_MEMORY;
+    }
+    if (result != ELECTION_OUT_OF_MEMORY) {
+        reportProgress(ingest);
+    }
+    ingest->stats.seconds = secondsSince(&ingest->start);
+    if (stats != NULL) {
+        *stats = ingest->stats;
+    }
+    destroyIngest(ingest);
+    return result;
+}
+
+ElectionResult electionIngestFile(Election election, int fd, ElectionIngestFormat format, ElectionIngestStats* stats,
+                                  ElectionIngestProgressFunction progress, void* context) {
+    if (election == NULL) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if (format != ELECTION_INGEST_CSV && format != ELECTION_INGEST_BINARY) {
+        return ELECTION_ERROR;
+    }
+    Ingest* ingest = createIngest(election, BUFFER_SIZE, progress, context);
+    if (ingest == NULL) {
+        electionDestroy(election);
+        return ELECTION_OUT_OF_MEMORY;
+    }
+    ElectionResult result = format == ELECTION_INGEST_CSV ? ingestCsv(ingest, fd) : ingestBinary(ingest, fd);
+    return finishIngest(ingest, result, stats);
+}
+
+//returns the index of an area in the tribes of a shard, adding it if needed. -1 if allocations failed
+static int findShardArea(IngestShard* shard, int area_id) {
+    bool inserted = false;
+    int* index = intMapGetOrInsert(shard->areas, area_id, intMapGetSize(shard->areas), &inserted);
+    if (index == NULL || !inserted) {
+        return index == NULL ? NO_AREA : *index;
+    }
+    if (*index == shard->tribes_capacity) {
+        int new_capacity = shard->tribes_capacity > 0 ? 2 * shard->tribes_capacity : INGEST_BATCH;
+        IntMap* tribes = growArray(shard->allocator, shard->tribes, sizeof(*tribes), shard->tribes_capacity,
+                                   new_capacity);
+        if (tribes == NULL) {
+            intMapRemove(shard->areas, area_id);
+            return NO_AREA;
+        }
+        shard->tribes = tribes;
+        shard->tribes_capacity = new_capacity;
+    }
+    shard->tribes[*index] = intMapCreate(shard->allocator);
+    if (shard->tribes[*index] == NULL) {
+        intMapRemove(shard->areas, area_id);
+        return NO_AREA;
+    }
+    return *index;
+}
+
+//RecordFunction of electionIngestParallel: adds a record to the tallies of a shard. votes the
+//election would reject without looking anything up are counted here, the rest when merged
+static bool addShardRecord(void* context, int area_id, int tribe_id, int num_of_votes) {
+    IngestShard* shard = context;
+    shard->record_count++;
+    if (area_id < 0 || tribe_id < 0 || num_of_votes <= 0) {
+        shard->invalid_records++;
+        return true;
+    }
+    if (area_id != shard->last_area) {
+        int index = findShardArea(shard, area_id);
+        if (index == NO_AREA) {
+            return false;
+        }
+        shard->last_area = area_id;
+        shard->last_area_index = index;
+    }
+    bool inserted = false;
+    int* entry = intMapGetOrInsert(shard->tribes[shard->last_area_index], tribe_id, shard->entry_count, &inserted);
+    if (entry == NULL) {
+        return false;
+    }
+    if (inserted) {
+        if (shard->entry_count == shard->entries_capacity) {
+            int new_capacity = shard->entries_capacity > 0 ? 2 * shard->entries_capacity : INGEST_BATCH;
+            int* votes = growArray(shard->allocator, NULL, 2 * sizeof(*votes), 0, new_capacity);
+            if (votes == NULL) {
+                intMapRemove(shard->tribes[shard->last_area_index], tribe_id);
+                return false;
+            }
+            if (shard->votes != NULL) {
+                memcpy(votes, shard->votes, (size_t)shard->entry_count * sizeof(*votes));
+                memcpy(votes + new_capacity, shard->records, (size_t)shard->entry_count * sizeof(*votes));
+                freeArray(shard->allocator, shard->votes, 2 * sizeof(*votes), shard->entries_capacity);
+            }
+            shard->votes = votes;
+            shard->records = votes + new_capacity;
+            shard->entries_capacity = new_capacity;
+        }
+        shard->votes[shard->entry_count] = 0;
+        shard->records[shard->entry_count++] = 0;
+    }
+    shard->votes[*entry] += num_of_votes;
+    shard->records[*entry]++;
+    return true;
+}
+
+//threadPoolRun function: parses a task of a round into the shard of the worker
+static void ingestTask(int task, int worker, void* context) {
+    ParallelIngest* parallel = context;
+    IngestShard* shard = &parallel->shards[worker];
+    if (shard->out_of_memory) {
+        return;
+    }
+    const char* start = parallel->ingest->buffer + parallel->task_starts[task];
+    const char* end = parallel->ingest->buffer + parallel->task_starts[task + 1];
+    bool added = parallel->format == ELECTION_INGEST_CSV
+                 ? parseLines(start, end, addShardRecord, shard, &shard->malformed)
+                 : parseRecords((const unsigned char*)start, (const unsigned char*)end, addShardRecord, shard);
+    shard->out_of_memory = !added;
+}
+
+//splits [first, end) of the buffer into tasks of about TASK_SIZE bytes that start on a line (or
+//a record), and returns their number
+static int splitTasks(ParallelIngest* parallel, size_t first, size_t end) {
+    const char* buffer = parallel->ingest->buffer;
+    int tasks = 0;
+    parallel->task_starts[0] = first;
+    for (size_t target = first + TASK_SIZE; target < end && tasks + 1 < parallel->task_capacity;
+         target += TASK_SIZE) {
+        size_t start = target;
+        if (parallel->format == ELECTION_INGEST_CSV) { //the line after the one target is in
+            start = (const char*)memchr(buffer + target - 1, '\n', end - (target - 1)) + 1 - buffer;
+        }
+        if (start <= parallel->task_starts[tasks]) { //inside a line longer than a task
+            continue;
+        }
+        if (start >= end) {
+            break;
+        }
+        parallel->task_starts[++tasks] = start;
+    }
+    parallel->task_starts[++tasks] = end;
+    return tasks;
+}
+
+//adds the counters of the records parsed by the shards since the last round
+static bool collectShardCounters(ParallelIngest* parallel) {
+    bool out_of_memory = false;
+    for (int i = 0; i < parallel->shard_count; i++) {
+        IngestShard* shard = &parallel->shards[i];
+        parallel->ingest->stats.records += shard->record_count;
+        parallel->ingest->stats.votes_rejected += shard->invalid_records;
+        parallel->ingest->stats.malformed += shard->malformed;
+        shard->record_count = shard->invalid_records = shard->malformed = 0;
+        out_of_memory = out_of_memory || shard->out_of_memory;
+    }
+    return !out_of_memory;
+}
+
+//adds the tallies of every shard to the election, area by area, and empties the shards
+static ElectionResult mergeShards(ParallelIngest* parallel) {
+    Ingest* ingest = parallel->ingest;
+    for (int i = 0; i < parallel->shard_count; i++) {
+        IngestShard* shard = &parallel->shards[i];
+        const int* area_ids;
+        const int* indices;
+        int area_count = intMapGetEntries(shard->areas, &area_ids, &indices);
+        for (int area = 0; area < area_count; area++) {
+            IntMap tribes = shard->tribes[indices[area]];
+            const int* tribe_ids;
+            const int* entries;
+            int tribe_count = intMapGetEntries(tribes, &tribe_ids, &entries);
+            for (int tribe = 0; tribe < tribe_count; tribe++) {
+                if (addVotes(ingest, area_ids[area], tribe_ids[tribe], shard->votes[entries[tribe]],
+                             shard->records[entries[tribe]]) != ELECTION_SUCCESS) {
+                    return ELECTION_OUT_OF_MEMORY;
+                }
+            }
+            intMapClear(tribes); //the area keeps its map for the next checkpoint
+        }
+        shard->entry_count = 0;
+    }
+    return flushBatch(ingest);
+}
+
+//fills the buffer after the kept bytes as far as the file goes. returns the bytes read, -1 if reading failed
+static long long readRound(Ingest* ingest, int fd, size_t kept) {
+    size_t size = kept;
+    while (size < ingest->buffer_size) {
+        long long bytes = readBlock(ingest, fd, size);
+        if (bytes < 0) {
+            return bytes;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        size += (size_t)bytes;
+    }
+    return (long long)(size - kept);
+}
+
+//reads rounds of the buffer, runs the tasks of every round on the pool and merges the shards
+//every CHECKPOINT_SIZE bytes and at the end. if the shards run out of memory the election is
+//destroyed, as it is when it runs out itself
+static ElectionResult ingestRounds(ParallelIngest* parallel, ThreadPool pool, int fd) {
+    Ingest* ingest = parallel->ingest;
+    size_t kept = 0; //the start of a line or a record that did not fit in the last round
+    bool skipping = false; //inside a line longer than the buffer
+    long long checkpoint = CHECKPOINT_SIZE;
+    while (true) {
+        long long bytes = readRound(ingest, fd, kept);
+        if (bytes < 0) { //the votes read before are added
+            return mergeShards(parallel) == ELECTION_SUCCESS ? ELECTION_ERROR : ELECTION_OUT_OF_MEMORY;
+        }
+        bool end_of_file = (size_t)bytes < ingest->buffer_size - kept;
+        size_t size = kept + (size_t)bytes;
+        size_t first = 0, end = size - size % RECORD_SIZE;
+        if (parallel->format == ELECTION_INGEST_CSV) {
+            if (end_of_file && size > 0 && ingest->buffer[size - 1] != '\n' && !skipping) {
+                ingest->buffer[size++] = '\n'; //the last line may have no '\n', there is room in the padding
+            }
+            end = lastLineEnd(ingest, size);
+            if (end == 0 && size == ingest->buffer_size) { //a line longer than the buffer
+                ingest->stats.malformed += !skipping;
+                skipping = true;
+                size = 0;
+            }
+            if (skipping && end > 0) { //the rest of the long line
+                first = (const char*)memchr(ingest->buffer, '\n', end) + 1 - ingest->buffer;
+                skipping = false;
+            }
+        }
+        if (first < end) {
+            threadPoolRun(pool, splitTasks(parallel, first, end), ingestTask, parallel);
+            if (!collectShardCounters(parallel)) {
+                electionDestroy(ingest->election);
+                return ELECTION_OUT_OF_MEMORY;
+            }
+        }
+        kept = size - end;
+        memmove(ingest->buffer, ingest->buffer + end, kept);
+        if (end_of_file) {
+            ingest->stats.malformed += parallel->format == ELECTION_INGEST_BINARY && kept > 0;
+            return mergeShards(parallel);
+        }
+        if (ingest->stats.bytes_read >= checkpoint) {
+            checkpoint += CHECKPOINT_SIZE;
+            if (mergeShards(parallel) != ELECTION_SUCCESS) {
+                return ELECTION_OUT_OF_MEMORY;
+            }
+            reportProgress(ingest);
+        }
+    }
+}
+
+//deallocates the first initialized shards and the array of all shard_count of them
+static void destroyShards(const Allocator* allocator, IngestShard* shards, int initialized, int shard_count) {
+    for (int i = 0; i < initialized; i++) {
+        for (int area = 0; area < intMapGetSize(shards[i].areas); area++) {
+            intMapDestroy(shards[i].tribes[area]);
+        }
+        intMapDestroy(shards[i].areas);
+        freeArray(allocator, shards[i].tribes, sizeof(*shards[i].tribes), shards[i].tribes_capacity);
+        freeArray(allocator, shards[i].votes, 2 * sizeof(*shards[i].votes), shards[i].entries_capacity);
+    }
+    freeArray(allocator, shards, sizeof(*shards), shard_count);
+}
+
+static IngestShard* createShards(const Allocator* allocator, int shard_count) {
+    IngestShard* shards = growArray(allocator, NULL, sizeof(*shards), 0, shard_count);
+    if (shards == NULL) {
+        return NULL;
+    }
+    memset(shards, 0, (size_t)shard_count * sizeof(*shards));
+    for (int i = 0; i < shard_count; i++) {
+        shards[i].allocator = allocator;
+        shards[i].last_area = NO_AREA;
+        shards[i].areas = intMapCreate(allocator);
+        if (shards[i].areas == NULL) {
+            destroyShards(allocator, shards, i, shard_count);
+            return NULL;
+        }
+    }
+    return shards;
+}
+
+ElectionResult electionIngestParallel(Election election, int fd, ElectionIngestFormat format, int thread_count,
+                                      ElectionIngestStats* stats, ElectionIngestProgressFunction progress,
+                                      void* context) {
+    if (election == NULL) {
+        return ELECTION_NULL_ARGUMENT;
+    }
+    if ((format != ELECTION_INGEST_CSV && format != ELECTION_INGEST_BINARY) || thread_count <= 0) {
+        return ELECTION_ERROR;
+    }
+    if (thread_count == 1) {
+        return electionIngestFile(election, fd, format, stats, progress, context);
+    }
+    ParallelIngest parallel;
+    parallel.allocator = *electionGetAllocator(election);
+    parallel.format = format;
+    parallel.shard_count = thread_count;
+    parallel.task_capacity = thread_count * ROUND_TASKS_PER_THREAD + 1;
+    parallel.ingest = createIngest(election, (size_t)TASK_SIZE * (parallel.task_capacity - 1), progress, context);
+    parallel.shards = createShards(&parallel.allocator, thread_count);
+    parallel.task_starts = growArray(&parallel.allocator, NULL, sizeof(*parallel.task_starts), 0,
+                                     parallel.task_capacity);
+    ThreadPool pool = threadPoolCreate(thread_count, &parallel.allocator);
+    bool allocated = parallel.ingest != NULL && parallel.shards != NULL && parallel.task_starts != NULL
+                     && pool != NULL;
+    ElectionResult result = allocated ? ingestRounds(&parallel, pool, fd) : ELECTION_OUT_OF_MEMORY;
+    threadPoolDestroy(pool);
+    freeArray(&parallel.allocator, parallel.task_starts, sizeof(*parallel.task_starts), parallel.task_capacity);
+    if (parallel.shards != NULL) {
+        destroyShards(&parallel.allocator, parallel.shards, thread_count, thread_count);
+    }
+    if (!allocated) {
+        if (parallel.ingest != NULL) {
+            destroyIngest(parallel.ingest);
+        }
+        electionDestroy(election);
+        return ELECTION_OUT_OF_MEMORY;
+    }
+    return finishIngest(parallel.ingest, result, stats);
+}
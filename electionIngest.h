@@ -0,0 +1,93 @@
+#ifndef ELECTION_INGEST_H_
+#define ELECTION_INGEST_H_
+
+#include "election.h"
+/**
+* Election Ingest
+*
+* Loads votes into an election from a file descriptor (a file, or a pipe of a
+* dump as it is produced) in one of two formats:
+*   CSV - a line "area_id,tribe_id,num_of_votes" for every vote ("\r\n" line
+*         ends are fine). Lines that are not three ints are skipped and counted
+*         as malformed, so a header line is simply counted too.
+*   Binary - a record of three 32 bit little endian ints for every vote: the
+*         area, the tribe and the number of votes. A partial record at the end
+*         is counted as malformed.
+* The file is read in large blocks, and the ints of a CSV line are parsed 8
+* digits at a time inside a 64 bit word. The votes are added in batches with
+* electionAddVotesBatch, so every vote gets the result electionAddVote would
+* give it; votes it rejects are counted, not reported.
+* electionIngestParallel parses on many threads: every round, the file is read
+* into a large buffer that is split into tasks at line (or record) bounds, and
+* every worker sums the votes of its tasks into a shard of its own - a tally
+* for every area and tribe it saw. The shards are merged into the election, an
+* area at a time, every 256MB of the file and at its end, so the merge costs
+* the number of distinct areas and tribes, not the number of records.
+* The buffers and the shards are taken from the election's allocator (see
+* electionGetAllocator), like everything else the election holds.
+*
+* The following functions are available:
+*   electionIngestFile		- Adds all the votes of a file to an election.
+*   electionIngestParallel	- Adds all the votes of a file, parsing it on many threads.
+*/
+
+/** The formats electionIngestFile reads */
+typedef enum ElectionIngestFormat_t {
+    ELECTION_INGEST_CSV,
+    ELECTION_INGEST_BINARY
+} ElectionIngestFormat;
+
+/** The counters of an ingest, updated after every batch (every merge for electionIngestParallel) */
+typedef struct ElectionIngestStats_t {
+    long long bytes_read;       // the bytes read from the file so far
+    long long records;          // the votes parsed (and passed to the election)
+    long long votes_added;      // the votes the election added
+    long long votes_rejected;   // the votes the election rejected (invalid ids or votes, missing areas or tribes)
+    long long malformed;        // the lines (or the partial record) that could not be parsed
+    double seconds;             // the time since the ingest started, bytes_read / seconds is the throughput
+} ElectionIngestStats;
+
+/** Type of a function called with the counters after every batch of an ingest */
+typedef void (*ElectionIngestProgressFunction)(const ElectionIngestStats* stats, void* context);
+
+/**
+* electionIngestFile: Reads votes from a file descriptor until its end and adds
+* them to an election. The descriptor is read from its current position and is
+* not closed.
+*
+* @param election - The election to add the votes to.
+* @param fd - The descriptor to read.
+* @param format - The format of the file.
+* @param stats - Set to the counters of the ingest when it ends, may be NULL.
+* @param progress - Called with the counters after every batch, may be NULL.
+* @param context - Passed as is to progress.
+* @return
+*   ELECTION_NULL_ARGUMENT if a NULL election was sent.
+*   ELECTION_ERROR if the format is not known or reading failed (the votes read
+*   before are added).
+*   ELECTION_OUT_OF_MEMORY if allocations failed (the election is destroyed, as
+*   electionAddVote does).
+*   ELECTION_SUCCESS otherwise, also if some votes were malformed or rejected.
+*/
+ElectionResult electionIngestFile(Election election, int fd, ElectionIngestFormat format, ElectionIngestStats* stats,
+                                  ElectionIngestProgressFunction progress, void* context);
+
+/**
+* electionIngestParallel: Reads votes from a file descriptor until its end and
+* adds them to an election, as electionIngestFile does, parsing and summing
+* them on thread_count threads (the calling thread is one of them). Every vote
+* is still counted in the stats as electionIngestFile counts it, but the votes
+* of an area and a tribe are added as their sum, at the next merge, so the
+* election must not be used by anything else until the call returns.
+* progress is called after every merge.
+*
+* @param thread_count - The number of threads, 1 is the same as electionIngestFile.
+* @return
+*   ELECTION_ERROR if thread_count is not positive. Otherwise the results of
+*   electionIngestFile.
+*/
+ElectionResult electionIngestParallel(Election election, int fd, ElectionIngestFormat format, int thread_count,
+                                      ElectionIngestStats* stats, ElectionIngestProgressFunction progress,
+                                      void* context);
+
+#endif /* ELECTION_INGEST_H_ */
@@ -0,0 +1,302 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread and sched_yield
+#include "electionQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+/** The votes the applier takes from the ring and passes to the election at a time */
+#define QUEUE_BATCH 1024
+/** The largest capacity of a ring */
+#define MAX_CAPACITY (1 << 30)
+/** The times an idle applier looks at the ring again before it sleeps */
+#define APPLIER_SPINS 64
+/** The bytes of a cache line. A whole line of padding between two fields keeps them off a shared line
+ * wherever malloc puts the queue */
+#define CACHE_LINE 64
+
+//a place in the ring. sequence tells its state for the position p it is at (p % capacity):
+//p - it is free for the producer of p, p + 1 - it holds the vote of p, p + capacity - the
+//applier took it and it is free for the producer of p + capacity
+typedef struct QueueSlot_t {
+    unsigned long sequence;
+    int area_id;
+    int tribe_id;
+    int num_of_votes;
+    bool remove;
+    ElectionQueueCallback callback;
+    void* context;
+} QueueSlot;
+
+//the fields are grouped by who writes them: the producers read the first group on every vote and it
+//rarely changes, the producers write the second, and the applier writes head for every vote it takes
+struct ElectionQueue_t {
+    Election election;
+    QueueSlot* slots;
+    unsigned long mask; //capacity - 1
+    int capacity;
+    pthread_t applier;
+    int sleeping; //set while the applier sleeps, so producers wake it
+    int stopped; //set once the election ran out of memory
+    char tail_padding[CACHE_LINE];
+    unsigned long tail; //the next position a producer takes, producers race on it
+    unsigned long full; //the votes refused for a full ring
+    char head_padding[CACHE_LINE];
+    unsigned long head; //the next position the applier drains, only the applier uses it
+    char lock_padding[CACHE_LINE];
+    pthread_mutex_t lock; //guards the fields below
+    pthread_cond_t work; //an idle applier sleeps on it
+    pthread_cond_t flushed; //signaled after every batch
+    bool stopping;
+    unsigned long applied;
+    long long rejected;
+    long long batches;
+    int high_water;
+    //the batch being applied, only the applier uses it
+    int area_ids[QUEUE_BATCH];
+    int tribe_ids[QUEUE_BATCH];
+    int num_of_votes[QUEUE_BATCH];
+    bool removes[QUEUE_BATCH];
+    ElectionResult results[QUEUE_BATCH];
+    ElectionQueueCallback callbacks[QUEUE_BATCH];
+    void* contexts[QUEUE_BATCH];
+};
+
+//true if the vote at the head of the ring was published
+static bool headReady(ElectionQueue queue, int memory_order) {
+    QueueSlot* slot = &queue->slots[queue->head & queue->mask];
+    return __atomic_load_n(&slot->sequence, memory_order) == queue->head + 1;
+}
+
+//moves up to QUEUE_BATCH votes from the ring to the batch, freeing their slots, returns their number
+static int drainBatch(ElectionQueue queue) {
+    int count = 0;
+    while (count < QUEUE_BATCH && headReady(queue, __ATOMIC_ACQUIRE)) {
+        QueueSlot* slot = &queue->slots[queue->head & queue->mask];
+        queue->area_ids[count] = slot->area_id;
+        queue->tribe_ids[count] = slot->tribe_id;
+        queue->num_of_votes[count] = slot->num_of_votes;
+        queue->removes[count] = slot->remove;
+        queue->callbacks[count] = slot->callback;
+        queue->contexts[count] = slot->context;
+        __atomic_store_n(&slot->sequence, queue->head + queue->capacity, __ATOMIC_RELEASE);
+        queue->head++;
+        count++;
+    }
+    return count;
+}
+
+//applies the batch to the election in runs of additions and removals, so the order of the votes holds
+static void applyBatch(ElectionQueue queue, int count) {
+    int begin = 0;
+    while (begin < count && !__atomic_load_n(&queue->stopped, __ATOMIC_RELAXED)) {
+        int end = begin + 1;
+        while (end < count && queue->removes[end] == queue->removes[begin]) {
+            end++;
+        }
+        ElectionResult result = (queue->removes[begin] ? electionRemoveVotesBatch : electionAddVotesBatch)
+                (queue->election, end - begin, queue->area_ids + begin, queue->tribe_ids + begin,
+                 queue->num_of_votes + begin, queue->results + begin);
+        if (result == ELECTION_OUT_OF_MEMORY) { //the election may be gone, nothing is applied from here on
+            __atomic_store_n(&queue->stopped, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        begin = end;
+    }
+    for (int i = begin; i < count; i++) {
+        queue->results[i] = ELECTION_OUT_OF_MEMORY;
+    }
+    int rejected = 0;
+    for (int i = 0; i < count; i++) {
+        rejected += queue->results[i] != ELECTION_SUCCESS;
+        if (queue->callbacks[i] != NULL) {
+            queue->callbacks[i](queue->results[i], queue->contexts[i]);
+        }
+    }
+    pthread_mutex_lock(&queue->lock);
+    queue->applied += count;
+    queue->rejected += rejected;
+    queue->batches++;
+    pthread_cond_broadcast(&queue->flushed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+//waits for a vote to be published, returns false if the queue is stopping and the ring is empty
+static bool waitForVotes(ElectionQueue queue) {
+    for (int i = 0; i < APPLIER_SPINS; i++) { //producers often publish again soon, sleeping costs them a wake up
+        if (headReady(queue, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+        sched_yield();
+    }
+    pthread_mutex_lock(&queue->lock);
+    bool stopping = queue->stopping;
+    if (!stopping) {
+        //a producer publishes and then reads sleeping, so either it wakes the applier or the applier sees the vote
+        __atomic_store_n(&queue->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (!headReady(queue, __ATOMIC_SEQ_CST)) {
+            pthread_cond_wait(&queue->work, &queue->lock);
+        }
+        __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return !stopping || headReady(queue, __ATOMIC_ACQUIRE);
+}
+
+static void* applierThread(void* argument) {
+    ElectionQueue queue = argument;
+    do {
+        int depth = (int)(__atomic_load_n(&queue->tail, __ATOMIC_RELAXED) - queue->head);
+        int count = drainBatch(queue);
+        if (count > 0) {
+            if (depth > queue->high_water) { //only the applier writes it, readers take the lock
+                pthread_mutex_lock(&queue->lock);
+                queue->high_water = depth;
+                pthread_mutex_unlock(&queue->lock);
+            }
+            applyBatch(queue, count);
+        }
+    } while (waitForVotes(queue));
+    return NULL;
+}
+
+ElectionQueue electionQueueCreate(Election election, int capacity) {
+    if (election == NULL || capacity <= 0 || capacity > MAX_CAPACITY) {
+        return NULL;
+    }
+    ElectionQueue queue = malloc(sizeof(*queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->capacity = 1;
+    while (queue->capacity < capacity) {
+        queue->capacity *= 2;
+    }
+    queue->slots = malloc(sizeof(*queue->slots) * queue->capacity);
+    if (queue->slots == NULL) {
+        free(queue);
+        return NULL;
+    }
+    for (int i = 0; i < queue->capacity; i++) {
+        queue->slots[i].sequence = i;
+    }
+    queue->election = election;
+    queue->mask = queue->capacity - 1;
+    queue->tail = 0;
+    queue->full = 0;
+    queue->head = 0;
+    queue->sleeping = 0;
+    queue->stopped = 0;
+    queue->stopping = false;
+    queue->applied = 0;
+    queue->rejected = 0;
+    queue->batches = 0;
+    queue->high_water = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->work, NULL);
+    pthread_cond_init(&queue->flushed, NULL);
+    if (pthread_create(&queue->applier, NULL, applierThread, queue) != 0) {
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->work);
+        pthread_cond_destroy(&queue->flushed);
+        free(queue->slots);
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+void electionQueueDestroy(ElectionQueue queue) {
+    if (queue == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = true; //the applier drains the ring before it stops
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->applier, NULL);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->work);
+    pthread_cond_destroy(&queue->flushed);
+    free(queue->slots);
+    free(queue);
+}
+
+//takes a position in the ring and publishes a vote in it
+static ElectionQueueResult submit(ElectionQueue queue, int area_id, int tribe_id, int num_of_votes, bool remove,
+                                  ElectionQueueCallback callback, void* context) {
+    if (queue == NULL) {
+        return ELECTION_QUEUE_NULL_ARGUMENT;
+    }
+    if (__atomic_load_n(&queue->stopped, __ATOMIC_RELAXED)) {
+        return ELECTION_QUEUE_STOPPED;
+    }
+    unsigned long position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    QueueSlot* slot;
+    while (true) {
+        slot = &queue->slots[position & queue->mask];
+        long difference = (long)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - position);
+        if (difference == 0) { //the slot is free, take the position unless another producer did
+            if (__atomic_compare_exchange_n(&queue->tail, &position, position + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) { //the slot still holds the vote of the previous lap
+            __atomic_fetch_add(&queue->full, 1, __ATOMIC_RELAXED);
+            return ELECTION_QUEUE_FULL;
+        } else { //another producer took the position
+            position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+    slot->area_id = area_id;
+    slot->tribe_id = tribe_id;
+    slot->num_of_votes = num_of_votes;
+    slot->remove = remove;
+    slot->callback = callback;
+    slot->context = context;
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_SEQ_CST); //ordered with sleeping, see waitForVotes
+    if (__atomic_load_n(&queue->sleeping, __ATOMIC_SEQ_CST)) { //the only time a producer takes a lock
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->work);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return ELECTION_QUEUE_SUCCESS;
+}
+
+ElectionQueueResult electionSubmitVote(ElectionQueue queue, int area_id, int tribe_id, int num_of_votes,
+                                       ElectionQueueCallback callback, void* context) {
+    return submit(queue, area_id, tribe_id, num_of_votes, false, callback, context);
+}
+
+ElectionQueueResult electionSubmitRemoveVote(ElectionQueue queue, int area_id, int tribe_id, int num_of_votes,
+                                             ElectionQueueCallback callback, void* context) {
+    return submit(queue, area_id, tribe_id, num_of_votes, true, callback, context);
+}
+
+ElectionQueueResult electionQueueFlush(ElectionQueue queue) {
+    if (queue == NULL) {
+        return ELECTION_QUEUE_NULL_ARGUMENT;
+    }
+    unsigned long target = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&queue->lock);
+    while ((long)(queue->applied - target) < 0) {
+        pthread_cond_wait(&queue->flushed, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return __atomic_load_n(&queue->stopped, __ATOMIC_RELAXED) ? ELECTION_QUEUE_STOPPED : ELECTION_QUEUE_SUCCESS;
+}
+
+ElectionQueueResult electionQueueGetStats(ElectionQueue queue, ElectionQueueStats* stats) {
+    if (queue == NULL || stats == NULL) {
+        return ELECTION_QUEUE_NULL_ARGUMENT;
+    }
+    stats->submitted = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    stats->full = __atomic_load_n(&queue->full, __ATOMIC_RELAXED);
+    stats->capacity = queue->capacity;
+    pthread_mutex_lock(&queue->lock);
+    stats->applied = queue->applied;
+    stats->rejected = queue->rejected;
+    stats->batches = queue->batches;
+    stats->high_water = queue->high_water;
+    pthread_mutex_unlock(&queue->lock);
+    return ELECTION_QUEUE_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#ifndef ELECTION_QUEUE_H_
+#define ELECTION_QUEUE_H_
+
+#include "election.h"
+/**
+* Election Queue
+*
+* A front end that lets many threads submit votes to an election without ever
+* waiting for it. Submitted votes go into a bounded ring that threads push to
+* with an atomic compare and swap, with no locks. A thread of the queue, the
+* applier, is the only one that takes them out: it drains the ring in batches
+* of up to 1024 votes and adds them with electionAddVotesBatch and
+* electionRemoveVotesBatch, in the order they were submitted, so the election
+* only ever sees one thread.
+* Every vote can come with a callback that the applier calls with the result
+* the election gave it. A full ring refuses votes (ELECTION_QUEUE_FULL) rather
+* than wait, and counts them, so the producer decides whether to retry, drop or
+* slow down.
+*
+* The following functions are available:
+*   electionQueueCreate		- Creates a queue in front of an election and starts its applier.
+*   electionQueueDestroy	- Applies the votes left, stops the applier and deletes the queue.
+*   electionSubmitVote		- Submits votes to add, without waiting.
+*   electionSubmitRemoveVote	- Submits votes to remove, without waiting.
+*   electionQueueFlush		- Waits until all the votes submitted before are applied.
+*   electionQueueGetStats	- Returns the counters of a queue.
+*/
+
+/** Type for defining the queue */
+typedef struct ElectionQueue_t* ElectionQueue;
+
+/** Type used for returning error codes from queue functions */
+typedef enum ElectionQueueResult_t {
+    ELECTION_QUEUE_SUCCESS,
+    ELECTION_QUEUE_NULL_ARGUMENT,
+    ELECTION_QUEUE_FULL,
+    ELECTION_QUEUE_STOPPED
+} ElectionQueueResult;
+
+/**
+* Type of a function called on the applier thread with the result the election
+* gave a submitted vote (see electionAddVote and electionRemoveVote). It must not
+* wait for the queue, a flush from it never ends.
+*/
+typedef void (*ElectionQueueCallback)(ElectionResult result, void* context);
+
+/** The counters of a queue, see electionQueueGetStats */
+typedef struct ElectionQueueStats_t {
+    long long submitted;    // the votes taken into the ring
+    long long applied;      // the votes the applier passed to the election (or dropped once it stopped)
+    long long rejected;     // of the applied votes, those the election did not accept
+    long long full;         // the votes refused because the ring was full
+    long long batches;      // the batches the applier drained
+    int capacity;           // the votes the ring holds
+    int high_water;         // the most votes that waited in the ring at once
+} ElectionQueueStats;
+
+/**
+* electionQueueCreate: Creates a queue in front of an election and starts its
+* applier thread. Until the queue is destroyed, the election must only be used
+* through it, unless it was created with electionCreateConcurrent.
+*
+* @param election - The election to apply the votes to.
+* @param capacity - The votes the ring holds, rounded up to a power of 2.
+* @return
+*   NULL - if the election is NULL, capacity is not positive or too large, or
+*   allocations or starting the thread failed.
+*   A new ElectionQueue in case of success.
+*/
+ElectionQueue electionQueueCreate(Election election, int capacity);
+
+/**
+* electionQueueDestroy: Applies the votes left in the ring, stops the applier and
+* deallocates the queue. The election is not destroyed. No thread may submit to
+* the queue meanwhile.
+*
+* @param queue - Target queue to be deallocated. If queue is NULL nothing will be done.
+*/
+void electionQueueDestroy(ElectionQueue queue);
+
+/**
+* electionSubmitVote: Submits votes to add to the election, without waiting for
+* the election or for other threads. May be called from any thread.
+*
+* @param queue - The queue to submit to.
+* @param area_id - The area of the votes.
+* @param tribe_id - The tribe of the votes.
+* @param num_of_votes - The number of votes.
+* @param callback - Called with the result of electionAddVote once the votes are
+*       applied, may be NULL.
+* @param context - Passed as is to callback.
+* @return
+*   ELECTION_QUEUE_NULL_ARGUMENT if a NULL queue was sent.
+*   ELECTION_QUEUE_STOPPED if the election ran out of memory, the queue takes no
+*   more votes (the election is destroyed, as electionAddVote does).
+*   ELECTION_QUEUE_FULL if the ring is full, the callback is not called.
+*   ELECTION_QUEUE_SUCCESS otherwise. The ids and votes are checked by the
+*   election when it applies them, their result goes to the callback.
+*/
+ElectionQueueResult electionSubmitVote(ElectionQueue queue, int area_id, int tribe_id, int num_of_votes,
+                                       ElectionQueueCallback callback, void* context);
+
+/**
+* electionSubmitRemoveVote: Submits votes to remove from the election, as
+* electionSubmitVote does. The callback gets the result of electionRemoveVote.
+*/
+ElectionQueueResult electionSubmitRemoveVote(ElectionQueue queue, int area_id, int tribe_id, int num_of_votes,
+                                             ElectionQueueCallback callback, void* context);
+
+/**
+* electionQueueFlush: Waits until every vote submitted before the call (by any
+* thread) is applied and its callback was called. Votes submitted meanwhile may
+* be applied too.
+*
+* @param queue - The queue to flush.
+* @return
+*   ELECTION_QUEUE_NULL_ARGUMENT if a NULL queue was sent.
+*   ELECTION_QUEUE_STOPPED if the election ran out of memory (the votes left
+*   were dropped, with ELECTION_OUT_OF_MEMORY to their callbacks).
+*   ELECTION_QUEUE_SUCCESS otherwise.
+*/
+ElectionQueueResult electionQueueFlush(ElectionQueue queue);
+
+/**
+* electionQueueGetStats: Sets stats to the counters of a queue. The counters are
+* taken while votes flow, so they are only exact after a flush.
+*
+* @return
+*   ELECTION_QUEUE_NULL_ARGUMENT if a NULL pointer was sent.
+*   ELECTION_QUEUE_SUCCESS otherwise.
+*/
+ElectionQueueResult electionQueueGetStats(ElectionQueue queue, ElectionQueueStats* stats);
+
+#endif /* ELECTION_QUEUE_H_ */
@@ -0,0 +1,188 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread
+#include "hash.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+/** The device the seed is read from */
+#define RANDOM_DEVICE "/dev/urandom"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_AES_PATH 1
+#include <wmmintrin.h>
+#else
+#define HAS_AES_PATH 0
+#endif
+
+#define ROTATE_LEFT(x, bits) (((x) << (bits)) | ((x) >> (64 - (bits))))
+
+/*
+ * macro SIP_ROUND:
+ * one round of the SipHash permutation over the four state words.
+ *
+ */
+#define SIP_ROUND(v0, v1, v2, v3) \
+    do { \
+        v0 += v1; v1 = ROTATE_LEFT(v1, 13); v1 ^= v0; v0 = ROTATE_LEFT(v0, 32); \
+        v2 += v3; v3 = ROTATE_LEFT(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTATE_LEFT(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTATE_LEFT(v1, 17); v1 ^= v2; v2 = ROTATE_LEFT(v2, 32); \
+    } while(0)
+    // SIP_ROUND ends here
+
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+static uint64_t process_seed;
+static pthread_once_t short_key_once = PTHREAD_ONCE_INIT;
+//the short key hash picked for this cpu
+static uint32_t (*hash_short_key)(const char* key, size_t length, uint64_t seed);
+
+//spreads the bits of a word (the splitmix64 finalizer)
+static uint64_t mix(uint64_t word) {
+    word ^= word >> 30;
+    word *= 0xbf58476d1ce4e5b9ULL;
+    word ^= word >> 27;
+    word *= 0x94d049bb133111ebULL;
+    return word ^ (word >> 31);
+}
+
+//draws the seed from the system, falling back to the clock and the address space layout
+static void initializeSeed() {
+    uint64_t seed = 0;
+    FILE* device = fopen(RANDOM_DEVICE, "rb");
+    if (device != NULL) {
+        if (fread(&seed, sizeof(seed), 1, device) != 1) {
+            seed = 0;
+        }
+        fclose(device);
+    }
+    if (seed == 0) {
+        seed = mix((uint64_t)time(NULL)) ^ mix((uint64_t)clock()) ^ mix((uint64_t)(uintptr_t)&seed);
+    }
+    process_seed = seed;
+}
+
+static uint32_t hashShortPortable(const char* key, size_t length, uint64_t seed) {
+    return hashBytes(key, length, seed);
+}
+
+static inline uint64_t load64(const char* bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+static inline uint32_t load32(const char* bytes) {
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+//packs a key of up to 16 bytes into two words with overlapping loads, without reading past
+//its end; together with the length the packing is unique
+static inline void packShortKey(const char* key, size_t length, uint64_t* low, uint64_t* high) {
+    if (length >= 8) {
+        *low = load64(key);
+        *high = load64(key + length - 8);
+    } else if (length >= 4) {
+        *low = load32(key) | ((uint64_t)load32(key + length - 4) << 32);
+        *high = 0;
+    } else if (length > 0) {
+        const unsigned char* bytes = (const unsigned char*)key;
+        *low = bytes[0] | ((uint64_t)bytes[length / 2] << 8) | ((uint64_t)bytes[length - 1] << 16);
+        *high = 0;
+    } else {
+        *low = 0;
+        *high = 0;
+    }
+}
+
+#if HAS_AES_PATH
+//the packed key is xored with a round key and the length, and encrypted with
+//three AES rounds (two give full diffusion); the words are folded to 32 bits. the round keys
+//are spread from the seed with odd multipliers, which the rounds diffuse
+__attribute__((target("aes,sse2")))
+static uint32_t hashShortAes(const char* key, size_t length, uint64_t seed) {
+    uint64_t low, high;
+    packShortKey(key, length, &low, &high);
+    __m128i state = _mm_set_epi64x((long long)high, (long long)low);
+    __m128i first_key = _mm_set_epi64x((long long)(seed * 0xbf58476d1ce4e5b9ULL), (long long)(seed ^ length));
+    __m128i second_key = _mm_set_epi64x((long long)(ROTATE_LEFT(seed, 32) * 0x94d049bb133111ebULL),
+                                        (long long)(seed * 0x9e3779b97f4a7c15ULL));
+    state = _mm_xor_si128(state, first_key);
+    state = _mm_aesenc_si128(state, second_key);
+    state = _mm_aesenc_si128(state, first_key);
+    state = _mm_aesenc_si128(state, second_key);
+    uint32_t words[4];
+    _mm_storeu_si128((__m128i*)words, state);
+    return words[0] ^ words[1] ^ words[2] ^ words[3];
+}
+#endif
+
+//hashKey reads the choice without the once, so it is published with a single atomic store
+static void selectShortKeyHash() {
+    uint32_t (*short_key_hash)(const char*, size_t, uint64_t) = hashShortPortable;
+#if HAS_AES_PATH
+    if (__builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2")) {
+        short_key_hash = hashShortAes;
+    }
+#endif
+    __atomic_store_n(&hash_short_key, short_key_hash, __ATOMIC_RELEASE);
+}
+
+uint64_t hashGetSeed() {
+    pthread_once(&seed_once, initializeSeed);
+    return process_seed;
+}
+
+bool hashHasHardwareSupport() {
+    pthread_once(&short_key_once, selectShortKeyHash);
+    return hash_short_key != hashShortPortable;
+}
+
+//reads up to 8 bytes as a little-endian word
+static uint64_t readWord(const unsigned char* bytes, size_t length) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < length; i++) {
+        word |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return word;
+}
+
+uint32_t hashBytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* bytes = data;
+    uint64_t k0 = seed, k1 = mix(seed); //the 128-bit key is derived from the seed
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    size_t whole_words = length / 8;
+    for (size_t i = 0; i < whole_words; i++) {
+        uint64_t word = readWord(bytes + 8 * i, 8);
+        v3 ^= word;
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+    uint64_t last = ((uint64_t)length << 56) | readWord(bytes + 8 * whole_words, length % 8);
+    v3 ^= last;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    uint64_t hash = v0 ^ v1 ^ v2 ^ v3;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+uint32_t hashKey(const char* key, size_t length, uint64_t seed) {
+    if (length <= HASH_SHORT_KEY_LENGTH) {
+        uint32_t (*short_key_hash)(const char*, size_t, uint64_t) = __atomic_load_n(&hash_short_key,
+                                                                                    __ATOMIC_ACQUIRE);
+        if (short_key_hash == NULL) { //the first short key, the path is picked now
+            pthread_once(&short_key_once, selectShortKeyHash);
+            short_key_hash = hash_short_key;
+        }
+        return short_key_hash(key, length, seed);
+    }
+    return hashBytes(key, length, seed);
+}
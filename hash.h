@@ -0,0 +1,68 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+/**
+* Hashing
+*
+* Implements seeded string hashing for the map.
+* Every process draws a random seed the first time it is asked for it, so the
+* bucket of a key can't be predicted from outside the process and an adversary
+* can't prepare colliding keys in advance. Hash tables read the seed once, when
+* they are created, and pass it to every hash, so hashing takes no lock.
+*
+* Most keys are short numeric strings, so keys of up to HASH_SHORT_KEY_LENGTH
+* bytes take a fast path: on CPUs with AES instructions (checked at runtime)
+* the key is hashed as a single block with a few keyed AES rounds. Longer keys,
+* and all keys on other CPUs, are hashed with SipHash.
+*
+* The following functions are available:
+*   hashGetSeed    - Returns the seed of the process.
+*   hashBytes      - Hashes a buffer with a given seed (SipHash-1-3).
+*   hashKey        - Hashes a string with a given seed, short keys on the fast path.
+*   hashHasHardwareSupport - Returns whether short keys use the AES path.
+*/
+
+/** Keys up to this length are hashed by the short key path */
+#define HASH_SHORT_KEY_LENGTH 16
+
+/**
+* hashGetSeed: Returns the random seed of the process, drawing it on the first call.
+*/
+uint64_t hashGetSeed();
+
+/**
+* hashBytes: Hashes a buffer with SipHash-1-3, a keyed hash designed so that
+* collisions can't be found without knowing the key.
+*
+* @param data - The buffer to hash.
+* @param length - The number of bytes to hash.
+* @param seed - The seed to hash with. Different seeds give unrelated hashes.
+* @return
+* 	The 32-bit hash of the buffer.
+*/
+uint32_t hashBytes(const void* data, size_t length, uint64_t seed);
+
+/**
+* hashKey: Hashes a string (without its terminating null) with a seed. Short
+* keys use the fastest path this CPU supports, picked on the first call, so the
+* hash of a key may differ between machines, but never within a process.
+*
+* @param key - The string to hash, must not be NULL.
+* @param length - The length of the string.
+* @param seed - The seed to hash with, usually the one returned by hashGetSeed,
+*       read once by the caller. Different seeds give unrelated hashes.
+* @return
+* 	The 32-bit hash of the string.
+*/
+uint32_t hashKey(const char* key, size_t length, uint64_t seed);
+
+/**
+* hashHasHardwareSupport: Returns true if this CPU hashes short keys with AES
+* instructions, false if they use the portable SipHash path.
+*/
+bool hashHasHardwareSupport();
+
+#endif /* HASH_H_ */
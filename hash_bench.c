@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L //needed for clock_gettime
+#include "hash.h"
+#include "map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/**
+* Micro-benchmarks of the key hashes: the portable SipHash path against the
+* path picked for this CPU, over numeric keys of 1 to 12 digits (the shape of
+* the area and tribe ids), and map lookups on top of them.
+*
+* Usage: hash_bench [number of keys]
+*/
+
+/** The default number of keys */
+#define DEFAULT_KEYS 1000000
+/** Every key set is hashed this many times */
+#define REPEATS 20
+/** The longest key, in digits */
+#define MAX_DIGITS 12
+#define NANOSECONDS_IN_SECOND 1e9
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * NANOSECONDS_IN_SECOND + time.tv_nsec;
+}
+
+//fills keys[i] with numbers whose length cycles through 1 to MAX_DIGITS digits
+static void createKeys(char (*keys)[MAX_DIGITS + 1], int number_of_keys) {
+    unsigned long long state = 88172645463325252ULL;
+    for (int i = 0; i < number_of_keys; i++) {
+        int digits = 1 + i % MAX_DIGITS;
+        for (int digit = 0; digit < digits; digit++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            keys[i][digit] = (char)('0' + state % 10);
+        }
+        keys[i][digits] = '\0';
+    }
+}
+
+static void report(const char* name, double start, int operations, unsigned checksum) {
+    printf("%-24s %8.2f ns/op   (checksum %08x)\n", name, (now() - start) / operations, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    int number_of_keys = argc > 1 ? atoi(argv[1]) : DEFAULT_KEYS;
+    if (number_of_keys <= 0) {
+        fprintf(stderr, "Usage: hash_bench [number of keys]\n");
+        return 1;
+    }
+    char (*keys)[MAX_DIGITS + 1] = malloc((size_t)number_of_keys * sizeof(*keys));
+    size_t* lengths = malloc((size_t)number_of_keys * sizeof(*lengths));
+    if (keys == NULL || lengths == NULL) {
+        free(keys);
+        free(lengths);
+        return 1;
+    }
+    createKeys(keys, number_of_keys);
+    for (int i = 0; i < number_of_keys; i++) {
+        lengths[i] = strlen(keys[i]);
+    }
+    printf("%d keys, short keys use the %s path\n", number_of_keys,
+           hashHasHardwareSupport() ? "AES" : "portable");
+
+    uint64_t seed = hashGetSeed();
+    unsigned checksum = 0;
+    double start = now();
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        for (int i = 0; i < number_of_keys; i++) {
+            checksum += hashBytes(keys[i], lengths[i], seed);
+        }
+    }
+    report("scalar (SipHash-1-3)", start, REPEATS * number_of_keys, checksum);
+
+    checksum = 0;
+    start = now();
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        for (int i = 0; i < number_of_keys; i++) {
+            checksum += hashKey(keys[i], lengths[i], seed);
+        }
+    }
+    report("hashKey (dispatched)", start, REPEATS * number_of_keys, checksum);
+
+    Map map = mapCreate();
+    if (map == NULL) {
+        free(keys);
+        free(lengths);
+        return 1;
+    }
+    start = now();
+    for (int i = 0; i < number_of_keys; i++) {
+        mapPut(map, keys[i], keys[i]);
+    }
+    report("mapPut", start, number_of_keys, (unsigned)mapGetSize(map));
+    checksum = 0;
+    start = now();
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        for (int i = 0; i < number_of_keys; i++) {
+            checksum += mapGet(map, keys[i])[0];
+        }
+    }
+    report("mapGet", start, REPEATS * number_of_keys, checksum);
+    MapHashStats stats = mapGetHashStats(map);
+    printf("buckets %d, longest chain %d, tree buckets %d\n",
+           stats.buckets, stats.longest_chain, stats.tree_buckets);
+    mapDestroy(map);
+    free(keys);
+    free(lengths);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include "idTable.h"
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+/** The initial number of items the arrays can hold */
+#define INITIAL_SIZE 8
+/** The factor by which to expand the arrays when needed */
+#define EXPAND_FACTOR 2
+#define ELEMENT_NOT_FOUND -1
+/** The positions marked by every word of a bitmask */
+#define MARK_BITS 64
+
+//the items are kept contiguous, positions maps every id to its place in the arrays
+struct IdTable_t {
+    Allocator allocator; //a copy of the allocator the table is taken from
+    IntMap positions;
+    int* ids;
+    void** items;
+    int ids_capacity;
+    int items_capacity;
+    int size;
+    int max_size; //the number of items both arrays can hold
+};
+
+static void* growArray(IdTable table, void* array, size_t item_size, int capacity, int new_capacity) {
+    return table->allocator.reallocate(table->allocator.context, array, (size_t)capacity * item_size,
+                                       (size_t)new_capacity * item_size);
+}
+
+//grows the arrays to hold new_size items. every array tracks its own capacity, so a
+//failed expand leaves them valid
+static IdTableResult reserve(IdTable table, int new_size) {
+    if (table->ids_capacity < new_size) {
+        int* ids = growArray(table, table->ids, sizeof(*ids), table->ids_capacity, new_size);
+        if (ids == NULL) {
+            return ID_TABLE_OUT_OF_MEMORY;
+        }
+        table->ids = ids;
+        table->ids_capacity = new_size;
+    }
+    if (table->items_capacity < new_size) {
+        void** items = growArray(table, table->items, sizeof(*items), table->items_capacity, new_size);
+        if (items == NULL) {
+            return ID_TABLE_OUT_OF_MEMORY;
+        }
+        table->items = items;
+        table->items_capacity = new_size;
+    }
+    table->max_size = new_size;
+    return ID_TABLE_SUCCESS;
+}
+
+IdTable idTableCreate(const Allocator* allocator) {
+    if (!allocatorIsValid(allocator)) {
+        return NULL;
+    }
+    IdTable table = allocator->allocate(allocator->context, sizeof(*table));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->allocator = *allocator;
+    table->ids = NULL;
+    table->items = NULL;
+    table->ids_capacity = 0;
+    table->items_capacity = 0;
+    table->size = 0;
+    table->max_size = 0;
+    table->positions = intMapCreate(allocator);
+    if (table->positions == NULL || reserve(table, INITIAL_SIZE) != ID_TABLE_SUCCESS) {
+        idTableDestroy(table);
+        return NULL;
+    }
+    return table;
+}
+
+void idTableDestroy(IdTable table) {
+    if (table == NULL) {
+        return;
+    }
+    Allocator allocator = table->allocator; //the table holds the allocator, keep it until the end
+    intMapDestroy(table->positions);
+    if (table->ids != NULL) {
+        allocator.deallocate(allocator.context, table->ids, (size_t)table->ids_capacity * sizeof(*table->ids));
+    }
+    if (table->items != NULL) {
+        allocator.deallocate(allocator.context, table->items,
+                             (size_t)table->items_capacity * sizeof(*table->items));
+    }
+    allocator.deallocate(allocator.context, table, sizeof(*table));
+}
+
+int idTableGetSize(IdTable table) {
+    if (table == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    return table->size;
+}
+
+void* idTableGet(IdTable table, int id) {
+    if (table == NULL) {
+        return NULL;
+    }
+    int* position = intMapGet(table->positions, id);
+    return position == NULL ? NULL : table->items[*position];
+}
+
+IdTableResult idTableAdd(IdTable table, int id, void* item) {
+    if (table == NULL || item == NULL) {
+        return ID_TABLE_NULL_ARGUMENT;
+    }
+    if (table->size == table->max_size) {
+        if (reserve(table, EXPAND_FACTOR * table->max_size) != ID_TABLE_SUCCESS) {
+            return ID_TABLE_OUT_OF_MEMORY;
+        }
+    }
+    bool inserted = false;
+    int* position = intMapGetOrInsert(table->positions, id, table->size, &inserted);
+    if (position == NULL) {
+        return ID_TABLE_OUT_OF_MEMORY;
+    }
+    if (!inserted) {
+        return ID_TABLE_ID_ALREADY_EXISTS;
+    }
+    table->ids[table->size] = id;
+    table->items[table->size] = item;
+    table->size++;
+    return ID_TABLE_SUCCESS;
+}
+
+IdTableResult idTableSet(IdTable table, int id, void* item, void** previous) {
+    if (table == NULL || item == NULL) {
+        return ID_TABLE_NULL_ARGUMENT;
+    }
+    int* position = intMapGet(table->positions, id);
+    if (position == NULL) {
+        return ID_TABLE_ID_DOES_NOT_EXIST;
+    }
+    if (previous != NULL) {
+        *previous = table->items[*position];
+    }
+    table->items[*position] = item;
+    return ID_TABLE_SUCCESS;
+}
+
+void* idTableRemove(IdTable table, int id) {
+    if (table == NULL) {
+        return NULL;
+    }
+    int* position_pointer = intMapGet(table->positions, id);
+    if (position_pointer == NULL) {
+        return NULL;
+    }
+    int position = *position_pointer;
+    void* item = table->items[position];
+    intMapRemove(table->positions, id);
+    int last = --table->size;
+    if (position != last) { //the last item fills the gap
+        table->ids[position] = table->ids[last];
+        table->items[position] = table->items[last];
+        *intMapGet(table->positions, table->ids[position]) = position;
+    }
+    return item;
+}
+
+int idTableRemoveMarked(IdTable table, const uint64_t* marks) {
+    if (table == NULL || marks == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    int kept = 0;
+    for (int i = 0; i < table->size; i++) {
+        if ((marks[i / MARK_BITS] >> (i % MARK_BITS)) & 1) {
+            intMapRemove(table->positions, table->ids[i]);
+            continue;
+        }
+        if (kept != i) { //slides down over the removed items
+            table->ids[kept] = table->ids[i];
+            table->items[kept] = table->items[i];
+            *intMapGet(table->positions, table->ids[kept]) = kept;
+        }
+        kept++;
+    }
+    int removed = table->size - kept;
+    table->size = kept;
+    return removed;
+}
+
+int idTableGetEntries(IdTable table, const int** ids, void* const** items) {
+    if (table == NULL || ids == NULL || items == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    *ids = table->ids;
+    *items = table->items;
+    return table->size;
+}
+
+MapMemoryUsage idTableMemoryUsage(IdTable table) {
+    MapMemoryUsage usage = {0, 0, 0, 0, 0};
+    if (table == NULL) {
+        return usage;
+    }
+    usage = intMapMemoryUsage(table->positions);
+    size_t ids_size = (size_t)table->ids_capacity * sizeof(*table->ids);
+    size_t items_size = (size_t)table->items_capacity * sizeof(*table->items);
+    size_t used_size = (size_t)table->size * (sizeof(*table->ids) + sizeof(*table->items));
+    usage.payload_bytes += used_size;
+    usage.structure_bytes += sizeof(*table) + ids_size + items_size - used_size;
+    usage.slack_bytes += ids_size + items_size - used_size;
+    usage.overhead_bytes += allocatorEstimateOverhead(&table->allocator, table, sizeof(*table))
+                            + allocatorEstimateOverhead(&table->allocator, table->ids, ids_size)
+                            + allocatorEstimateOverhead(&table->allocator, table->items, items_size);
+    usage.total_bytes = usage.payload_bytes + usage.structure_bytes + usage.overhead_bytes;
+    return usage;
+}
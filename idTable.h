@@ -0,0 +1,137 @@
+#ifndef ID_TABLE_H_
+#define ID_TABLE_H_
+
+#include "intMap.h"
+#include <stdbool.h>
+#include <stdint.h>
+/**
+* Id Table
+*
+* Implements a table of items (any pointers) by non-negative integer id, for
+* the election's tribes and areas.
+* The ids and the items are kept in dense arrays (which can be exposed with
+* idTableGetEntries), and an IntMap from id to position finds them in O(1).
+* Removing an item moves the last item into its place; removing many at once
+* compacts the arrays in one sweep instead.
+* The table doesn't own its items: whoever adds an item deallocates it after
+* it is removed (or before the table is destroyed).
+*
+* The following functions are available:
+*   idTableCreate		- Creates a new empty table.
+*   idTableDestroy		- Deletes an existing table (not its items).
+*   idTableGetSize		- Returns the number of items in a table.
+*   idTableGet			- Returns the item of an id.
+*   idTableAdd			- Adds an item with a new id.
+*   idTableSet			- Replaces the item of an existing id.
+*   idTableRemove		- Removes an id and returns its item.
+*   idTableRemoveMarked	- Removes the items marked in a bitmask, in one sweep.
+*   idTableGetEntries	- Exposes the ids and the items as read-only arrays.
+*   idTableMemoryUsage	- Returns a breakdown of the memory the table holds.
+*/
+
+/** Type for defining the id table */
+typedef struct IdTable_t* IdTable;
+
+/** Type used for returning error codes from id table functions */
+typedef enum IdTableResult_t {
+    ID_TABLE_SUCCESS,
+    ID_TABLE_OUT_OF_MEMORY,
+    ID_TABLE_NULL_ARGUMENT,
+    ID_TABLE_ID_ALREADY_EXISTS,
+    ID_TABLE_ID_DOES_NOT_EXIST
+} IdTableResult;
+
+/**
+* idTableCreate: Allocates a new empty table.
+*
+* @param allocator - The allocator to take the table from.
+* @return
+* 	NULL - if the allocator is not valid or allocations failed.
+* 	A new IdTable in case of success.
+*/
+IdTable idTableCreate(const Allocator* allocator);
+
+/**
+* idTableDestroy: Deallocates an existing table, but not its items.
+*
+* @param table - Target table to be deallocated. If table is NULL nothing will be done.
+*/
+void idTableDestroy(IdTable table);
+
+/**
+* idTableGetSize: Returns the number of items in a table, -1 if a NULL pointer was sent.
+*/
+int idTableGetSize(IdTable table);
+
+/**
+* idTableGet: Returns the item of an id, NULL if a NULL pointer was sent or the id is not in the table.
+*/
+void* idTableGet(IdTable table, int id);
+
+/**
+* idTableAdd: Adds an item with an id that is not in the table yet. The id is looked up once.
+*
+* @param table - The table to add to.
+* @param id - The id of the item.
+* @param item - The item, must not be NULL.
+* @return
+* 	ID_TABLE_NULL_ARGUMENT if a NULL pointer was sent.
+* 	ID_TABLE_ID_ALREADY_EXISTS if the id is in the table already.
+* 	ID_TABLE_OUT_OF_MEMORY if an allocation failed (the table is left as it was).
+* 	ID_TABLE_SUCCESS otherwise.
+*/
+IdTableResult idTableAdd(IdTable table, int id, void* item);
+
+/**
+* idTableSet: Replaces the item of an id that is in the table.
+*
+* @param table - The table to change.
+* @param id - The id of the item.
+* @param item - The new item, must not be NULL.
+* @param previous - If not NULL, set to the item that was replaced.
+* @return
+* 	ID_TABLE_NULL_ARGUMENT if a NULL pointer was sent (other than previous).
+* 	ID_TABLE_ID_DOES_NOT_EXIST if the id is not in the table.
+* 	ID_TABLE_SUCCESS otherwise.
+*/
+IdTableResult idTableSet(IdTable table, int id, void* item, void** previous);
+
+/**
+* idTableRemove: Removes an id from the table. The last item takes its place.
+*
+* @return
+* 	NULL if a NULL pointer was sent or the id is not in the table.
+* 	The item that was removed otherwise.
+*/
+void* idTableRemove(IdTable table, int id);
+
+/**
+* idTableRemoveMarked: Removes the items whose positions in the arrays of
+* idTableGetEntries are marked: position i is marked if bit i % 64 of
+* marks[i / 64] is set. The items left keep their order. The removed items are
+* not deallocated, take them from idTableGetEntries before the call.
+*
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	The number of items removed otherwise.
+*/
+int idTableRemoveMarked(IdTable table, const uint64_t* marks);
+
+/**
+* idTableGetEntries: Exposes the ids and the items of the table as read-only
+* arrays; ids[i] and items[i] belong together. The arrays are valid until the
+* next change of the table.
+*
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	The number of items in the arrays otherwise.
+*/
+int idTableGetEntries(IdTable table, const int** ids, void* const** items);
+
+/**
+* idTableMemoryUsage: Returns a breakdown of the memory held by the table
+* itself (its items are not counted). See mapMemoryUsage.
+*/
+MapMemoryUsage idTableMemoryUsage(IdTable table);
+
+#endif /* ID_TABLE_H_ */
@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L //needed for clock_gettime, fileno and lseek
+#include "electionIngest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+/**
+* Benchmark of the vote ingest: electionIngestFile against electionIngestParallel
+* on 1 to 8 threads, over a CSV and a binary file of random votes (the shape of
+* an election night dump), checking that every run computes the same mapping.
+*
+* Usage: ingest_bench [number of votes]
+*/
+
+/** The default number of votes */
+#define DEFAULT_VOTES 10000000
+#define AREAS 20000
+#define TRIBES 200
+#define MAX_VOTES 1000
+#define MAX_THREADS 8
+#define RECORD_INTS 3
+#define NANOSECONDS_IN_SECOND 1e9
+#define BYTES_IN_MEGABYTE 1e6
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / NANOSECONDS_IN_SECOND;
+}
+
+static Election createElection() {
+    Election election = electionCreate();
+    for (int tribe = 0; tribe < TRIBES; tribe++) {
+        electionAddTribe(election, tribe, "tribe");
+    }
+    for (int area = 0; area < AREAS; area++) {
+        electionAddArea(election, area, "area");
+    }
+    return election;
+}
+
+//writes number_of_votes random votes to a temporary file, the areas in runs as dumps have them
+static FILE* createVoteFile(int number_of_votes, ElectionIngestFormat format) {
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned long long state = 88172645463325252ULL;
+    for (int i = 0; i < number_of_votes; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int vote[RECORD_INTS] = { (int)((long long)i * AREAS / number_of_votes), (int)(state % TRIBES),
+                                  (int)(state / TRIBES % MAX_VOTES) + 1 };
+        if (format == ELECTION_INGEST_CSV) {
+            fprintf(file, "%d,%d,%d\n", vote[0], vote[1], vote[2]);
+        } else {
+            fwrite(vote, sizeof(int), RECORD_INTS, file); //a little endian machine is assumed
+        }
+    }
+    fflush(file);
+    return file;
+}
+
+//checks that two mappings have the same areas and winners
+static bool sameMapping(Map first, Map second) {
+    if (first == NULL || second == NULL || mapGetSize(first) != mapGetSize(second)) {
+        return false;
+    }
+    MAP_FOREACH(area, first) {
+        char* winner = mapGet(second, area);
+        if (winner == NULL || strcmp(winner, mapGet(first, area)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//ingests the file with thread_count threads (0 for electionIngestFile), and prints the time it took
+static bool benchmark(FILE* file, ElectionIngestFormat format, int thread_count, Map* expected) {
+    Election election = createElection();
+    lseek(fileno(file), 0, SEEK_SET);
+    ElectionIngestStats stats;
+    double start = now();
+    ElectionResult result = thread_count == 0
+                            ? electionIngestFile(election, fileno(file), format, &stats, NULL, NULL)
+                            : electionIngestParallel(election, fileno(file), format, thread_count, &stats,
+                                                     NULL, NULL);
+    double seconds = now() - start;
+    if (result != ELECTION_SUCCESS) {
+        return false;
+    }
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    bool same = *expected == NULL || sameMapping(*expected, mapping);
+    printf("%-8s %-10s %2d threads %8.3f s %9.1f MB/s %7.2f Mvotes/s%s\n",
+           format == ELECTION_INGEST_CSV ? "csv" : "binary", thread_count == 0 ? "sequential" : "parallel",
+           thread_count == 0 ? 1 : thread_count, seconds, stats.bytes_read / seconds / BYTES_IN_MEGABYTE,
+           stats.votes_added / seconds / BYTES_IN_MEGABYTE, same ? "" : "   DIFFERENT MAPPING");
+    if (*expected == NULL) {
+        *expected = mapping;
+    } else {
+        mapDestroy(mapping);
+    }
+    electionDestroy(election);
+    return same;
+}
+
+int main(int argc, char* argv[]) {
+    int number_of_votes = argc > 1 ? atoi(argv[1]) : DEFAULT_VOTES;
+    if (number_of_votes <= 0) {
+        fprintf(stderr, "Usage: ingest_bench [number of votes]\n");
+        return 1;
+    }
+    ElectionIngestFormat formats[] = { ELECTION_INGEST_CSV, ELECTION_INGEST_BINARY };
+    bool same = true;
+    for (int i = 0; i < (int)(sizeof(formats) / sizeof(*formats)); i++) {
+        FILE* file = createVoteFile(number_of_votes, formats[i]);
+        if (file == NULL) {
+            return 1;
+        }
+        Map expected = NULL;
+        same = benchmark(file, formats[i], 0, &expected) && same;
+        for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+            same = benchmark(file, formats[i], threads, &expected) && same;
+        }
+        mapDestroy(expected);
+        fclose(file);
+    }
+    return same ? 0 : 1;
+}
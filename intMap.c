@@ -0,0 +1,292 @@
+#include "intMap.h"
+#include "hash.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+/** The initial number of elements the arrays can hold */
+#define INITIAL_SIZE 8
+/** The factor by which to expand the arrays when needed */
+#define EXPAND_FACTOR 2
+/** An index slot which holds no element */
+#define EMPTY_SLOT -1
+/** A new key probing further than this from its home slot makes the index draw a new multiplier */
+#define MAX_PROBE_LENGTH 128
+
+//the elements are kept contiguous: keys[i] and values[i] form the i-th element.
+//the index has at least twice as many slots as the arrays have room for elements,
+//so a probe always ends at an empty slot quickly
+struct IntMap_t {
+    Allocator allocator; //a copy of the allocator the map is taken from
+    int* keys; //keys and values share one block of 2 * max_size ints
+    int* values;
+    int size;
+    int max_size;
+    int* slots; //the index of the element of every slot, or EMPTY_SLOT
+    int slot_count; //a power of 2
+    int slot_shift; //64 - log2(slot_count), the hash keeps the high bits of the product
+    uint64_t seed;
+    uint64_t multiplier; //odd and secret: drawn from the seed, so keys can't be chosen to collide
+};
+
+//multiply-shift with a random odd multiplier: any two keys share a slot with probability
+//2 / slot_count, whatever keys were chosen, as long as the multiplier isn't known
+static inline int slotOf(IntMap map, int key) {
+    return (int)(((uint64_t)(unsigned)key * map->multiplier) >> map->slot_shift);
+}
+
+//draws a new multiplier, keyed by the seed of the process and unrelated to the one before
+static void drawMultiplier(IntMap map) {
+    uint64_t previous = map->multiplier;
+    uint64_t high = hashBytes(&previous, sizeof(previous), map->seed);
+    uint64_t low = hashBytes(&previous, sizeof(previous), ~map->seed);
+    map->multiplier = (high << 32 | low) | 1;
+}
+
+//the slot that holds the key, or the empty slot where it would be added
+static int findSlot(IntMap map, int key) {
+    int mask = map->slot_count - 1;
+    int slot = slotOf(map, key);
+    while (map->slots[slot] != EMPTY_SLOT && map->keys[map->slots[slot]] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+//rebuilds the index with a new number of slots
+static IntMapResult rehash(IntMap map, int slot_count) {
+    int* slots = map->allocator.allocate(map->allocator.context, (size_t)slot_count * sizeof(*slots));
+    if (slots == NULL) {
+        return INT_MAP_OUT_OF_MEMORY;
+    }
+    if (map->slots != NULL) {
+        map->allocator.deallocate(map->allocator.context, map->slots, (size_t)map->slot_count * sizeof(*slots));
+    }
+    map->slots = slots;
+    map->slot_count = slot_count;
+    map->slot_shift = 64;
+    while (slot_count > 1) {
+        map->slot_shift--;
+        slot_count /= 2;
+    }
+    for (int slot = 0; slot < map->slot_count; slot++) {
+        slots[slot] = EMPTY_SLOT;
+    }
+    for (int i = 0; i < map->size; i++) {
+        slots[findSlot(map, map->keys[i])] = i;
+    }
+    return INT_MAP_SUCCESS;
+}
+
+//grows the arrays (and the index) to hold new_size elements
+static IntMapResult reserve(IntMap map, int new_size) {
+    if (map->slot_count < 2 * new_size) {
+        int slot_count = map->slot_count > 0 ? map->slot_count : 1;
+        while (slot_count < 2 * new_size) {
+            slot_count *= 2;
+        }
+        if (rehash(map, slot_count) == INT_MAP_OUT_OF_MEMORY) {
+            return INT_MAP_OUT_OF_MEMORY;
+        }
+    }
+    int* block = map->allocator.allocate(map->allocator.context, 2 * (size_t)new_size * sizeof(*block));
+    if (block == NULL) {
+        return INT_MAP_OUT_OF_MEMORY;
+    }
+    if (map->keys != NULL) {
+        memcpy(block, map->keys, (size_t)map->size * sizeof(*block));
+        memcpy(block + new_size, map->values, (size_t)map->size * sizeof(*block));
+        map->allocator.deallocate(map->allocator.context, map->keys, 2 * (size_t)map->max_size * sizeof(*block));
+    }
+    map->keys = block;
+    map->values = block + new_size;
+    map->max_size = new_size;
+    return INT_MAP_SUCCESS;
+}
+
+//adds a new key at the empty slot found for it, returns its index or -1 if allocations failed
+static int insertAt(IntMap map, int slot, int key, int value) {
+    if (map->size == map->max_size) {
+        if (reserve(map, EXPAND_FACTOR * map->max_size) == INT_MAP_OUT_OF_MEMORY) {
+            return EMPTY_SLOT;
+        }
+        slot = findSlot(map, key); //the index was rebuilt
+    }
+    int index = map->size++;
+    map->keys[index] = key;
+    map->values[index] = value;
+    map->slots[slot] = index;
+    if (((slot - slotOf(map, key)) & (map->slot_count - 1)) > MAX_PROBE_LENGTH) { //keys found the multiplier
+        uint64_t multiplier = map->multiplier;
+        drawMultiplier(map);
+        if (rehash(map, map->slot_count) == INT_MAP_OUT_OF_MEMORY) {
+            map->multiplier = multiplier; //the index was left as it was, and still finds every key
+        }
+    }
+    return index;
+}
+
+IntMap intMapCreate(const Allocator* allocator) {
+    if (!allocatorIsValid(allocator)) {
+        return NULL;
+    }
+    IntMap map = allocator->allocate(allocator->context, sizeof(*map));
+    if (map == NULL) {
+        return NULL;
+    }
+    map->allocator = *allocator;
+    map->keys = NULL;
+    map->values = NULL;
+    map->size = 0;
+    map->max_size = 0;
+    map->slots = NULL;
+    map->slot_count = 0;
+    map->slot_shift = 64;
+    map->seed = hashGetSeed();
+    map->multiplier = 0;
+    drawMultiplier(map);
+    if (reserve(map, INITIAL_SIZE) == INT_MAP_OUT_OF_MEMORY) {
+        intMapDestroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+void intMapDestroy(IntMap map) {
+    if (map == NULL) {
+        return;
+    }
+    Allocator allocator = map->allocator; //the map holds the allocator, keep it until the end
+    if (map->keys != NULL) {
+        allocator.deallocate(allocator.context, map->keys, 2 * (size_t)map->max_size * sizeof(*map->keys));
+    }
+    if (map->slots != NULL) {
+        allocator.deallocate(allocator.context, map->slots, (size_t)map->slot_count * sizeof(*map->slots));
+    }
+    allocator.deallocate(allocator.context, map, sizeof(*map));
+}
+
+int intMapGetSize(IntMap map) {
+    if (map == NULL) {
+        return EMPTY_SLOT;
+    }
+    return map->size;
+}
+
+bool intMapContains(IntMap map, int key) {
+    return intMapGet(map, key) != NULL;
+}
+
+int* intMapGet(IntMap map, int key) {
+    if (map == NULL) {
+        return NULL;
+    }
+    int index = map->slots[findSlot(map, key)];
+    return index == EMPTY_SLOT ? NULL : &map->values[index];
+}
+
+IntMapResult intMapPut(IntMap map, int key, int value) {
+    if (map == NULL) {
+        return INT_MAP_NULL_ARGUMENT;
+    }
+    int* slot_value = intMapGetOrInsert(map, key, value, NULL);
+    if (slot_value == NULL) {
+        return INT_MAP_OUT_OF_MEMORY;
+    }
+    *slot_value = value;
+    return INT_MAP_SUCCESS;
+}
+
+int* intMapGetOrInsert(IntMap map, int key, int default_value, bool* inserted) {
+    if (map == NULL) {
+        return NULL;
+    }
+    int slot = findSlot(map, key);
+    int index = map->slots[slot];
+    bool is_new = index == EMPTY_SLOT;
+    if (is_new) {
+        index = insertAt(map, slot, key, default_value);
+        if (index == EMPTY_SLOT) {
+            return NULL;
+        }
+    }
+    if (inserted != NULL) {
+        *inserted = is_new;
+    }
+    return &map->values[index];
+}
+
+//empties a slot, shifting back the elements after it that probed past it
+static void clearSlot(IntMap map, int slot) {
+    int mask = map->slot_count - 1;
+    int next = slot;
+    while (true) {
+        next = (next + 1) & mask;
+        if (map->slots[next] == EMPTY_SLOT) {
+            break;
+        }
+        int home = slotOf(map, map->keys[map->slots[next]]);
+        //the element stays if its home slot lies (cyclically) after the empty slot, up to where it is
+        bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (!stays) {
+            map->slots[slot] = map->slots[next];
+            slot = next;
+        }
+    }
+    map->slots[slot] = EMPTY_SLOT;
+}
+
+IntMapResult intMapRemove(IntMap map, int key) {
+    if (map == NULL) {
+        return INT_MAP_NULL_ARGUMENT;
+    }
+    int slot = findSlot(map, key);
+    int index = map->slots[slot];
+    if (index == EMPTY_SLOT) {
+        return INT_MAP_ITEM_DOES_NOT_EXIST;
+    }
+    clearSlot(map, slot);
+    int last = --map->size;
+    if (index != last) { //the last element fills the gap
+        map->slots[findSlot(map, map->keys[last])] = index;
+        map->keys[index] = map->keys[last];
+        map->values[index] = map->values[last];
+    }
+    return INT_MAP_SUCCESS;
+}
+
+void intMapClear(IntMap map) {
+    if (map == NULL) {
+        return;
+    }
+    for (int slot = 0; slot < map->slot_count; slot++) {
+        map->slots[slot] = EMPTY_SLOT;
+    }
+    map->size = 0;
+}
+
+int intMapGetEntries(IntMap map, const int** keys, const int** values) {
+    if (map == NULL || keys == NULL || values == NULL) {
+        return EMPTY_SLOT;
+    }
+    *keys = map->keys;
+    *values = map->values;
+    return map->size;
+}
+
+MapMemoryUsage intMapMemoryUsage(IntMap map) {
+    MapMemoryUsage usage = {0, 0, 0, 0, 0};
+    if (map == NULL) {
+        return usage;
+    }
+    size_t block_size = 2 * (size_t)map->max_size * sizeof(*map->keys);
+    size_t slots_size = (size_t)map->slot_count * sizeof(*map->slots);
+    usage.payload_bytes = 2 * (size_t)map->size * sizeof(*map->keys);
+    usage.structure_bytes = sizeof(*map) + slots_size + block_size - usage.payload_bytes;
+    usage.slack_bytes = block_size - usage.payload_bytes;
+    usage.overhead_bytes = allocatorEstimateOverhead(&map->allocator, map, sizeof(*map))
+                           + allocatorEstimateOverhead(&map->allocator, map->keys, block_size)
+                           + allocatorEstimateOverhead(&map->allocator, map->slots, slots_size);
+    usage.total_bytes = usage.payload_bytes + usage.structure_bytes + usage.overhead_bytes;
+    return usage;
+}
@@ -0,0 +1,144 @@
+#ifndef INT_MAP_H_
+#define INT_MAP_H_
+
+#include "map.h"
+#include <stdbool.h>
+/**
+* Integer Map Container
+*
+* Implements a map from int keys to int values, for the election's ids and
+* vote counts, so they never have to be formatted into strings.
+* The elements are kept in dense arrays (which can be exposed with
+* intMapGetEntries), and found through an open addressing index. The keys are
+* ids sent from outside, so the index hashes them by multiplying with a secret
+* multiplier drawn from the random seed of the process: keys can't be chosen to
+* collide without knowing it. If a new key still probes too far, the index
+* draws a new multiplier and is rebuilt. Removing an element moves the
+* last element into its place.
+*
+* The following functions are available:
+*   intMapCreate		- Creates a new empty map.
+*   intMapDestroy		- Deletes an existing map and frees all resources.
+*   intMapGetSize		- Returns the number of elements of a map.
+*   intMapContains		- Returns whether a key is in the map.
+*   intMapGet			- Returns a pointer to the value of a key.
+*   intMapPut			- Gives a key a value, adding the key if needed.
+*   intMapGetOrInsert	- Returns a pointer to the value of a key, adding it if needed.
+*   intMapRemove		- Removes a key.
+*   intMapClear		- Removes all the elements.
+*   intMapGetEntries	- Exposes the keys and the values as read-only arrays.
+*   intMapMemoryUsage	- Returns a breakdown of the memory the map holds.
+*/
+
+/** Type for defining the integer map */
+typedef struct IntMap_t* IntMap;
+
+/** Type used for returning error codes from integer map functions */
+typedef enum IntMapResult_t {
+    INT_MAP_SUCCESS,
+    INT_MAP_OUT_OF_MEMORY,
+    INT_MAP_NULL_ARGUMENT,
+    INT_MAP_ITEM_DOES_NOT_EXIST
+} IntMapResult;
+
+/**
+* intMapCreate: Allocates a new empty map.
+*
+* @param allocator - The allocator to take the map from. It is copied, but its
+* 		context must stay valid for as long as the map exists.
+* @return
+* 	NULL - if the allocator is not valid or allocations failed.
+* 	A new IntMap in case of success.
+*/
+IntMap intMapCreate(const Allocator* allocator);
+
+/**
+* intMapDestroy: Deallocates an existing map.
+*
+* @param map - Target map to be deallocated. If map is NULL nothing will be done.
+*/
+void intMapDestroy(IntMap map);
+
+/**
+* intMapGetSize: Returns the number of elements in a map.
+* @return
+* 	-1 if a NULL pointer was sent, the number of elements otherwise.
+*/
+int intMapGetSize(IntMap map);
+
+/**
+* intMapContains: Returns whether a key is in the map (false if a NULL pointer was sent).
+*/
+bool intMapContains(IntMap map, int key);
+
+/**
+* intMapGet: Returns a pointer to the value of a key. The value may be changed
+* through it until the next change of the map.
+* @return
+* 	NULL if a NULL pointer was sent or the key is not in the map.
+* 	A pointer to the value otherwise.
+*/
+int* intMapGet(IntMap map, int key);
+
+/**
+* intMapPut: Gives a key a value, adding the key if it is not in the map.
+* @return
+* 	INT_MAP_NULL_ARGUMENT if a NULL pointer was sent.
+* 	INT_MAP_OUT_OF_MEMORY if an allocation failed (the map is left as it was).
+* 	INT_MAP_SUCCESS otherwise.
+*/
+IntMapResult intMapPut(IntMap map, int key, int value);
+
+/**
+* intMapGetOrInsert: Returns a pointer to the value of a key, first adding the
+* key with default_value if it is not in the map. The key is looked up once.
+* The value may be changed through the pointer until the next change of the map.
+*
+* @param map - The map to search (and add to).
+* @param key - The key to look for.
+* @param default_value - The value to add the key with.
+* @param inserted - If not NULL, set to true if the key was added, false if it existed.
+* @return
+* 	NULL if a NULL pointer was sent as map or an allocation failed.
+* 	A pointer to the value otherwise.
+*/
+int* intMapGetOrInsert(IntMap map, int key, int default_value, bool* inserted);
+
+/**
+* intMapRemove: Removes a key. The last element of the map takes its place.
+* @return
+* 	INT_MAP_NULL_ARGUMENT if a NULL pointer was sent.
+* 	INT_MAP_ITEM_DOES_NOT_EXIST if the key is not in the map.
+* 	INT_MAP_SUCCESS otherwise.
+*/
+IntMapResult intMapRemove(IntMap map, int key);
+
+/**
+* intMapClear: Removes all the elements of the map. If map is NULL nothing will be done.
+*/
+void intMapClear(IntMap map);
+
+/**
+* intMapGetEntries: Exposes the keys and the values of the map as read-only
+* arrays, so all the elements can be read with one linear pass. keys[i] and
+* values[i] form the i-th element. The arrays are valid until the next change
+* of the map.
+*
+* @param map - The map to expose.
+* @param keys - Set to the array of the keys.
+* @param values - Set to the array of the values.
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	The number of elements in the arrays otherwise.
+*/
+int intMapGetEntries(IntMap map, const int** keys, const int** values);
+
+/**
+* intMapMemoryUsage: Returns a breakdown of the memory held by the map (the
+* keys and the values are its payload). See mapMemoryUsage.
+* @return
+* 	All zeros if a NULL pointer was sent, the breakdown otherwise.
+*/
+MapMemoryUsage intMapMemoryUsage(IntMap map);
+
+#endif /* INT_MAP_H_ */
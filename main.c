@@ -1,9 +1,17 @@
+#define _POSIX_C_SOURCE 200809L //needed for fileno, dup and lseek
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #include "election.h"
+#include "electionIngest.h"
+#include "electionQueue.h"
+#include "argmax.h"
 #include "test_utilities.h"
 
 /*The number of tests*/
-#define NUMBER_TESTS 1
+#define NUMBER_TESTS 16
 
 bool deleteOnlyFirstArea (int area_id) {
 	return area_id == 1;
@@ -19,14 +27,954 @@ bool testElectionRemoveAreas() {
 	return true;
 }
 
+//an allocator that counts the bytes it currently holds
+static void* countingAllocate(void* context, size_t size) {
+    *(size_t*)context += size;
+    return malloc(size);
+}
+
+static void* countingReallocate(void* context, void* block, size_t old_size, size_t new_size) {
+    void* new_block = realloc(block, new_size);
+    if (new_block != NULL) {
+        *(size_t*)context += new_size - old_size;
+    }
+    return new_block;
+}
+
+static void countingDeallocate(void* context, void* block, size_t size) {
+    *(size_t*)context -= size;
+    free(block);
+}
+
+bool testElectionCustomAllocator() {
+    size_t bytes_held = 0;
+    Allocator allocator = {countingAllocate, countingReallocate, countingDeallocate, &bytes_held};
+    ASSERT_TEST(electionCreateWithAllocator(NULL) == NULL);
+    Election election = electionCreateWithAllocator(&allocator);
+    ASSERT_TEST(election != NULL);
+    ASSERT_TEST(electionAddTribe(election, 1, "first tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 2, "first area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 2, 1, 7) == ELECTION_SUCCESS);
+    ASSERT_TEST(bytes_held > 0);
+    Map results = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(results != NULL);
+    ASSERT_TEST(strcmp(mapGet(results, "2"), "1") == 0);
+    mapDestroy(results);
+    ASSERT_TEST(electionAddArea(election, 1, "second area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveAreas(election, deleteOnlyFirstArea) == ELECTION_SUCCESS); //its mask is allocated too
+    electionDestroy(election);
+    ASSERT_TEST(bytes_held == 0);
+    return true;
+}
+
+bool testElectionMemoryUsage() {
+    Election election = electionCreate();
+    ElectionMemoryUsage usage = electionMemoryUsage(NULL);
+    ASSERT_TEST(usage.total_bytes == 0 && usage.largest_vote_row_area == -1);
+    ASSERT_TEST(electionAddTribe(election, 1, "first tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 2, "first area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 3, "second area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 3, 1, 15) == ELECTION_SUCCESS);
+    usage = electionMemoryUsage(election);
+    ASSERT_TEST(usage.tribes.payload_bytes == 3 * sizeof(int) + sizeof(void*) + strlen("first tribe") + 1);
+    ASSERT_TEST(usage.votes.payload_bytes >= 2 * sizeof(int));
+    for (int tribe = 2; tribe <= 20; tribe++) { //moves the second area into the matrix
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddVote(election, 3, tribe, 1) == ELECTION_SUCCESS);
+    }
+    usage = electionMemoryUsage(election);
+    ASSERT_TEST(usage.largest_vote_row_area == 3 && usage.largest_vote_row_bytes >= 20 * sizeof(int));
+    ASSERT_TEST(usage.votes.slack_bytes > 0);
+    ASSERT_TEST(usage.total_bytes > usage.tribes.total_bytes + usage.areas.total_bytes
+                                    + usage.votes.total_bytes);
+    electionDestroy(election);
+    return true;
+}
+
+bool testElectionComputeMapping() {
+    Election election = electionCreate();
+    ASSERT_TEST(electionAddTribe(election, 7, "seventh tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 3, "third tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 5, "fifth tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 10, "voting area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 20, "empty area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 10, 7, 4) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 10, 5, 4) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveVote(election, 10, 3, 1) == ELECTION_SUCCESS);
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(mapGetSize(mapping) == 2);
+    ASSERT_TEST(strcmp(mapGet(mapping, "10"), "5") == 0); //a tie goes to the lowest id
+    ASSERT_TEST(strcmp(mapGet(mapping, "20"), "3") == 0); //no votes, the lowest tribe id
+    mapDestroy(mapping);
+    ASSERT_TEST(electionRemoveTribe(election, 5) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveTribe(election, 5) == ELECTION_TRIBE_NOT_EXIST);
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "10"), "7") == 0); //the votes of a removed tribe don't count
+    mapDestroy(mapping);
+    ASSERT_TEST(electionAddTribe(election, 5, "fifth tribe again") == ELECTION_SUCCESS);
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "10"), "7") == 0); //and don't come back with the id
+    mapDestroy(mapping);
+    electionDestroy(election);
+    return true;
+}
+
+bool testElectionDenseVotes() {
+    Election election = electionCreate();
+    ASSERT_TEST(electionAddArea(election, 1, "dense area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 2, "other dense area") == ELECTION_SUCCESS);
+    for (int tribe = 100; tribe > 60; tribe--) { //enough tribes to make both areas dense
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddVote(election, 1, tribe, 5) == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddVote(election, 2, tribe, tribe) == ELECTION_SUCCESS);
+    }
+    ASSERT_TEST(electionAddVote(election, 1, 90, 1) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveVote(election, 2, 100, 1000) == ELECTION_SUCCESS);
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "1"), "90") == 0);
+    ASSERT_TEST(strcmp(mapGet(mapping, "2"), "99") == 0);
+    mapDestroy(mapping);
+    ASSERT_TEST(electionRemoveVote(election, 1, 90, 2) == ELECTION_SUCCESS); //the leader loses the lead
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "1"), "61") == 0);
+    mapDestroy(mapping);
+    ASSERT_TEST(electionRemoveTribe(election, 90) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveAreas(election, deleteOnlyFirstArea) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 5, "new tribe") == ELECTION_SUCCESS); //takes the free column
+    ASSERT_TEST(electionAddArea(election, 1, "new area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 2, 5, 1) == ELECTION_SUCCESS);
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(mapGetSize(mapping) == 2);
+    ASSERT_TEST(strcmp(mapGet(mapping, "1"), "5") == 0); //no votes, the lowest tribe id
+    ASSERT_TEST(strcmp(mapGet(mapping, "2"), "99") == 0);
+    mapDestroy(mapping);
+    electionDestroy(election);
+    return true;
+}
+
+//checks that two mappings have the same areas and winners
+static bool sameMapping(Map first, Map second) {
+    if (first == NULL || second == NULL || mapGetSize(first) != mapGetSize(second)) {
+        return false;
+    }
+    MAP_FOREACH(area, first) {
+        char* winner = mapGet(second, area);
+        if (winner == NULL || strcmp(winner, mapGet(first, area)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testElectionComputeMappingParallel() {
+    Election election = electionCreate();
+    ASSERT_TEST(electionComputeAreasToTribesMappingParallel(NULL, 4) == NULL);
+    ASSERT_TEST(electionComputeAreasToTribesMappingParallel(election, 0) == NULL);
+    for (int tribe = 0; tribe < 50; tribe++) {
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+    }
+    for (int area = 0; area < 5000; area++) {
+        ASSERT_TEST(electionAddArea(election, area, "area") == ELECTION_SUCCESS);
+        if (area % 7 != 0) { //some areas have no votes
+            ASSERT_TEST(electionAddVote(election, area, (area * 31) % 50, area % 13 + 1) == ELECTION_SUCCESS);
+            ASSERT_TEST(electionAddVote(election, area, (area * 17) % 50, area % 11 + 1) == ELECTION_SUCCESS);
+        }
+    }
+    Map expected = electionComputeAreasToTribesMapping(election);
+    for (int threads = 1; threads <= 4; threads++) {
+        Map mapping = electionComputeAreasToTribesMappingParallel(election, threads);
+        ASSERT_TEST(sameMapping(expected, mapping));
+        mapDestroy(mapping);
+    }
+    Map mapping = electionComputeAreasToTribesMappingParallel(election, 4); //the threads are reused
+    ASSERT_TEST(sameMapping(expected, mapping));
+    mapDestroy(mapping);
+    mapDestroy(expected);
+    electionDestroy(election);
+    return true;
+}
+
+//applies a batch to one election and the same votes one by one to another, and checks that
+//every vote got the same result
+static bool sameVotesBatch(Election batched, Election single, bool add, int count, const int* area_ids,
+                           const int* tribe_ids, const int* votes) {
+    ElectionResult results[200];
+    ElectionResult batch_result = add ? electionAddVotesBatch(batched, count, area_ids, tribe_ids, votes, results)
+                                      : electionRemoveVotesBatch(batched, count, area_ids, tribe_ids, votes, results);
+    bool failed = false;
+    for (int i = 0; i < count; i++) {
+        ElectionResult result = add ? electionAddVote(single, area_ids[i], tribe_ids[i], votes[i])
+                                    : electionRemoveVote(single, area_ids[i], tribe_ids[i], votes[i]);
+        if (results[i] != result) {
+            return false;
+        }
+        failed = failed || result != ELECTION_SUCCESS;
+    }
+    return batch_result == (failed ? ELECTION_ERROR : ELECTION_SUCCESS);
+}
+
+bool testElectionVotesBatch() {
+    Election batched = electionCreate(), single = electionCreate();
+    for (int tribe = 0; tribe < 40; tribe++) {
+        ASSERT_TEST(electionAddTribe(batched, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddTribe(single, tribe, "tribe") == ELECTION_SUCCESS);
+    }
+    for (int area = 0; area < 10; area++) {
+        ASSERT_TEST(electionAddArea(batched, area, "area") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(single, area, "area") == ELECTION_SUCCESS);
+    }
+    int area_ids[200], tribe_ids[200], votes[200];
+    ElectionResult results[200];
+    ASSERT_TEST(electionAddVotesBatch(NULL, 1, area_ids, tribe_ids, votes, results) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionAddVotesBatch(batched, 1, area_ids, tribe_ids, votes, NULL) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionAddVotesBatch(batched, -1, area_ids, tribe_ids, votes, results) == ELECTION_ERROR);
+    ASSERT_TEST(electionRemoveVotesBatch(batched, 0, area_ids, tribe_ids, votes, results) == ELECTION_SUCCESS);
+    srand(42);
+    for (int round = 0; round < 4; round++) { //area 0 gets votes of every tribe, so it turns dense
+        for (int i = 0; i < 200; i++) {
+            area_ids[i] = i < 40 ? 0 : rand() % 12 - 1; //unsorted, with invalid and missing areas
+            tribe_ids[i] = i < 40 ? (i * 7) % 40 : rand() % 42;
+            votes[i] = rand() % 20;
+        }
+        ASSERT_TEST(sameVotesBatch(batched, single, true, 200, area_ids, tribe_ids, votes));
+        for (int i = 0; i < 200; i += 2) {
+            votes[i] = rand() % 30;
+        }
+        ASSERT_TEST(sameVotesBatch(batched, single, false, 100, area_ids, tribe_ids, votes));
+        Map expected = electionComputeAreasToTribesMapping(single);
+        Map mapping = electionComputeAreasToTribesMapping(batched);
+        ASSERT_TEST(sameMapping(expected, mapping));
+        mapDestroy(expected);
+        mapDestroy(mapping);
+    }
+    electionDestroy(batched);
+    electionDestroy(single);
+    return true;
+}
+
+//returns a descriptor of a temporary file holding the data, at its start. -1 if that failed
+static int temporaryFile(const void* data, size_t size) {
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        return -1;
+    }
+    int fd = -1;
+    if (fwrite(data, 1, size, file) == size && fflush(file) == 0) {
+        fd = dup(fileno(file)); //the file is deleted once both are closed
+    }
+    fclose(file);
+    if (fd >= 0) {
+        lseek(fd, 0, SEEK_SET);
+    }
+    return fd;
+}
+
+//ElectionIngestProgressFunction function: counts the calls
+static void countProgress(const ElectionIngestStats* stats, void* calls) {
+    (*(int*)calls)++;
+}
+
+bool testElectionIngestFile() {
+    Election election = electionCreate();
+    for (int id = 1; id <= 3; id++) {
+        ASSERT_TEST(electionAddTribe(election, id, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(election, id, "area") == ELECTION_SUCCESS);
+    }
+    ASSERT_TEST(electionIngestFile(NULL, 0, ELECTION_INGEST_CSV, NULL, NULL, NULL) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionIngestFile(election, 0, (ElectionIngestFormat)7, NULL, NULL, NULL) == ELECTION_ERROR);
+    const char* csv = "area,tribe,votes\n1,1,5\r\n1,2,7\n\n2,3,4\n2,9,1\n-1,1,1\nxyz\n1,1,2147483648\n"
+                      "2,1,123456789"; //the last line has no '\n'
+    int fd = temporaryFile(csv, strlen(csv));
+    ASSERT_TEST(fd >= 0);
+    ElectionIngestStats stats;
+    int calls = 0;
+    ASSERT_TEST(electionIngestFile(election, fd, ELECTION_INGEST_CSV, &stats, countProgress, &calls)
+                == ELECTION_SUCCESS);
+    close(fd);
+    ASSERT_TEST(stats.bytes_read == strlen(csv) && stats.records == 6 && stats.malformed == 3);
+    ASSERT_TEST(stats.votes_added == 4 && stats.votes_rejected == 2 && calls == 1);
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "1"), "2") == 0 && strcmp(mapGet(mapping, "2"), "1") == 0);
+    mapDestroy(mapping);
+    unsigned char records[2 * 12 + 5] = {1, 0, 0, 0, 3, 0, 0, 0, 10, 0, 0, 0, //little endian ints
+                                         3, 0, 0, 0, 2, 0, 0, 0, 0, 1, 0, 0, //256 votes
+                                         1, 0, 0, 0, 1}; //a partial record
+    fd = temporaryFile(records, sizeof(records));
+    ASSERT_TEST(electionIngestFile(election, fd, ELECTION_INGEST_BINARY, &stats, NULL, NULL) == ELECTION_SUCCESS);
+    close(fd);
+    ASSERT_TEST(stats.records == 2 && stats.votes_added == 2 && stats.malformed == 1);
+    ASSERT_TEST(electionAddVote(election, 3, 1, 255) == ELECTION_SUCCESS);
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "1"), "3") == 0 && strcmp(mapGet(mapping, "3"), "2") == 0);
+    mapDestroy(mapping);
+    int lines = 300000; //more than one block of the reader
+    char* long_csv = malloc(lines * 6 + 1);
+    ASSERT_TEST(long_csv != NULL);
+    for (int i = 0; i < lines; i++) {
+        strcpy(long_csv + i * 6, i % 2 == 0 ? "3,1,1\n" : "3,3,1\n");
+    }
+    fd = temporaryFile(long_csv, lines * 6);
+    free(long_csv);
+    ASSERT_TEST(electionIngestFile(election, fd, ELECTION_INGEST_CSV, &stats, NULL, NULL) == ELECTION_SUCCESS);
+    close(fd);
+    ASSERT_TEST(stats.records == lines && stats.votes_added == lines && stats.malformed == 0);
+    mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(strcmp(mapGet(mapping, "3"), "1") == 0); //255 votes and half the lines
+    mapDestroy(mapping);
+    electionDestroy(election);
+    return true;
+}
+
+//ingests a file into a new election of 100 areas and 50 tribes, with thread_count threads
+//(0 for electionIngestFile), and returns its mapping
+static Map ingestMapping(int fd, ElectionIngestFormat format, int thread_count, ElectionIngestStats* stats) {
+    Election election = electionCreate();
+    for (int id = 0; id < 100; id++) {
+        electionAddArea(election, id, "area");
+        if (id < 50) {
+            electionAddTribe(election, id, "tribe");
+        }
+    }
+    lseek(fd, 0, SEEK_SET);
+    ElectionResult result = thread_count == 0 ? electionIngestFile(election, fd, format, stats, NULL, NULL)
+                            : electionIngestParallel(election, fd, format, thread_count, stats, NULL, NULL);
+    Map mapping = result == ELECTION_SUCCESS ? electionComputeAreasToTribesMapping(election) : NULL;
+    electionDestroy(election);
+    return mapping;
+}
+
+//checks that the stats of two ingests count the same
+static bool sameStats(const ElectionIngestStats* first, const ElectionIngestStats* second) {
+    return first->bytes_read == second->bytes_read && first->records == second->records
+           && first->votes_added == second->votes_added && first->votes_rejected == second->votes_rejected
+           && first->malformed == second->malformed;
+}
+
+//what an ingest into an election with a counting allocator holds when it reports progress
+typedef struct HeldBytes_t {
+    const size_t* bytes_held;
+    size_t at_progress;
+} HeldBytes;
+
+//ElectionIngestProgressFunction function: reads the bytes the counting allocator holds
+static void readHeldBytes(const ElectionIngestStats* stats, void* held) {
+    ((HeldBytes*)held)->at_progress = *((HeldBytes*)held)->bytes_held;
+}
+
+bool testElectionIngestParallel() {
+    ASSERT_TEST(electionIngestParallel(NULL, 0, ELECTION_INGEST_CSV, 2, NULL, NULL, NULL) == ELECTION_NULL_ARGUMENT);
+    int lines = 400000; //several tasks of the parallel reader
+    char* csv = malloc((size_t)lines * 16);
+    int* records = malloc((size_t)lines * 3 * sizeof(int));
+    ASSERT_TEST(csv != NULL && records != NULL);
+    size_t size = 0;
+    srand(7);
+    for (int i = 0; i < lines; i++) {
+        records[3 * i] = i % 1000 == 0 ? -1 : i * 100 / lines; //some invalid and some missing ids
+        records[3 * i + 1] = rand() % 55;
+        records[3 * i + 2] = rand() % 100;
+        size += sprintf(csv + size, i % 5000 == 0 ? "oops\n" : "%d,%d,%d\n", records[3 * i], records[3 * i + 1],
+                        records[3 * i + 2]);
+    }
+    ElectionIngestFormat formats[] = { ELECTION_INGEST_CSV, ELECTION_INGEST_BINARY };
+    int fds[] = { temporaryFile(csv, size), temporaryFile(records, (size_t)lines * 3 * sizeof(int)) };
+    free(csv);
+    free(records);
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TEST(fds[i] >= 0);
+        ElectionIngestStats expected_stats, stats;
+        Map expected = ingestMapping(fds[i], formats[i], 0, &expected_stats);
+        ASSERT_TEST(expected != NULL && expected_stats.votes_rejected > 0);
+        for (int threads = 1; threads <= 4; threads++) {
+            Map mapping = ingestMapping(fds[i], formats[i], threads, &stats);
+            ASSERT_TEST(sameMapping(expected, mapping) && sameStats(&expected_stats, &stats));
+            mapDestroy(mapping);
+        }
+        mapDestroy(expected);
+        close(fds[i]);
+    }
+    size_t bytes_held = 0; //the buffer and the shards come from the election's allocator too
+    Allocator allocator = {countingAllocate, countingReallocate, countingDeallocate, &bytes_held};
+    Election election = electionCreateWithAllocator(&allocator);
+    ASSERT_TEST(election != NULL && electionGetAllocator(election) != NULL && electionGetAllocator(NULL) == NULL);
+    ASSERT_TEST(electionAddArea(election, 1, "area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 2, "tribe") == ELECTION_SUCCESS);
+    const char* csv_votes = "1,2,5\n1,2,7\n";
+    int fd = temporaryFile(csv_votes, strlen(csv_votes));
+    ASSERT_TEST(fd >= 0);
+    HeldBytes held = {&bytes_held, 0};
+    size_t before = bytes_held;
+    ElectionIngestStats stats;
+    ASSERT_TEST(electionIngestParallel(election, fd, ELECTION_INGEST_CSV, 2, &stats, readHeldBytes, &held)
+                == ELECTION_SUCCESS);
+    close(fd);
+    ASSERT_TEST(stats.votes_added == 2 && held.at_progress > before + (1 << 20));
+    electionDestroy(election);
+    ASSERT_TEST(bytes_held == 0);
+    return true;
+}
+
+bool testArgmaxFind() {
+    int values[100], keys[100];
+    ASSERT_TEST(argmaxFind(NULL, NULL, 5) == -1 && argmaxFind(values, keys, 0) == -1);
+    srand(5);
+    for (int count = 1; count <= 100; count++) {
+        for (int i = 0; i < count; i++) {
+            values[i] = rand() % 4 - 1; //many ties, and negative values
+            keys[i] = (i * 37) % 101; //keys out of the order of the indices
+        }
+        int by_key = 0, by_index = 0;
+        for (int i = 1; i < count; i++) {
+            if (values[i] > values[by_key] || (values[i] == values[by_key] && keys[i] < keys[by_key])) {
+                by_key = i;
+            }
+            if (values[i] > values[by_index]) {
+                by_index = i;
+            }
+        }
+        ASSERT_TEST(argmaxFind(values, keys, count) == by_key);
+        ASSERT_TEST(argmaxFind(values, NULL, count) == by_index);
+    }
+    ASSERT_TEST(argmaxGetKernelName() != NULL);
+    return true;
+}
+
+#define CONCURRENT_VOTERS 4
+#define CONCURRENT_AREAS 100
+#define CONCURRENT_TRIBES 80
+
+//the votes of one voter thread: every voter votes in every area, so they meet on the area locks
+static void* concurrentVoter(void* election) {
+    for (int i = 0; i < 20000; i++) {
+        int area = i % CONCURRENT_AREAS, tribe = (i * 7 + area) % CONCURRENT_TRIBES;
+        if (electionAddVote(election, area, tribe, i % 10 + 1) != ELECTION_SUCCESS
+            || (i % 3 == 0 && electionRemoveVote(election, area, tribe, 1) != ELECTION_SUCCESS)) {
+            return election;
+        }
+    }
+    return NULL;
+}
+
+bool testElectionConcurrent() {
+    Election election = electionCreateConcurrent(), expected_election = electionCreate();
+    ASSERT_TEST(election != NULL && expected_election != NULL);
+    for (int tribe = 0; tribe < CONCURRENT_TRIBES; tribe++) {
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddTribe(expected_election, tribe, "tribe") == ELECTION_SUCCESS);
+    }
+    for (int area = 0; area < CONCURRENT_AREAS; area++) {
+        ASSERT_TEST(electionAddArea(election, area, "area") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(expected_election, area, "area") == ELECTION_SUCCESS);
+    }
+    pthread_t voters[CONCURRENT_VOTERS];
+    for (int i = 0; i < CONCURRENT_VOTERS; i++) {
+        ASSERT_TEST(pthread_create(&voters[i], NULL, concurrentVoter, election) == 0);
+        ASSERT_TEST(concurrentVoter(expected_election) == NULL);
+    }
+    int top[CONCURRENT_TRIBES], expected_top[CONCURRENT_TRIBES], count, expected_count, rank, expected_rank;
+    long long totals[CONCURRENT_TRIBES], expected_totals[CONCURRENT_TRIBES];
+    for (int i = 0; i < 20; i++) { //readers and writers of the structure run with the votes
+        ASSERT_TEST(electionGetTopTribes(election, ELECTION_NATIONAL, 5, top, totals, &count) == ELECTION_SUCCESS);
+        ASSERT_TEST(electionGetTribeRank(election, ELECTION_NATIONAL, i, &rank) == ELECTION_SUCCESS);
+        Map mapping = electionComputeAreasToTribesMappingParallel(election, 2);
+        ASSERT_TEST(mapping != NULL);
+        mapDestroy(mapping);
+        char* name = electionGetTribeName(election, i);
+        ASSERT_TEST(name != NULL && strcmp(name, "tribe") == 0);
+        free(name);
+        ASSERT_TEST(electionAddArea(election, CONCURRENT_AREAS + i, "late area") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(expected_election, CONCURRENT_AREAS + i, "late area") == ELECTION_SUCCESS);
+    }
+    for (int i = 0; i < CONCURRENT_VOTERS; i++) {
+        void* failed;
+        ASSERT_TEST(pthread_join(voters[i], &failed) == 0 && failed == NULL);
+    }
+    Map expected = electionComputeAreasToTribesMapping(expected_election);
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(sameMapping(expected, mapping));
+    mapDestroy(expected);
+    mapDestroy(mapping);
+    ASSERT_TEST(electionGetTopTribes(election, ELECTION_NATIONAL, CONCURRENT_TRIBES, top, totals, &count)
+                == ELECTION_SUCCESS);
+    ASSERT_TEST(electionGetTopTribes(expected_election, ELECTION_NATIONAL, CONCURRENT_TRIBES, expected_top,
+                                     expected_totals, &expected_count) == ELECTION_SUCCESS);
+    int voted_tribes = 0;
+    for (int tribe = 0; tribe < CONCURRENT_TRIBES; tribe++) {
+        long long total;
+        ASSERT_TEST(electionGetTribeTotal(election, tribe, &total) == ELECTION_SUCCESS);
+        voted_tribes += total > 0;
+    }
+    ASSERT_TEST(count == voted_tribes && count == expected_count);
+    for (int i = 0; i < count; i++) { //the standings caught up with the votes given while they were read
+        long long total;
+        ASSERT_TEST(electionGetTribeTotal(election, top[i], &total) == ELECTION_SUCCESS && totals[i] == total);
+        ASSERT_TEST(top[i] == expected_top[i] && totals[i] == expected_totals[i]);
+        ASSERT_TEST(electionGetTribeRank(election, ELECTION_NATIONAL, top[i], &rank) == ELECTION_SUCCESS);
+        ASSERT_TEST(electionGetTribeRank(expected_election, ELECTION_NATIONAL, top[i], &expected_rank)
+                    == ELECTION_SUCCESS && rank == expected_rank);
+    }
+    electionDestroy(expected_election);
+    electionDestroy(election);
+    return true;
+}
+
+#define QUEUE_PRODUCERS 4
+#define QUEUE_AREAS_PER_PRODUCER 25
+#define QUEUE_VOTES 5000
+
+//what a producer submits, and what its callbacks saw
+typedef struct QueueProducer_t {
+    ElectionQueue queue;
+    int first_area;
+    int successes; //only the applier thread changes these
+    int failures;
+} QueueProducer;
+
+static void countQueueResult(ElectionResult result, void* producer) {
+    if (result == ELECTION_SUCCESS) {
+        ((QueueProducer*)producer)->successes++;
+    } else {
+        ((QueueProducer*)producer)->failures++;
+    }
+}
+
+//the votes of a producer: every 10th is a removal and every 100th has a tribe that does not exist
+static void queueVote(int first_area, int i, int* area, int* tribe, int* votes, bool* remove) {
+    *area = first_area + i % QUEUE_AREAS_PER_PRODUCER;
+    *tribe = i % 100 == 0 ? CONCURRENT_TRIBES : (i * 13 + *area) % CONCURRENT_TRIBES;
+    *votes = i % 7 + 1;
+    *remove = i % 10 == 0;
+}
+
+static void* queueProducer(void* argument) {
+    QueueProducer* producer = argument;
+    for (int i = 0; i < QUEUE_VOTES; i++) {
+        int area, tribe, votes;
+        bool remove;
+        queueVote(producer->first_area, i, &area, &tribe, &votes, &remove);
+        ElectionQueueResult result;
+        do { //a full ring is retried, after the applier had a chance to drain it
+            result = remove ? electionSubmitRemoveVote(producer->queue, area, tribe, votes, countQueueResult, producer)
+                            : electionSubmitVote(producer->queue, area, tribe, votes, countQueueResult, producer);
+        } while (result == ELECTION_QUEUE_FULL && sched_yield() == 0);
+        if (result != ELECTION_QUEUE_SUCCESS) {
+            return producer;
+        }
+    }
+    return NULL;
+}
+
+bool testElectionQueue() {
+    ElectionQueueStats stats;
+    ASSERT_TEST(electionQueueCreate(NULL, 16) == NULL && electionSubmitVote(NULL, 1, 1, 1, NULL, NULL)
+                                                         == ELECTION_QUEUE_NULL_ARGUMENT);
+    ASSERT_TEST(electionQueueFlush(NULL) == ELECTION_QUEUE_NULL_ARGUMENT
+                && electionQueueGetStats(NULL, &stats) == ELECTION_QUEUE_NULL_ARGUMENT);
+    Election election = electionCreate(), expected_election = electionCreate();
+    for (int tribe = 0; tribe < CONCURRENT_TRIBES; tribe++) {
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddTribe(expected_election, tribe, "tribe") == ELECTION_SUCCESS);
+    }
+    for (int area = 0; area < QUEUE_PRODUCERS * QUEUE_AREAS_PER_PRODUCER; area++) {
+        ASSERT_TEST(electionAddArea(election, area, "area") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(expected_election, area, "area") == ELECTION_SUCCESS);
+    }
+    ElectionQueue queue = electionQueueCreate(election, 50); //a small ring, so producers find it full
+    ASSERT_TEST(queue != NULL);
+    QueueProducer producers[QUEUE_PRODUCERS];
+    pthread_t threads[QUEUE_PRODUCERS];
+    for (int i = 0; i < QUEUE_PRODUCERS; i++) { //the producers vote in areas of their own, so their order holds
+        producers[i] = (QueueProducer){ queue, i * QUEUE_AREAS_PER_PRODUCER, 0, 0 };
+        ASSERT_TEST(pthread_create(&threads[i], NULL, queueProducer, &producers[i]) == 0);
+        for (int j = 0; j < QUEUE_VOTES; j++) {
+            int area, tribe, votes;
+            bool remove;
+            queueVote(producers[i].first_area, j, &area, &tribe, &votes, &remove);
+            remove ? electionRemoveVote(expected_election, area, tribe, votes)
+                   : electionAddVote(expected_election, area, tribe, votes);
+        }
+    }
+    for (int i = 0; i < QUEUE_PRODUCERS; i++) {
+        void* failed;
+        ASSERT_TEST(pthread_join(threads[i], &failed) == 0 && failed == NULL);
+    }
+    ASSERT_TEST(electionQueueFlush(queue) == ELECTION_QUEUE_SUCCESS);
+    ASSERT_TEST(electionQueueGetStats(queue, &stats) == ELECTION_QUEUE_SUCCESS);
+    ASSERT_TEST(stats.capacity == 64 && stats.high_water <= 64 && stats.batches > 0);
+    ASSERT_TEST(stats.submitted == QUEUE_PRODUCERS * QUEUE_VOTES && stats.applied == stats.submitted);
+    ASSERT_TEST(stats.rejected == QUEUE_PRODUCERS * QUEUE_VOTES / 100);
+    for (int i = 0; i < QUEUE_PRODUCERS; i++) {
+        ASSERT_TEST(producers[i].successes == QUEUE_VOTES - QUEUE_VOTES / 100);
+        ASSERT_TEST(producers[i].failures == QUEUE_VOTES / 100);
+    }
+    Map expected = electionComputeAreasToTribesMapping(expected_election);
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    ASSERT_TEST(sameMapping(expected, mapping));
+    mapDestroy(expected);
+    mapDestroy(mapping);
+    QueueProducer last = { queue, 0, 0, 0 };
+    ASSERT_TEST(electionSubmitVote(queue, 0, 0, 5, countQueueResult, &last) == ELECTION_QUEUE_SUCCESS);
+    electionQueueDestroy(queue); //applies the last vote
+    ASSERT_TEST(last.successes == 1);
+    electionDestroy(expected_election);
+    electionDestroy(election);
+    return true;
+}
+
+#define POSTING_AREAS 30
+#define POSTING_TRIBES 40
+
+static int area_to_remove;
+
+static bool isAreaToRemove(int area_id) {
+    return area_id == area_to_remove;
+}
+
+//checks the mapping of an election against tallies of every area and tribe
+static bool mappingMatchesTallies(Election election, int tallies[POSTING_AREAS][POSTING_TRIBES],
+                                  const bool* areas, const bool* tribes) {
+    Map mapping = electionComputeAreasToTribesMapping(election);
+    bool matches = mapping != NULL;
+    for (int area = 0; area < POSTING_AREAS && matches; area++) {
+        char area_string[12], winner_string[12];
+        sprintf(area_string, "%d", area);
+        int winner = -1;
+        for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+            if (tribes[tribe] && (winner == -1 || tallies[area][tribe] > tallies[area][winner])) {
+                winner = tribe;
+            }
+        }
+        sprintf(winner_string, "%d", winner);
+        char* found = mapGet(mapping, area_string);
+        matches = areas[area] && winner != -1 ? found != NULL && strcmp(found, winner_string) == 0 : found == NULL;
+    }
+    mapDestroy(mapping);
+    return matches;
+}
+
+//checks the totals of an election against tallies of every area and tribe, in bulk and one by one
+static bool totalsMatchTallies(Election election, int tallies[POSTING_AREAS][POSTING_TRIBES],
+                               const bool* areas, const bool* tribes) {
+    int ids[POSTING_TRIBES];
+    long long totals[POSTING_TRIBES], total;
+    for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+        ids[tribe] = tribe;
+    }
+    bool all_tribes = true, all_areas = true;
+    electionGetTribeTotals(election, POSTING_TRIBES, ids, totals);
+    for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+        long long expected = tribes[tribe] ? 0 : -1;
+        for (int area = 0; area < POSTING_AREAS && tribes[tribe]; area++) {
+            expected += tallies[area][tribe];
+        }
+        all_tribes = all_tribes && tribes[tribe];
+        if (totals[tribe] != expected || (electionGetTribeTotal(election, tribe, &total) == ELECTION_SUCCESS
+                                          && total != expected)) {
+            return false;
+        }
+    }
+    if ((electionGetTribeTotals(election, POSTING_TRIBES, ids, totals) == ELECTION_SUCCESS) != all_tribes) {
+        return false;
+    }
+    electionGetAreaTotals(election, POSTING_AREAS, ids, totals); //the ids of the areas are 0 to POSTING_AREAS too
+    for (int area = 0; area < POSTING_AREAS; area++) {
+        long long expected = areas[area] ? 0 : -1;
+        for (int tribe = 0; tribe < POSTING_TRIBES && areas[area]; tribe++) {
+            expected += tallies[area][tribe];
+        }
+        all_areas = all_areas && areas[area];
+        if (totals[area] != expected || (electionGetAreaTotal(election, area, &total) == ELECTION_SUCCESS)
+                                        != areas[area]) {
+            return false;
+        }
+    }
+    return (electionGetAreaTotals(election, POSTING_AREAS, ids, totals) == ELECTION_SUCCESS) == all_areas;
+}
+
+//checks the top lists and the ranks of an area (or ELECTION_NATIONAL) against the tallies
+static bool rankingMatchesTallies(Election election, int tallies[POSTING_AREAS][POSTING_TRIBES],
+                                  const bool* tribes, int area_id) {
+    long long votes[POSTING_TRIBES], top_votes[POSTING_TRIBES];
+    int top[POSTING_TRIBES], count, rank;
+    for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+        votes[tribe] = 0;
+        for (int area = 0; area < POSTING_AREAS; area++) {
+            votes[tribe] += area_id == ELECTION_NATIONAL || area == area_id ? tallies[area][tribe] : 0;
+        }
+    }
+    for (int k = 0; k <= POSTING_TRIBES; k += 5) {
+        if (electionGetTopTribes(election, area_id, k, top, top_votes, &count) != ELECTION_SUCCESS) {
+            return false;
+        }
+        int expected_count = 0;
+        for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+            expected_count += votes[tribe] > 0;
+        }
+        if (count != (expected_count < k ? expected_count : k)) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) { //in order, and with the votes of the tribe
+            if (top_votes[i] != votes[top[i]] || top_votes[i] == 0 || (i > 0 && (top_votes[i - 1] < top_votes[i]
+                || (top_votes[i - 1] == top_votes[i] && top[i - 1] > top[i])))) {
+                return false;
+            }
+        }
+    }
+    for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+        int expected_rank = 1;
+        for (int other = 0; other < POSTING_TRIBES; other++) {
+            expected_rank += votes[other] > votes[tribe];
+        }
+        ElectionResult result = electionGetTribeRank(election, area_id, tribe, &rank);
+        if (tribes[tribe] ? result != ELECTION_SUCCESS || rank != expected_rank : result != ELECTION_TRIBE_NOT_EXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testElectionRemoveTribeVotes() {
+    Election election = electionCreate();
+    int tallies[POSTING_AREAS][POSTING_TRIBES] = {{0}};
+    bool areas[POSTING_AREAS], tribes[POSTING_TRIBES];
+    for (int area = 0; area < POSTING_AREAS; area++) {
+        ASSERT_TEST(electionAddArea(election, area, "area") == ELECTION_SUCCESS);
+        areas[area] = true;
+    }
+    for (int tribe = 0; tribe < POSTING_TRIBES; tribe++) {
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        tribes[tribe] = true;
+    }
+    srand(11);
+    for (int i = 0; i < 20000; i++) { //area 0 gets most votes, so it is dense while others are sparse at times
+        int area = rand() % 3 == 0 ? rand() % POSTING_AREAS : 0, tribe = rand() % POSTING_TRIBES;
+        int operation = rand() % 100, votes = rand() % 20 + 1;
+        bool exists = areas[area] && tribes[tribe];
+        if (operation < 60) {
+            ASSERT_TEST((electionAddVote(election, area, tribe, votes) == ELECTION_SUCCESS) == exists);
+            tallies[area][tribe] += exists ? votes : 0;
+        } else if (operation < 90) {
+            ASSERT_TEST((electionRemoveVote(election, area, tribe, votes) == ELECTION_SUCCESS) == exists);
+            tallies[area][tribe] = exists && tallies[area][tribe] > votes ? tallies[area][tribe] - votes : 0;
+        } else if (operation < 94) {
+            ASSERT_TEST((electionRemoveTribe(election, tribe) == ELECTION_SUCCESS) == tribes[tribe]);
+            tribes[tribe] = false;
+        } else if (operation < 98) { //a tribe or an area comes back without votes
+            tribes[tribe] = tribes[tribe] || electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS;
+            areas[area] = areas[area] || electionAddArea(election, area, "area") == ELECTION_SUCCESS;
+        } else {
+            area_to_remove = area;
+            ASSERT_TEST(electionRemoveAreas(election, isAreaToRemove) == ELECTION_SUCCESS);
+            areas[area] = false;
+        }
+        if (!tribes[tribe] || !areas[area]) { //the votes of a removed tribe or area are gone
+            for (int other = 0; other < POSTING_AREAS; other++) {
+                tallies[other][tribe] = tribes[tribe] ? tallies[other][tribe] : 0;
+            }
+            for (int other = 0; other < POSTING_TRIBES; other++) {
+                tallies[area][other] = areas[area] ? tallies[area][other] : 0;
+            }
+        }
+        if (i % 500 == 0) {
+            ASSERT_TEST(mappingMatchesTallies(election, tallies, areas, tribes));
+            ASSERT_TEST(totalsMatchTallies(election, tallies, areas, tribes));
+            ASSERT_TEST(rankingMatchesTallies(election, tallies, tribes, ELECTION_NATIONAL));
+            for (int other = 0; other < POSTING_AREAS; other++) {
+                ASSERT_TEST(!areas[other] || rankingMatchesTallies(election, tallies, tribes, other));
+            }
+        }
+    }
+    ASSERT_TEST(mappingMatchesTallies(election, tallies, areas, tribes));
+    ASSERT_TEST(totalsMatchTallies(election, tallies, areas, tribes));
+    electionDestroy(election);
+    return true;
+}
+
+bool testElectionTotals() {
+    Election election = electionCreate();
+    long long total, totals[3];
+    int ids[] = { 1, 2, 3 };
+    ASSERT_TEST(electionGetTribeTotal(NULL, 1, &total) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionGetAreaTotal(election, 1, NULL) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionGetTribeTotals(election, 3, NULL, totals) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionGetAreaTotals(election, -1, ids, totals) == ELECTION_ERROR);
+    ASSERT_TEST(electionGetTribeTotal(election, -1, &total) == ELECTION_INVALID_ID);
+    ASSERT_TEST(electionGetTribeTotal(election, 1, &total) == ELECTION_TRIBE_NOT_EXIST);
+    ASSERT_TEST(electionGetAreaTotal(election, 1, &total) == ELECTION_AREA_NOT_EXIST);
+    ASSERT_TEST(electionAddTribe(election, 1, "tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 2, "other tribe") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 1, "area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 2, "other area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 1, 1, 2000000000) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddVote(election, 2, 1, 2000000000) == ELECTION_SUCCESS); //more than an int holds
+    ASSERT_TEST(electionAddVote(election, 1, 2, 7) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveVote(election, 1, 2, 10) == ELECTION_SUCCESS); //only 7 are removed
+    ASSERT_TEST(electionAddVote(election, 2, 2, 5) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionGetTribeTotal(election, 1, &total) == ELECTION_SUCCESS && total == 4000000000LL);
+    ASSERT_TEST(electionGetTribeTotals(election, 3, ids, totals) == ELECTION_ERROR);
+    ASSERT_TEST(totals[0] == 4000000000LL && totals[1] == 5 && totals[2] == -1);
+    ASSERT_TEST(electionGetAreaTotals(election, 2, ids, totals) == ELECTION_SUCCESS);
+    ASSERT_TEST(totals[0] == 2000000000 && totals[1] == 2000000005);
+    ASSERT_TEST(electionRemoveTribe(election, 1) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionGetAreaTotal(election, 2, &total) == ELECTION_SUCCESS && total == 5);
+    ASSERT_TEST(electionRemoveAreas(election, deleteOnlyFirstArea) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddTribe(election, 1, "tribe again") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionGetTribeTotal(election, 1, &total) == ELECTION_SUCCESS && total == 0);
+    ASSERT_TEST(electionGetTribeTotal(election, 2, &total) == ELECTION_SUCCESS && total == 5);
+    electionDestroy(election);
+    return true;
+}
+
+bool testElectionTopTribes() {
+    Election election = electionCreate();
+    int top[5], count, rank;
+    long long votes[5];
+    ASSERT_TEST(electionGetTopTribes(NULL, 1, 5, top, votes, &count) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionGetTopTribes(election, 1, 5, top, NULL, &count) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionGetTopTribes(election, -2, 5, top, votes, &count) == ELECTION_INVALID_ID);
+    ASSERT_TEST(electionGetTopTribes(election, 1, -1, top, votes, &count) == ELECTION_ERROR);
+    ASSERT_TEST(electionGetTopTribes(election, 1, 5, top, votes, &count) == ELECTION_AREA_NOT_EXIST);
+    ASSERT_TEST(electionGetTribeRank(election, 1, -1, &rank) == ELECTION_INVALID_ID);
+    ASSERT_TEST(electionGetTribeRank(election, ELECTION_NATIONAL, 1, &rank) == ELECTION_TRIBE_NOT_EXIST);
+    ASSERT_TEST(electionAddArea(election, 1, "area") == ELECTION_SUCCESS);
+    ASSERT_TEST(electionAddArea(election, 2, "other area") == ELECTION_SUCCESS);
+    for (int tribe = 1; tribe <= 20; tribe++) { //enough tribes to make area 1 dense
+        ASSERT_TEST(electionAddTribe(election, tribe, "tribe") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddVote(election, 1, tribe, tribe % 7 + 1) == ELECTION_SUCCESS);
+    }
+    ASSERT_TEST(electionAddVote(election, 2, 3, 100) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionGetTopTribes(election, 1, 5, top, votes, &count) == ELECTION_SUCCESS && count == 5);
+    ASSERT_TEST(top[0] == 6 && top[1] == 13 && top[2] == 20 && top[3] == 5 && top[4] == 12 && votes[4] == 6);
+    ASSERT_TEST(electionGetTribeRank(election, 1, 12, &rank) == ELECTION_SUCCESS && rank == 4); //tied with 5
+    ASSERT_TEST(electionGetTopTribes(election, 2, 5, top, votes, &count) == ELECTION_SUCCESS && count == 1);
+    ASSERT_TEST(electionGetTribeRank(election, 2, 4, &rank) == ELECTION_SUCCESS && rank == 2);
+    ASSERT_TEST(electionGetTopTribes(election, ELECTION_NATIONAL, 2, top, votes, &count) == ELECTION_SUCCESS);
+    ASSERT_TEST(count == 2 && top[0] == 3 && votes[0] == 104 && top[1] == 6 && votes[1] == 7);
+    ASSERT_TEST(electionGetTribeRank(election, ELECTION_NATIONAL, 7, &rank) == ELECTION_SUCCESS && rank == 19);
+    electionDestroy(election);
+    return true;
+}
+
+#define RANGE_AREAS 200
+#define RANGE_TRIBES 40
+
+//marks the areas with even ids, counting its calls
+static void markEvenAreas(const int* area_ids, int count, uint64_t* remove_mask, void* calls) {
+    (*(int*)calls)++;
+    for (int i = 0; i < count; i++) {
+        remove_mask[i / ELECTION_MASK_BITS] |= (uint64_t)(area_ids[i] % 2 == 0) << (i % ELECTION_MASK_BITS);
+    }
+}
+
+static bool isEvenArea(int area_id) {
+    return area_id % 2 == 0;
+}
+
+//checks that two elections have the same winners and the same national list
+static bool sameResults(Election first, Election second) {
+    Map first_mapping = electionComputeAreasToTribesMapping(first);
+    Map second_mapping = electionComputeAreasToTribesMapping(second);
+    bool same = sameMapping(first_mapping, second_mapping);
+    mapDestroy(first_mapping);
+    mapDestroy(second_mapping);
+    int first_top[RANGE_TRIBES], second_top[RANGE_TRIBES], first_count, second_count;
+    long long first_votes[RANGE_TRIBES], second_votes[RANGE_TRIBES];
+    electionGetTopTribes(first, ELECTION_NATIONAL, RANGE_TRIBES, first_top, first_votes, &first_count);
+    electionGetTopTribes(second, ELECTION_NATIONAL, RANGE_TRIBES, second_top, second_votes, &second_count);
+    same = same && first_count == second_count;
+    for (int i = 0; i < first_count && same; i++) {
+        same = first_top[i] == second_top[i] && first_votes[i] == second_votes[i];
+    }
+    return same;
+}
+
+bool testElectionRemoveAreaRange() {
+    Election ranged = electionCreate(), single = electionCreate();
+    Election elections[] = { ranged, single };
+    for (int i = 0; i < 2; i++) {
+        for (int area = 0; area < RANGE_AREAS; area++) {
+            ASSERT_TEST(electionAddArea(elections[i], area, "area") == ELECTION_SUCCESS);
+        }
+        for (int tribe = 0; tribe < RANGE_TRIBES; tribe++) {
+            ASSERT_TEST(electionAddTribe(elections[i], tribe, "tribe") == ELECTION_SUCCESS);
+        }
+        srand(5);
+        for (int vote = 0; vote < 20000; vote++) { //areas 0 to 19 get most votes, so they are dense
+            int area = rand() % 4 == 0 ? rand() % RANGE_AREAS : rand() % 20;
+            ASSERT_TEST(electionAddVote(elections[i], area, rand() % RANGE_TRIBES, rand() % 50 + 1)
+                        == ELECTION_SUCCESS);
+        }
+    }
+    int calls = 0;
+    long long total;
+    ASSERT_TEST(electionRemoveAreaRange(NULL, 1, 2) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionRemoveAreasBatch(ranged, NULL, &calls) == ELECTION_NULL_ARGUMENT);
+    ASSERT_TEST(electionRemoveAreaRange(ranged, 2, 1) == ELECTION_ERROR);
+    ASSERT_TEST(electionRemoveAreaRange(ranged, 10, 149) == ELECTION_SUCCESS);
+    for (int area = 10; area <= 149; area++) {
+        area_to_remove = area;
+        ASSERT_TEST(electionRemoveAreas(single, isAreaToRemove) == ELECTION_SUCCESS);
+    }
+    ASSERT_TEST(sameResults(ranged, single));
+    ASSERT_TEST(electionGetAreaTotal(ranged, 10, &total) == ELECTION_AREA_NOT_EXIST);
+    ASSERT_TEST(electionGetAreaTotal(ranged, 150, &total) == ELECTION_SUCCESS);
+    ASSERT_TEST(electionRemoveAreasBatch(ranged, markEvenAreas, &calls) == ELECTION_SUCCESS && calls == 1);
+    ASSERT_TEST(electionRemoveAreas(single, isEvenArea) == ELECTION_SUCCESS);
+    ASSERT_TEST(sameResults(ranged, single));
+    for (int i = 0; i < 2; i++) { //removed areas come back, and the areas left still take votes
+        ASSERT_TEST(electionAddArea(elections[i], 12, "area again") == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddArea(elections[i], 3, "area") == ELECTION_AREA_ALREADY_EXIST);
+        ASSERT_TEST(electionAddVote(elections[i], 12, 7, 1000) == ELECTION_SUCCESS);
+        ASSERT_TEST(electionAddVote(elections[i], 3, 8, 1000) == ELECTION_SUCCESS);
+    }
+    ASSERT_TEST(sameResults(ranged, single));
+    ASSERT_TEST(electionRemoveAreaRange(ranged, INT_MIN, INT_MAX) == ELECTION_SUCCESS);
+    int top, count;
+    ASSERT_TEST(electionGetTopTribes(ranged, ELECTION_NATIONAL, 1, &top, &total, &count) == ELECTION_SUCCESS);
+    ASSERT_TEST(count == 0);
+    electionDestroy(ranged);
+    electionDestroy(single);
+    return true;
+}
+
 /*The functions for the tests should be added here*/
 bool (*tests[]) (void) = {
-                      testElectionRemoveAreas
+                      testElectionRemoveAreas,
+                      testElectionCustomAllocator,
+                      testElectionMemoryUsage,
+                      testElectionComputeMapping,
+                      testElectionDenseVotes,
+                      testElectionComputeMappingParallel,
+                      testElectionVotesBatch,
+                      testElectionIngestFile,
+                      testElectionIngestParallel,
+                      testArgmaxFind,
+                      testElectionConcurrent,
+                      testElectionQueue,
+                      testElectionRemoveTribeVotes,
+                      testElectionTotals,
+                      testElectionTopTribes,
+                      testElectionRemoveAreaRange
 };
 
 /*The names of the test functions should be added here*/
 const char* testNames[] = {
-                           "testElectionRemoveAreas"
+                           "testElectionRemoveAreas",
+                           "testElectionCustomAllocator",
+                           "testElectionMemoryUsage",
+                           "testElectionComputeMapping",
+                           "testElectionDenseVotes",
+                           "testElectionComputeMappingParallel",
+                           "testElectionVotesBatch",
+                           "testElectionIngestFile",
+                           "testElectionIngestParallel",
+                           "testArgmaxFind",
+                           "testElectionConcurrent",
+                           "testElectionQueue",
+                           "testElectionRemoveTribeVotes",
+                           "testElectionTotals",
+                           "testElectionTopTribes",
+                           "testElectionRemoveAreaRange"
 };
 
 int main(int argc, char *argv[]) {
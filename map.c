@@ -1,90 +1,556 @@
 #include "map.h"
-#include "keyValue.h"
+#include "pageStorage.h"
+#include "hash.h"
+#include "bucketTree.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
-/** The initial size of the map key-value array */
+/** The initial size of the map key and value arrays */
 #define INITIAL_SIZE 10
-/** The factor by which to expand the key-value array when needed */
+/** The factor by which to expand the key and value arrays when needed */
 #define EXPAND_FACTOR 2
 /** The pointer points on NULL argument or if the element was not found**/
 #define ELEMENT_NOT_FOUND -1
+/** A bucket whose collision chain grows longer than this is turned into a tree */
+#define TREEIFY_THRESHOLD 8
+/** A tree bucket which shrinks to this size is turned back into a chain */
+#define UNTREEIFY_THRESHOLD 6
+/** The sorted view is patched for this many changes between reads, then rebuilt instead */
+#define SORTED_PATCH_LIMIT 32
+/** The number of values of a byte, the buckets of a radix sort pass */
+#define RADIX 256
 
+/*
+ * macro RESERVE_ARRAY:
+ * grows one of the element arrays of the map to hold at least new_capacity items,
+ * returns MAP_OUT_OF_MEMORY if it fails (the array is then left as it was).
+ *
+ */
+#define RESERVE_ARRAY(map, array, new_capacity) \
+    do { \
+        if ((map)->array##_capacity < (new_capacity)) { \
+            void* grown_array = growArray(map, (map)->array, sizeof(*(map)->array), \
+                                          (map)->array##_capacity, new_capacity); \
+            if (grown_array == NULL) { \
+                return MAP_OUT_OF_MEMORY; \
+            } \
+            (map)->array = grown_array; \
+            (map)->array##_capacity = (new_capacity); \
+        } \
+    } while(0)
+    // RESERVE_ARRAY ends here
+
+//the elements are kept contiguous: keys[i], values[i], hashes[i] and next[i] form the i-th element.
+//a hash index over the elements finds them: every bucket is either a chain of
+//elements linked through next[], or (when its chain grew too long) a tree
 struct Map_t {
-    KeyValue* elements;
+    Allocator allocator; //a copy of the allocator the map and all its elements are taken from
+    uint64_t seed; //the hash seed of the process, read once so hashing takes no lock
+    char** keys;
+    char** values;
+    uint32_t* hashes; //the hash of every key, so rehashing and chain walks don't rehash keys
+    int* next; //the next element in the chain of the same bucket, ELEMENT_NOT_FOUND ends the chain
+    unsigned char* referenced; //the CLOCK bit of every element, set by every lookup that finds it
+    int keys_capacity; //every array tracks its own capacity, so a failed expand leaves them valid
+    int values_capacity;
+    int hashes_capacity;
+    int next_capacity;
+    int referenced_capacity;
     int size;
-    int max_size;
+    int max_size; //the number of elements all the arrays can hold
     int iterator;
+    int* buckets; //the first element of every chain
+    BucketTree* trees; //the tree of every bucket, NULL until the first bucket is turned into a tree
+    int bucket_count; //a power of 2, at least max_size
+    int tree_buckets; //the number of buckets that are trees
+    int longest_chain; //the longest chain seen since the index was last rebuilt
+    int capacity; //the most elements the map keeps, 0 if it is not bounded
+    int clock_hand; //the next element the eviction considers
+    MapEvictionFunction on_evict;
+    void* evict_context;
+    char** sorted; //the keys in the order of mapGetSortedKeys, built on the first call
+    int sorted_capacity;
+    bool sorted_valid; //false when sorted has to be rebuilt
+    int sorted_patches; //the changes patched into sorted since it was last read
 };
 
-static MapResult addOrDestroy(Map map,KeyValue element) {
-    MapResult result = mapPut(map, keyGet(element),valueGet(element));
-    if (result == MAP_OUT_OF_MEMORY) {
-        mapDestroy(map);
+static void* growArray(Map map, void* array, size_t item_size, int capacity, int new_capacity) {
+    return map->allocator.reallocate(map->allocator.context, array, (size_t)capacity * item_size,
+                                     (size_t)new_capacity * item_size); //large arrays are remapped, not copied
+}
+
+static void freeArray(Map map, void* array, size_t item_size, int capacity) {
+    if (array == NULL) {
+        return;
     }
-    return result;
+    map->allocator.deallocate(map->allocator.context, array, (size_t)capacity * item_size);
 }
 
-static MapResult addAllOrDestroy(Map map, Map toAdd) {
-for (int i = 0; i < toAdd->size; ++i) {
-    KeyValue element=toAdd->elements[i];
-    if (addOrDestroy(map,element ) == MAP_OUT_OF_MEMORY) {
-        return MAP_OUT_OF_MEMORY;
+static inline int bucketOf(Map map, uint32_t hash) {
+    return (int)(hash & (uint32_t)(map->bucket_count - 1));
+}
+
+static inline bool isTree(Map map, int bucket) {
+    return map->trees != NULL && map->trees[bucket] != NULL;
+}
+
+//turns a chain into a tree, if allocations fail the bucket simply stays a chain
+static void treeify(Map map, int bucket) {
+    if (map->trees == NULL) {
+        size_t trees_size = (size_t)map->bucket_count * sizeof(*map->trees);
+        map->trees = map->allocator.allocate(map->allocator.context, trees_size);
+        if (map->trees == NULL) {
+            return;
+        }
+        memset(map->trees, 0, trees_size);
+    }
+    BucketTree tree = NULL;
+    for (int i = map->buckets[bucket]; i != ELEMENT_NOT_FOUND; i = map->next[i]) {
+        if (!bucketTreeInsert(&tree, map->keys[i], map->hashes[i], i, &map->allocator)) {
+            bucketTreeDestroy(tree, &map->allocator);
+            return;
+        }
+    }
+    map->trees[bucket] = tree;
+    map->buckets[bucket] = ELEMENT_NOT_FOUND;
+    map->tree_buckets++;
+}
+
+static void pushToChain(int index, void* context) {
+    Map map = context;
+    int bucket = bucketOf(map, map->hashes[index]);
+    map->next[index] = map->buckets[bucket];
+    map->buckets[bucket] = index;
+}
+
+static void untreeify(Map map, int bucket) {
+    map->buckets[bucket] = ELEMENT_NOT_FOUND;
+    bucketTreeForEach(map->trees[bucket], pushToChain, map);
+    bucketTreeDestroy(map->trees[bucket], &map->allocator);
+    map->trees[bucket] = NULL;
+    map->tree_buckets--;
+}
+
+//deallocates all the trees, their elements are left unlinked
+static void destroyTrees(Map map) {
+    if (map->trees == NULL) {
+        return;
+    }
+    for (int bucket = 0; bucket < map->bucket_count && map->tree_buckets > 0; bucket++) {
+        if (map->trees[bucket] != NULL) {
+            bucketTreeDestroy(map->trees[bucket], &map->allocator);
+            map->trees[bucket] = NULL;
+            map->tree_buckets--;
+        }
     }
+    freeArray(map, map->trees, sizeof(*map->trees), map->bucket_count);
+    map->trees = NULL;
+    map->tree_buckets = 0;
 }
+
+//adds the element at index to the index, the element must not be linked already. a tree bucket
+//takes the spare node if there is one (and clears it), so the link can't fail
+static MapResult linkElement(Map map, int index, BucketTree* spare) {
+    int bucket = bucketOf(map, map->hashes[index]);
+    if (isTree(map, bucket)) {
+        if (*spare != NULL) {
+            bucketTreeInsertNode(&map->trees[bucket], *spare, map->keys[index], map->hashes[index], index);
+            *spare = NULL;
+            return MAP_SUCCESS;
+        }
+        if (!bucketTreeInsert(&map->trees[bucket], map->keys[index], map->hashes[index], index,
+                              &map->allocator)) {
+            return MAP_OUT_OF_MEMORY;
+        }
+        return MAP_SUCCESS;
+    }
+    pushToChain(index, map);
+    int chain_length = 0;
+    for (int i = index; i != ELEMENT_NOT_FOUND; i = map->next[i]) {
+        chain_length++;
+    }
+    if (chain_length > map->longest_chain) {
+        map->longest_chain = chain_length;
+    }
+    if (chain_length > TREEIFY_THRESHOLD) {
+        treeify(map, bucket);
+    }
     return MAP_SUCCESS;
 }
 
-static int mapFind(Map map, const char* key) {
+static void unlinkElement(Map map, int index) {
+    int bucket = bucketOf(map, map->hashes[index]);
+    if (isTree(map, bucket)) {
+        bucketTreeRemove(&map->trees[bucket], map->keys[index], map->hashes[index], &map->allocator);
+        if (bucketTreeGetSize(map->trees[bucket]) <= UNTREEIFY_THRESHOLD) {
+            untreeify(map, bucket);
+        }
+        return;
+    }
+    int* link = &map->buckets[bucket];
+    while (*link != index) {
+        assert(*link != ELEMENT_NOT_FOUND);
+        link = &map->next[*link];
+    }
+    *link = map->next[index];
+}
+
+//points the index at the element that was moved from index from to index to
+static void relinkElement(Map map, int from, int to) {
+    int bucket = bucketOf(map, map->hashes[to]);
+    if (isTree(map, bucket)) {
+        bucketTreeSetIndex(map->trees[bucket], map->keys[to], map->hashes[to], to);
+        return;
+    }
+    int* link = &map->buckets[bucket];
+    while (*link != from) {
+        assert(*link != ELEMENT_NOT_FOUND);
+        link = &map->next[*link];
+    }
+    *link = to;
+}
+
+//rebuilds the index with a new number of buckets
+static MapResult rehash(Map map, int bucket_count) {
+    int* buckets = map->allocator.allocate(map->allocator.context, (size_t)bucket_count * sizeof(*buckets));
+    if (buckets == NULL) {
+        return MAP_OUT_OF_MEMORY;
+    }
+    destroyTrees(map);
+    freeArray(map, map->buckets, sizeof(*map->buckets), map->bucket_count);
+    map->buckets = buckets;
+    map->bucket_count = bucket_count;
+    map->longest_chain = 0;
+    for (int bucket = 0; bucket < bucket_count; bucket++) {
+        buckets[bucket] = ELEMENT_NOT_FOUND;
+    }
     for (int i = 0; i < map->size; i++) {
-        if (strcmp(keyGet(map->elements[i]), key) == 0) {
+        pushToChain(i, map); //the chains are measured (and treeified) once they are all built
+    }
+    for (int bucket = 0; bucket < bucket_count; bucket++) {
+        int chain_length = 0;
+        for (int i = buckets[bucket]; i != ELEMENT_NOT_FOUND; i = map->next[i]) {
+            chain_length++;
+        }
+        if (chain_length > map->longest_chain) {
+            map->longest_chain = chain_length;
+        }
+        if (chain_length > TREEIFY_THRESHOLD) {
+            treeify(map, bucket);
+        }
+    }
+    return MAP_SUCCESS;
+}
+
+static MapResult reserve(Map map, int new_capacity) {
+    RESERVE_ARRAY(map, keys, new_capacity);
+    RESERVE_ARRAY(map, values, new_capacity);
+    RESERVE_ARRAY(map, hashes, new_capacity);
+    RESERVE_ARRAY(map, next, new_capacity);
+    RESERVE_ARRAY(map, referenced, new_capacity);
+    if (map->bucket_count < new_capacity) {
+        int bucket_count = map->bucket_count > 0 ? map->bucket_count : 1;
+        while (bucket_count < new_capacity) {
+            bucket_count *= 2;
+        }
+        if (rehash(map, bucket_count) == MAP_OUT_OF_MEMORY) {
+            return MAP_OUT_OF_MEMORY;
+        }
+    }
+    map->max_size = new_capacity;
+    return MAP_SUCCESS;
+}
+
+static MapResult expand(Map map) {
+    return reserve(map, EXPAND_FACTOR * map->max_size);
+}
+
+static MapResult addAllOrDestroy(Map map, Map toAdd) {
+    if (reserve(map, toAdd->max_size) == MAP_OUT_OF_MEMORY) {
+        mapDestroy(map);
+        return MAP_OUT_OF_MEMORY;
+    }
+    for (int i = 0; i < toAdd->size; ++i) {
+        if (mapPut(map, toAdd->keys[i], toAdd->values[i]) == MAP_OUT_OF_MEMORY) {
+            mapDestroy(map);
+            return MAP_OUT_OF_MEMORY;
+        }
+    }
+    return MAP_SUCCESS;
+}
+
+//marks an element as recently used. a relaxed atomic store, so lookups may run concurrently;
+//the bit is only written when it is clear, so hot elements don't keep dirtying their cache line
+static inline void touch(Map map, int index) {
+    if (map->capacity > 0 && !__atomic_load_n(&map->referenced[index], __ATOMIC_RELAXED)) {
+        __atomic_store_n(&map->referenced[index], 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int findInBucket(Map map, const char* key, uint32_t hash) {
+    int bucket = bucketOf(map, hash);
+    if (isTree(map, bucket)) {
+        return bucketTreeFind(map->trees[bucket], key, hash);
+    }
+    for (int i = map->buckets[bucket]; i != ELEMENT_NOT_FOUND; i = map->next[i]) {
+        if (map->hashes[i] == hash && strcmp(map->keys[i], key) == 0) {
             return i;
         }
     }
     return ELEMENT_NOT_FOUND;
 }
 
-static MapResult expand(Map map) {
-    int new_size = EXPAND_FACTOR * map->max_size;
-    KeyValue* newElements = realloc(map->elements, new_size * sizeof(KeyValue));
-    if (newElements == NULL) {
+static int findWithHash(Map map, const char* key, uint32_t hash) {
+    int index = findInBucket(map, key, hash);
+    if (index != ELEMENT_NOT_FOUND) {
+        touch(map, index);
+    }
+    return index;
+}
+
+static int mapFind(Map map, const char* key) {
+    return findWithHash(map, key, hashKey(key, strlen(key), map->seed));
+}
+
+//deallocates the key and the value of an element
+static void elementDestroy(Map map, int index) {
+    allocatorFreeString(&map->allocator, map->keys[index]);
+    allocatorFreeString(&map->allocator, map->values[index]);
+}
+
+//the order of the sorted view: shorter keys first, keys of the same length byte by byte
+static int compareKeys(const char* first, const char* second) {
+    size_t first_length = strlen(first), second_length = strlen(second);
+    if (first_length != second_length) {
+        return first_length < second_length ? -1 : 1;
+    }
+    return memcmp(first, second, first_length);
+}
+
+//the position of a key in the sorted view, or the position it should be added at
+static int sortedPosition(Map map, const char* key) {
+    int low = 0, high = map->size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (compareKeys(map->sorted[middle], key) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+//counts a change of the keys against the patch limit, false if the view should be rebuilt instead
+static bool startPatch(Map map) {
+    if (!map->sorted_valid) {
+        return false;
+    }
+    if (++map->sorted_patches > SORTED_PATCH_LIMIT) { //a bulk change: sorting again is cheaper
+        map->sorted_valid = false;
+        return false;
+    }
+    return true;
+}
+
+//adds a new key (the map's size doesn't count it yet) to the sorted view
+static void sortedInsert(Map map, char* key) {
+    if (!startPatch(map)) {
+        return;
+    }
+    if (map->sorted_capacity <= map->size) {
+        map->sorted_valid = false;
+        return;
+    }
+    int position = sortedPosition(map, key);
+    memmove(map->sorted + position + 1, map->sorted + position,
+            (size_t)(map->size - position) * sizeof(*map->sorted));
+    map->sorted[position] = key;
+}
+
+//removes a key (the map's size still counts it) from the sorted view
+static void sortedRemove(Map map, const char* key) {
+    if (!startPatch(map)) {
+        return;
+    }
+    int position = sortedPosition(map, key);
+    assert(position < map->size && map->sorted[position] == key);
+    memmove(map->sorted + position, map->sorted + position + 1,
+            (size_t)(map->size - position - 1) * sizeof(*map->sorted));
+}
+
+//one stable counting pass of the radix sort over the byte at position of keys of the same length
+static void radixPass(char** keys, char** buffer, int count, size_t position) {
+    int counts[RADIX + 1] = {0};
+    for (int i = 0; i < count; i++) {
+        counts[(unsigned char)keys[i][position] + 1]++;
+    }
+    for (int digit = 0; digit < RADIX; digit++) {
+        counts[digit + 1] += counts[digit];
+    }
+    for (int i = 0; i < count; i++) {
+        buffer[counts[(unsigned char)keys[i][position]]++] = keys[i];
+    }
+    memcpy(keys, buffer, (size_t)count * sizeof(*keys));
+}
+
+//sorts the keys into the sorted view: a counting sort by length, and then LSD radix
+//passes within every length, so the work is linear in the total length of the keys
+static MapResult buildSortedKeys(Map map) {
+    if (map->sorted_capacity < map->max_size) {
+        void* grown_array = growArray(map, map->sorted, sizeof(*map->sorted),
+                                      map->sorted_capacity, map->max_size);
+        if (grown_array == NULL) {
+            return MAP_OUT_OF_MEMORY;
+        }
+        map->sorted = grown_array;
+        map->sorted_capacity = map->max_size;
+    }
+    int count = map->size;
+    size_t max_length = 0;
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(map->keys[i]);
+        max_length = length > max_length ? length : max_length;
+    }
+    int buffer_count = count > 0 ? count : 1, starts_count = (int)max_length + 2;
+    char** buffer = map->allocator.allocate(map->allocator.context, buffer_count * sizeof(*buffer));
+    int* starts = map->allocator.allocate(map->allocator.context, starts_count * sizeof(*starts));
+    if (buffer == NULL || starts == NULL) {
+        freeArray(map, buffer, sizeof(*buffer), buffer_count);
+        freeArray(map, starts, sizeof(*starts), starts_count);
         return MAP_OUT_OF_MEMORY;
     }
-    map->elements = newElements;
-    map->max_size = new_size;
+    memset(starts, 0, starts_count * sizeof(*starts));
+    for (int i = 0; i < count; i++) {
+        starts[strlen(map->keys[i]) + 1]++;
+    }
+    for (size_t length = 0; length <= max_length; length++) {
+        starts[length + 1] += starts[length];
+    }
+    for (int i = 0; i < count; i++) { //starts[length] ends up as the end of the group of length
+        map->sorted[starts[strlen(map->keys[i])]++] = map->keys[i];
+    }
+    int group_start = 0;
+    for (size_t length = 0; length <= max_length; length++) {
+        int group_end = starts[length];
+        for (size_t position = length; position > 0; position--) {
+            radixPass(map->sorted + group_start, buffer, group_end - group_start, position - 1);
+        }
+        group_start = group_end;
+    }
+    freeArray(map, buffer, sizeof(*buffer), buffer_count);
+    freeArray(map, starts, sizeof(*starts), starts_count);
+    map->sorted_valid = true;
+    map->sorted_patches = 0;
     return MAP_SUCCESS;
 }
 
+//removes an element, the last element fills the gap
+static void removeAt(Map map, int index) {
+    sortedRemove(map, map->keys[index]);
+    unlinkElement(map, index);
+    elementDestroy(map, index);
+    int last = map->size - 1;
+    if (index != last) {
+        map->keys[index] = map->keys[last];
+        map->values[index] = map->values[last];
+        map->hashes[index] = map->hashes[last];
+        map->next[index] = map->next[last];
+        map->referenced[index] = map->referenced[last];
+        relinkElement(map, last, index);
+    }
+    map->size--;
+}
+
+//removes one element chosen by the CLOCK policy: the hand sweeps the elements, clearing
+//their referenced bits, and evicts the first element whose bit is already clear
+static void evictOne(Map map) {
+    assert(map->size > 0);
+    while (true) {
+        if (map->clock_hand >= map->size) {
+            map->clock_hand = 0;
+        }
+        if (!map->referenced[map->clock_hand]) {
+            break;
+        }
+        map->referenced[map->clock_hand] = 0;
+        map->clock_hand++;
+    }
+    int victim = map->clock_hand; //the last element moves here, so the hand will check it next
+    if (map->on_evict != NULL) {
+        map->on_evict(map->keys[victim], map->values[victim], map->evict_context);
+    }
+    removeAt(map, victim);
+}
+
 Map mapCreate() {
-    Map map = malloc(sizeof(*map));
-    if (map == NULL) {
+    return mapCreateWithAllocator(allocatorGetDefault());
+}
+
+Map mapCreateWithAllocator(const Allocator* allocator) {
+    if (!allocatorIsValid(allocator)) {
         return NULL;
     }
-    map->elements = malloc(INITIAL_SIZE * sizeof(KeyValue));
-    if (map->elements == NULL) {
-        free(map);
+    Map map = allocator->allocate(allocator->context, sizeof(*map));
+    if (map == NULL) {
         return NULL;
     }
+    map->allocator = *allocator;
+    map->seed = hashGetSeed();
+    map->keys = NULL;
+    map->values = NULL;
+    map->hashes = NULL;
+    map->next = NULL;
+    map->referenced = NULL;
+    map->keys_capacity = 0;
+    map->values_capacity = 0;
+    map->hashes_capacity = 0;
+    map->next_capacity = 0;
+    map->referenced_capacity = 0;
     map->size = 0;
-    map->max_size = INITIAL_SIZE;
+    map->max_size = 0;
     map->iterator = 0;
+    map->buckets = NULL;
+    map->trees = NULL;
+    map->bucket_count = 0;
+    map->tree_buckets = 0;
+    map->longest_chain = 0;
+    map->capacity = 0;
+    map->clock_hand = 0;
+    map->on_evict = NULL;
+    map->evict_context = NULL;
+    map->sorted = NULL;
+    map->sorted_capacity = 0;
+    map->sorted_valid = false;
+    map->sorted_patches = 0;
+    if (reserve(map, INITIAL_SIZE) == MAP_OUT_OF_MEMORY) {
+        mapDestroy(map);
+        return NULL;
+    }
     return map;
 }
 
 void mapDestroy(Map map){
     if(mapClear(map) != MAP_NULL_ARGUMENT){
-        free(map->elements); //deallocates the key-value array
-        free(map); //deallocates the map
-    }  
+        Allocator allocator = map->allocator; //the map holds the allocator, keep it until the end
+        freeArray(map, map->keys, sizeof(*map->keys), map->keys_capacity); //deallocates the element arrays
+        freeArray(map, map->values, sizeof(*map->values), map->values_capacity);
+        freeArray(map, map->hashes, sizeof(*map->hashes), map->hashes_capacity);
+        freeArray(map, map->next, sizeof(*map->next), map->next_capacity);
+        freeArray(map, map->referenced, sizeof(*map->referenced), map->referenced_capacity);
+        freeArray(map, map->sorted, sizeof(*map->sorted), map->sorted_capacity);
+        freeArray(map, map->buckets, sizeof(*map->buckets), map->bucket_count); //mapClear freed the trees
+        allocator.deallocate(allocator.context, map, sizeof(*map)); //deallocates the map
+    }
 }
 
 Map mapCopy(Map map) {
     if (map == NULL) {
         return NULL;
     }
-    Map newMap = mapCreate();
+    Map newMap = mapCreateWithAllocator(&map->allocator);
     if (newMap == NULL) {
         return NULL;
     }
@@ -92,6 +558,9 @@ Map mapCopy(Map map) {
         return NULL;
     }
     newMap->iterator = map->iterator;
+    newMap->capacity = map->capacity;
+    newMap->on_evict = map->on_evict;
+    newMap->evict_context = map->evict_context;
     return newMap;
 }
 
@@ -109,37 +578,115 @@ bool mapContains(Map map, const char* key) {
     return mapFind(map,key)!=ELEMENT_NOT_FOUND; //false if mapFind failes, true otherwise
 }
 
+//replaces the data of an element, reusing its copy when the new data has the same length
+static MapResult replaceData(Map map, int index, const char* data) {
+    size_t length = strlen(data);
+    if (strlen(map->values[index]) == length) {
+        memmove(map->values[index], data, length);
+        return MAP_SUCCESS;
+    }
+    char* data_copy = allocatorCopyString(&map->allocator, data);
+    if (data_copy == NULL) {
+        return MAP_OUT_OF_MEMORY;
+    }
+    allocatorFreeString(&map->allocator, map->values[index]); //deallocates previous value
+    map->values[index] = data_copy;
+    return MAP_SUCCESS;
+}
+
+//adds a new element whose key was already hashed and looked up, returns its index
+static int insertWithHash(Map map, const char* key, uint32_t hash, const char* data) {
+    char* data_copy = allocatorCopyString(&map->allocator, data);
+    char* key_copy = allocatorCopyString(&map->allocator, key);
+    if (data_copy == NULL || key_copy == NULL) {
+        allocatorFreeString(&map->allocator, data_copy);
+        allocatorFreeString(&map->allocator, key_copy);
+        return ELEMENT_NOT_FOUND;
+    }
+    bool at_bound = map->capacity > 0 && map->size >= map->capacity;
+    if (!at_bound && map->size == map->max_size) { //if the map is full and needs a reallocation:
+        if (expand(map) == MAP_OUT_OF_MEMORY) {
+            allocatorFreeString(&map->allocator, data_copy);
+            allocatorFreeString(&map->allocator, key_copy);
+            return ELEMENT_NOT_FOUND;
+        }
+    }
+    BucketTree spare = NULL;
+    if (at_bound && isTree(map, bucketOf(map, hash))) { //the link's node is taken before the victim goes
+        spare = bucketTreeCreateNode(&map->allocator);
+        if (spare == NULL) {
+            allocatorFreeString(&map->allocator, data_copy);
+            allocatorFreeString(&map->allocator, key_copy);
+            return ELEMENT_NOT_FOUND;
+        }
+    }
+    if (at_bound) { //needs no growth: makes room only once nothing left can fail, so a failure loses nothing
+        evictOne(map);
+    }
+    map->keys[map->size] = key_copy;
+    map->values[map->size] = data_copy;
+    map->hashes[map->size] = hash;
+    map->referenced[map->size] = 1; //a new element survives the first sweep of the hand
+    MapResult linked = linkElement(map, map->size, &spare);
+    bucketTreeDestroy(spare, &map->allocator); //unused if the eviction turned the bucket back into a chain
+    if (linked == MAP_OUT_OF_MEMORY) { //only when not at the bound, nothing was evicted
+        elementDestroy(map, map->size);
+        return ELEMENT_NOT_FOUND;
+    }
+    sortedInsert(map, key_copy);
+    return map->size++;
+}
+
 MapResult mapPut(Map map, const char* key, const char* data) {
     if (map == NULL || key == NULL || data == NULL) {
         return MAP_NULL_ARGUMENT;
     }
-    int index = mapFind(map,key);
+    uint32_t hash = hashKey(key, strlen(key), map->seed);
+    int index = findWithHash(map, key, hash);
     if (index != ELEMENT_NOT_FOUND) { //if the key exists already:
-        free(valueGet(map->elements[index])); //deallocates previous value
-        KeyValueResult result = valueSet(map->elements[index], data);
-        if (result == KEY_VALUE_NULL_ARGUMENT) {
-            return MAP_NULL_ARGUMENT;
-        }
-        return MAP_SUCCESS;
+        return replaceData(map, index, data);
     }
-    if (map->size == map->max_size) { //if the map is full and needs a reallocation:
-        if (expand(map) == MAP_OUT_OF_MEMORY) {
-            return MAP_OUT_OF_MEMORY;
+    if (insertWithHash(map, key, hash, data) == ELEMENT_NOT_FOUND) {
+        return MAP_OUT_OF_MEMORY;
+    }
+    return MAP_SUCCESS;
+}
+
+const char* mapGetOrInsert(Map map, const char* key, const char* default_data, bool* inserted) {
+    if (map == NULL || key == NULL || default_data == NULL) {
+        return NULL;
+    }
+    uint32_t hash = hashKey(key, strlen(key), map->seed);
+    int index = findWithHash(map, key, hash);
+    bool is_new = index == ELEMENT_NOT_FOUND;
+    if (is_new) {
+        index = insertWithHash(map, key, hash, default_data);
+        if (index == ELEMENT_NOT_FOUND) {
+            return NULL;
         }
     }
-    map->elements[map->size] = keyValueCreate(); //allocates space for the new key-value
-    if (map->elements[map->size] == NULL) {
-        return MAP_OUT_OF_MEMORY;
+    if (inserted != NULL) {
+        *inserted = is_new;
     }
-    if (keySet(map->elements[map->size], key) == KEY_VALUE_NULL_ARGUMENT) {
-        keyValueDestroy(map->elements[map->size]);
+    return map->values[index];
+}
+
+MapResult mapUpdate(Map map, const char* key, MapUpdateFunction function, void* context) {
+    if (map == NULL || key == NULL || function == NULL) {
         return MAP_NULL_ARGUMENT;
     }
-    if (valueSet(map->elements[map->size], data) == KEY_VALUE_NULL_ARGUMENT) {
-        keyValueDestroy(map->elements[map->size]);
-        return MAP_NULL_ARGUMENT;
+    uint32_t hash = hashKey(key, strlen(key), map->seed);
+    int index = findWithHash(map, key, hash);
+    const char* new_data = function(key, index == ELEMENT_NOT_FOUND ? NULL : map->values[index], context);
+    if (new_data == NULL) { //the function left the element as it was
+        return MAP_SUCCESS;
+    }
+    if (index != ELEMENT_NOT_FOUND) {
+        return replaceData(map, index, new_data);
+    }
+    if (insertWithHash(map, key, hash, new_data) == ELEMENT_NOT_FOUND) {
+        return MAP_OUT_OF_MEMORY;
     }
-    map->size++;
     return MAP_SUCCESS;
 }
 
@@ -151,9 +698,8 @@ char* mapGet(Map map, const char* key){
     if(index == ELEMENT_NOT_FOUND){
         return NULL;
     }
-    KeyValue element = map->elements[index];
-    return valueGet(element);
-}    
+    return map->values[index];
+}
 
 MapResult mapRemove(Map map, const char* key){
     if(map == NULL || key == NULL){
@@ -163,10 +709,8 @@ MapResult mapRemove(Map map, const char* key){
     if(index==ELEMENT_NOT_FOUND){
         return MAP_ITEM_DOES_NOT_EXIST;
     }
-    keyValueDestroy(map->elements[index]);
-    map->elements[index] = map->elements[map->size-1];
-    map->size--;
-    return MAP_SUCCESS;    
+    removeAt(map, index);
+    return MAP_SUCCESS;
 }
 
 char* mapGetFirst(Map map){
@@ -181,20 +725,157 @@ char* mapGetNext(Map map){
     if(map == NULL || map->iterator >= map->size){
         return NULL;
     }
-    KeyValue element = map->elements[map->iterator];
-    map->iterator++;
-    return keyGet(element);
+    return map->keys[map->iterator++];
+}
+
+MapResult mapForEach(Map map, MapForEachFunction function, void* context) {
+    if (map == NULL || function == NULL) {
+        return MAP_NULL_ARGUMENT;
+    }
+    for (int i = 0; i < map->size; i++) {
+        function(map->keys[i], map->values[i], context);
+    }
+    return MAP_SUCCESS;
+}
+
+int mapGetEntries(Map map, const char* const** keys, const char* const** data) {
+    if (map == NULL || keys == NULL || data == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    *keys = (const char* const*)map->keys;
+    *data = (const char* const*)map->values;
+    return map->size;
+}
+
+int mapGetSortedKeys(Map map, const char* const** keys) {
+    if (map == NULL || keys == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    if (!map->sorted_valid && buildSortedKeys(map) == MAP_OUT_OF_MEMORY) {
+        return ELEMENT_NOT_FOUND;
+    }
+    map->sorted_patches = 0;
+    *keys = (const char* const*)map->sorted;
+    return map->size;
+}
+
+size_t mapGetMappedBytes(Map map) {
+    if (map == NULL) {
+        return 0;
+    }
+    if (!allocatorIsDefault(&map->allocator)) { //only the default allocator uses page storage
+        return 0;
+    }
+    return pageStorageMappedSize(map->keys, (size_t)map->keys_capacity * sizeof(*map->keys))
+           + pageStorageMappedSize(map->values, (size_t)map->values_capacity * sizeof(*map->values))
+           + pageStorageMappedSize(map->hashes, (size_t)map->hashes_capacity * sizeof(*map->hashes))
+           + pageStorageMappedSize(map->next, (size_t)map->next_capacity * sizeof(*map->next))
+           + pageStorageMappedSize(map->referenced, (size_t)map->referenced_capacity * sizeof(*map->referenced))
+           + pageStorageMappedSize(map->sorted, (size_t)map->sorted_capacity * sizeof(*map->sorted))
+           + pageStorageMappedSize(map->buckets, (size_t)map->bucket_count * sizeof(*map->buckets))
+           + pageStorageMappedSize(map->trees, (size_t)map->bucket_count * sizeof(*map->trees));
+}
+
+MapHashStats mapGetHashStats(Map map) {
+    MapHashStats stats = {0, 0, 0};
+    if (map == NULL) {
+        return stats;
+    }
+    stats.buckets = map->bucket_count;
+    stats.longest_chain = map->longest_chain;
+    stats.tree_buckets = map->tree_buckets;
+    return stats;
 }
 
 MapResult mapClear(Map map){
     if(map == NULL){
         return MAP_NULL_ARGUMENT;
     }
-    while(mapGetSize(map) > 0) {
-        MapResult result = mapRemove(map, mapGetFirst(map));
-        if(result != MAP_SUCCESS ){
-            return MAP_ERROR;
-        }
+    for (int i = 0; i < map->size; i++) {
+        elementDestroy(map, i);
+    }
+    destroyTrees(map);
+    for (int bucket = 0; bucket < map->bucket_count; bucket++) {
+        map->buckets[bucket] = ELEMENT_NOT_FOUND;
+    }
+    map->size = 0;
+    map->clock_hand = 0;
+    map->sorted_valid = false;
+    map->longest_chain = 0;
+    return MAP_SUCCESS;
+}
+
+MapResult mapSetCapacity(Map map, int capacity, MapEvictionFunction on_evict, void* context) {
+    if (map == NULL) {
+        return MAP_NULL_ARGUMENT;
+    }
+    if (capacity < 0) {
+        return MAP_ERROR;
+    }
+    map->capacity = capacity;
+    map->on_evict = on_evict;
+    map->evict_context = context;
+    while (capacity > 0 && map->size > capacity) {
+        evictOne(map);
+    }
+    return MAP_SUCCESS;
+}
+
+int mapGetCapacity(Map map) {
+    if (map == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    return map->capacity;
+}
+
+//adds a block of the map's structure, of which used bytes are in use, to a memory usage
+static void addStructureBlock(Map map, MapMemoryUsage* usage, const void* block, size_t size, size_t used) {
+    if (block == NULL) {
+        return;
+    }
+    usage->structure_bytes += size;
+    usage->slack_bytes += size - used;
+    usage->overhead_bytes += allocatorEstimateOverhead(&map->allocator, block, size);
+}
+
+/*
+ * macro ADD_ELEMENT_ARRAY:
+ * adds one of the element arrays of the map (at its capacity) to a memory usage.
+ *
+ */
+#define ADD_ELEMENT_ARRAY(map, usage, array) \
+    addStructureBlock(map, usage, (map)->array, (size_t)(map)->array##_capacity * sizeof(*(map)->array), \
+                      (size_t)(map)->size * sizeof(*(map)->array))
+    // ADD_ELEMENT_ARRAY ends here
+
+MapMemoryUsage mapMemoryUsage(Map map) {
+    MapMemoryUsage usage = {0, 0, 0, 0, 0};
+    if (map == NULL) {
+        return usage;
+    }
+    for (int i = 0; i < map->size; i++) {
+        size_t key_size = strlen(map->keys[i]) + 1, data_size = strlen(map->values[i]) + 1;
+        usage.payload_bytes += key_size + data_size;
+        usage.overhead_bytes += allocatorEstimateOverhead(&map->allocator, map->keys[i], key_size)
+                                + allocatorEstimateOverhead(&map->allocator, map->values[i], data_size);
+    }
+    addStructureBlock(map, &usage, map, sizeof(*map), sizeof(*map));
+    ADD_ELEMENT_ARRAY(map, &usage, keys);
+    ADD_ELEMENT_ARRAY(map, &usage, values);
+    ADD_ELEMENT_ARRAY(map, &usage, hashes);
+    ADD_ELEMENT_ARRAY(map, &usage, next);
+    ADD_ELEMENT_ARRAY(map, &usage, referenced);
+    ADD_ELEMENT_ARRAY(map, &usage, sorted);
+    size_t buckets_size = (size_t)map->bucket_count * sizeof(*map->buckets);
+    addStructureBlock(map, &usage, map->buckets, buckets_size, buckets_size);
+    size_t trees_size = (size_t)map->bucket_count * sizeof(*map->trees);
+    addStructureBlock(map, &usage, map->trees, trees_size, trees_size);
+    for (int bucket = 0; map->trees != NULL && bucket < map->bucket_count; bucket++) {
+        int nodes = bucketTreeGetSize(map->trees[bucket]);
+        usage.structure_bytes += (size_t)nodes * bucketTreeGetNodeSize();
+        usage.overhead_bytes += (size_t)nodes * allocatorEstimateOverhead(&map->allocator, NULL,
+                                                                           bucketTreeGetNodeSize());
     }
-    return MAP_SUCCESS;   
+    usage.total_bytes = usage.payload_bytes + usage.structure_bytes + usage.overhead_bytes;
+    return usage;
 }
@@ -1,6 +1,7 @@
 #ifndef MAP_H_
 #define MAP_H_
 
+#include "allocator.h"
 #include <stdbool.h>
 #include <string.h>
 /**
@@ -14,6 +15,7 @@
 *
 * The following functions are available:
 *   mapCreate		- Creates a new empty map
+*   mapCreateWithAllocator - Creates a new empty map taking its memory from an allocator
 *   mapDestroy		- Deletes an existing map and frees all resources
 *   mapCopy		- Copies an existing map
 *   mapGetSize		- Returns the size of a given map
@@ -22,20 +24,73 @@
 *   				  If the key exists, the value is overridden.
 *   mapGet  	    - Returns the data paired to a key which matches the given key.
 *					  Iterator status unchanged
+*   mapGetOrInsert	- Returns the data of a key, adding it with a default first
+*					  if it is missing. One lookup.
+*   mapUpdate		- Replaces the data of a key with the result of a function
+*					  of its current data. One lookup.
 *   mapRemove		- Removes a pair of (key,data) elements for which the key
 *                    matches a given element (using the strcmp function).
 *   mapGetFirst	- Sets the internal iterator to the first key in the
 *   				  map, and returns it.
 *   mapGetNext		- Advances the internal iterator to the next key and
 *   				  returns it.
+*   mapForEach		- Calls a function on every key and its data.
+*   mapGetEntries	- Exposes the keys and the data as read-only arrays.
+*   mapGetSortedKeys - Exposes the keys in ascending order (numeric order for ids).
 *	 mapClear		- Clears the contents of the map. Frees all the elements of
 *	 				  the map using the free function.
+*   mapGetMappedBytes - Returns the bytes of huge-page mappings backing the map.
+*   mapGetHashStats - Returns the state of the map's hash index.
+*   mapSetCapacity	- Bounds the number of elements, evicting with CLOCK.
+*   mapGetCapacity	- Returns the bound on the number of elements.
+*   mapMemoryUsage	- Returns a breakdown of the memory the map holds.
 * 	 MAP_FOREACH	- A macro for iterating over the map's elements.
+*
+* Keys are found through a hash index. The hash is seeded with a random seed of
+* the process, and a bucket whose collision chain grows too long falls back to
+* a balanced tree, so lookups stay O(log n) even for adversarial keys.
+*
+* A map can be bounded (see mapSetCapacity) to serve as a cache: adding a key
+* to a full map first evicts an element that wasn't looked up recently. Every
+* lookup only sets a bit on the element it finds (with an atomic store), so
+* lookups of a bounded map still need no lock between them.
 */
 
 /** Type for defining the map */
 typedef struct Map_t* Map;
 
+/** Type of a function called by mapForEach for each element of a map */
+typedef void (*MapForEachFunction)(const char* key, const char* data, void* context);
+
+/** The state of the hash index of a map, see mapGetHashStats */
+typedef struct MapHashStats_t {
+    int buckets;        // the number of buckets of the index
+    int longest_chain;  // the longest collision chain seen since the index was last rebuilt
+    int tree_buckets;   // the number of buckets that fell back to a balanced tree
+} MapHashStats;
+
+/**
+* Type of a function called by mapUpdate. Gets the key and its current data
+* (NULL if the key is not in the map) and returns the data to store, which is
+* copied. Returning NULL leaves the map as it was.
+*/
+typedef const char* (*MapUpdateFunction)(const char* key, const char* data, void* context);
+
+/** A breakdown of the memory held by a map, see mapMemoryUsage */
+typedef struct MapMemoryUsage_t {
+    size_t payload_bytes;    // the keys and the data (with their terminating nulls)
+    size_t structure_bytes;  // the map itself, its element arrays and its index, at their capacity
+    size_t slack_bytes;      // the part of structure_bytes reserved for elements the map doesn't hold
+    size_t overhead_bytes;   // an estimate of what the allocator spends beyond the requested sizes
+    size_t total_bytes;      // payload + structure + overhead
+} MapMemoryUsage;
+
+/**
+* Type of a function called by a bounded map on every element it evicts,
+* right before the element is removed. It must not change the map.
+*/
+typedef void (*MapEvictionFunction)(const char* key, const char* data, void* context);
+
 /** Type used for returning error codes from map functions */
 typedef enum MapResult_t {
     MAP_SUCCESS,
@@ -55,6 +110,19 @@ typedef enum MapResult_t {
 */
 Map mapCreate();
 
+/**
+* mapCreateWithAllocator: Allocates a new empty map. The map, its elements and
+* every copy of the keys and the data are taken from the given allocator.
+* Copies of the map (mapCopy) use the same allocator.
+*
+* @param allocator - The allocator to use. It is copied, but its context must
+* 		stay valid for as long as the map exists.
+* @return
+* 	NULL - if the allocator is NULL or missing a function, or allocations failed.
+* 	A new Map in case of success.
+*/
+Map mapCreateWithAllocator(const Allocator* allocator);
+
 /**
 * mapDestroy: Deallocates an existing map. Clears all elements.
 *
@@ -126,6 +194,42 @@ we want to get.
 */
 char* mapGet(Map map, const char* key);
 
+/**
+*	mapGetOrInsert: Returns the data associated with a key, first adding the key
+*	with a copy of default_data if it is not in the map. The key is looked up once.
+*	The returned data is not a copy and stays valid until the next change of the
+*	map. It must not be changed in place: the map frees it by its length, so
+*	change it with mapPut or mapUpdate.
+*  Iterator's value is undefined after this operation.
+*
+* @param map - The map to search (and add to).
+* @param key - The key element to look for.
+* @param default_data - The data to add if the key is missing.
+* @param inserted - If not NULL, set to true if the key was added, false if it existed.
+* @return
+*  NULL if a NULL pointer was sent (other than inserted) or an allocation failed.
+*  The data associated with the key otherwise.
+*/
+const char* mapGetOrInsert(Map map, const char* key, const char* default_data, bool* inserted);
+
+/**
+*	mapUpdate: Calls a function on the current data of a key (NULL if the key is
+*	missing) and stores a copy of what it returns, adding the key if needed.
+*	If the function returns NULL the map is left as it was. The key is looked
+*	up once, for a read-modify-write of the data.
+*  Iterator's value is undefined after this operation.
+*
+* @param map - The map to update.
+* @param key - The key element to update.
+* @param function - Computes the new data from the current one.
+* @param context - Passed as is to the function.
+* @return
+* 	MAP_NULL_ARGUMENT if a NULL was sent as map, key or function
+* 	MAP_OUT_OF_MEMORY if an allocation failed (the map is left as it was)
+* 	MAP_SUCCESS otherwise
+*/
+MapResult mapUpdate(Map map, const char* key, MapUpdateFunction function, void* context);
+
 /**
 * 	mapRemove: Removes a pair of key and data elements from the map. The elements
 *  are found using the comparison function strcmp. Once found,
@@ -171,6 +275,54 @@ char* mapGetFirst(Map map);
 char* mapGetNext(Map map);
 
 
+/**
+*	mapForEach: Calls a function on every element of the map, passing the key and
+*	its data together (no lookup is needed to get the data of a key).
+*	Iterator status unchanged. The function must not modify the map.
+*
+* @param map - The map to iterate over.
+* @param function - Called once for every element, in the iteration order.
+* @param context - Passed as is to every call of the function.
+* @return
+* 	MAP_NULL_ARGUMENT if the map or the function is NULL.
+* 	MAP_SUCCESS otherwise.
+*/
+MapResult mapForEach(Map map, MapForEachFunction function, void* context);
+
+/**
+*	mapGetEntries: Exposes the elements of the map as two contiguous read-only
+*	arrays: keys[i] is paired with data[i], for every i below the returned size.
+*	The arrays are in the iteration order, and stay valid until the map is modified
+*	(mapPut, mapRemove, mapClear or mapDestroy). Iterator status unchanged.
+*
+* @param map - The map to expose.
+* @param keys - Set to the array of the keys.
+* @param data - Set to the array of the data elements.
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	The number of elements in the arrays otherwise.
+*/
+int mapGetEntries(Map map, const char* const** keys, const char* const** data);
+
+/**
+* mapGetSortedKeys: Exposes the keys of the map in ascending order: shorter
+* keys first, and keys of the same length in strcmp order. For non-negative
+* decimal numbers without leading zeros (like the election's ids) this is
+* numeric order.
+* The order is built with a radix sort on the first call and kept by the map:
+* until the next change of the map the same array is returned in O(1), and a
+* few changes between calls are patched into it instead of sorting again.
+* The array is read-only and valid until the next change of the map.
+* Iterator status unchanged.
+*
+* @param map - The map to expose.
+* @param keys - Set to the sorted array of the keys.
+* @return
+* 	-1 if a NULL pointer was sent or an allocation failed.
+* 	The number of keys in the array otherwise.
+*/
+int mapGetSortedKeys(Map map, const char* const** keys);
+
 /**
 * mapClear: Removes all key and data elements from target map.
 * The elements are deallocated.
@@ -182,6 +334,73 @@ char* mapGetNext(Map map);
 */
 MapResult mapClear(Map map);
 
+/**
+* mapGetMappedBytes: Returns the number of bytes of anonymous (huge-page)
+* mappings that back the map's arrays (the elements, the hash index and the
+* sorted view). Large maps keep these arrays in such mappings and grow them
+* with mremap instead of copying; small maps keep them on the heap, and so do
+* maps with a custom allocator.
+* @param map - The map to check.
+* @return
+* 	0 if a NULL pointer was sent or the element storage is on the heap.
+* 	The mapped size (a multiple of the huge page size) otherwise.
+*/
+size_t mapGetMappedBytes(Map map);
+
+/**
+* mapGetHashStats: Returns the state of the hash index of the map, for
+* monitoring collisions. A long chain or any tree bucket means the keys
+* collide more than random keys would.
+* @param map - The map to check.
+* @return
+* 	All zeros if a NULL pointer was sent.
+* 	The statistics of the index otherwise.
+*/
+MapHashStats mapGetHashStats(Map map);
+
+/**
+* mapSetCapacity: Bounds the number of elements of the map. Once the map is
+* full, every new key evicts an element chosen by the CLOCK policy: elements
+* looked up (or added) since the last sweep of the clock hand are passed over
+* once, so recently used keys stay and the cost per eviction is O(1) amortized.
+* If the map holds more elements than the new capacity, the excess is
+* evicted right away. Copies of the map (mapCopy) keep the bound.
+*  Iterator's value is undefined after this operation.
+*
+* @param map - The map to bound.
+* @param capacity - The most elements the map may hold, 0 removes the bound.
+* @param on_evict - Called on every evicted element, may be NULL.
+* @param context - Passed as is to on_evict.
+* @return
+* 	MAP_NULL_ARGUMENT if a NULL was sent as map
+* 	MAP_ERROR if the capacity is negative
+* 	MAP_SUCCESS otherwise
+*/
+MapResult mapSetCapacity(Map map, int capacity, MapEvictionFunction on_evict, void* context);
+
+/**
+* mapGetCapacity: Returns the bound set by mapSetCapacity.
+* @param map - The map to check.
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	0 if the map is not bounded, the most elements it may hold otherwise.
+*/
+int mapGetCapacity(Map map);
+
+/**
+* mapMemoryUsage: Returns a breakdown of the memory held by the map: the bytes
+* of the keys and the data, the bytes of the structure (and how much of it is
+* capacity not in use), and an estimate of the allocator's overhead (see
+* allocatorEstimateOverhead). Goes over all the elements, O(n).
+* Iterator status unchanged.
+*
+* @param map - The map to measure.
+* @return
+* 	All zeros if a NULL pointer was sent.
+* 	The breakdown otherwise.
+*/
+MapMemoryUsage mapMemoryUsage(Map map);
+
 /*!
 * Macro for iterating over a map.
 * Declares a new iterator for the loop.
@@ -3,10 +3,15 @@
 //
 
 #include "map.h"
+#include "slab.h"
+#include "hash.h"
+#include "pageStorage.h"
 #include "test_utilities.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
 
-#define NUMBER_TESTS 4
+#define NUMBER_TESTS 15
 
 bool testMapCreateDestroy() {
     Map map = mapCreate();
@@ -55,20 +60,392 @@ bool testIterator() {
     return true;
 }
 
+bool testMapMappedBytes() {
+    ASSERT_TEST(mapGetMappedBytes(NULL) == 0);
+    Map map = mapCreate();
+    ASSERT_TEST(mapPut(map, "key", "value") == MAP_SUCCESS);
+    ASSERT_TEST(mapGetMappedBytes(map) == 0); //small maps stay on the heap
+    char key[16];
+    size_t mapped = 0;
+    for (int i = 0; i < 600000; i++) { //the key, value and bucket arrays grow past a huge page
+        sprintf(key, "%d", i);
+        ASSERT_TEST(mapPut(map, key, "v") == MAP_SUCCESS);
+        if (i == 300000) {
+            mapped = mapGetMappedBytes(map);
+            ASSERT_TEST(mapped >= 3 * PAGE_STORAGE_THRESHOLD && mapped % PAGE_STORAGE_THRESHOLD == 0);
+        }
+    }
+    ASSERT_TEST(mapGetMappedBytes(map) > mapped); //grown in place with mremap
+    mapped = mapGetMappedBytes(map);
+    const char* const* keys;
+    ASSERT_TEST(mapGetSortedKeys(map, &keys) == mapGetSize(map));
+    ASSERT_TEST(mapGetMappedBytes(map) >= mapped + PAGE_STORAGE_THRESHOLD); //the sorted view is counted too
+    mapDestroy(map);
+    return true;
+}
+
+bool testPageStorageResize() {
+    ASSERT_TEST(pageStorageMappedSize(NULL, PAGE_STORAGE_THRESHOLD) == 0);
+    char* block = pageStorageResize(NULL, 0, 1000);
+    ASSERT_TEST(block != NULL && pageStorageMappedSize(block, 1000) == 0); //small blocks are on the heap
+    memset(block, 'a', 1000);
+    size_t large = PAGE_STORAGE_THRESHOLD + 1, larger = 3 * PAGE_STORAGE_THRESHOLD;
+    block = pageStorageResize(block, 1000, large); //moves into a mapping
+    ASSERT_TEST(block != NULL && pageStorageMappedSize(block, large) == 2 * PAGE_STORAGE_THRESHOLD);
+    ASSERT_TEST((uintptr_t)block % PAGE_STORAGE_THRESHOLD == 0); //starts on a huge page
+    ASSERT_TEST(block[0] == 'a' && block[999] == 'a');
+    memset(block, 'b', large);
+    block = pageStorageResize(block, large, larger); //remapped, not copied
+    ASSERT_TEST(block != NULL && pageStorageMappedSize(block, larger) == larger);
+    ASSERT_TEST((uintptr_t)block % PAGE_STORAGE_THRESHOLD == 0);
+    ASSERT_TEST(block[0] == 'b' && block[large - 1] == 'b');
+    block = pageStorageResize(block, larger, 1000); //back to the heap
+    ASSERT_TEST(block != NULL && pageStorageMappedSize(block, 1000) == 0 && block[999] == 'b');
+    pageStorageFree(block, 1000);
+    return true;
+}
+
+bool testMapNodesUseSlabs() {
+    slabTrim();
+    SlabStats before = slabGetStats();
+    Map map = mapCreate();
+    ASSERT_TEST(mapPut(map, "1", "one") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "2", "two") == MAP_SUCCESS);
+    SlabStats during = slabGetStats();
+    ASSERT_TEST(during.used_bytes > before.used_bytes);
+    ASSERT_TEST(during.reserved_bytes >= during.used_bytes + during.cached_bytes);
+    ASSERT_TEST(during.fragmentation >= 0 && during.fragmentation <= 1);
+    mapDestroy(map);
+    slabTrim();
+    SlabStats after = slabGetStats();
+    ASSERT_TEST(after.used_bytes == before.used_bytes);
+    ASSERT_TEST(after.cached_bytes == 0);
+    return true;
+}
+
+static int live_blocks = 0;
+
+static void* countingAllocate(void* context, size_t size) {
+    (void)context;
+    live_blocks++;
+    return malloc(size);
+}
+
+static void* countingReallocate(void* context, void* block, size_t old_size, size_t new_size) {
+    (void)context;
+    (void)old_size;
+    if (block == NULL) {
+        live_blocks++;
+    }
+    return realloc(block, new_size);
+}
+
+static void countingDeallocate(void* context, void* block, size_t size) {
+    (void)context;
+    (void)size;
+    live_blocks--;
+    free(block);
+}
+
+//fails once the allocations left, in the context, run out
+static void* failingAllocate(void* allocations_left, size_t size) {
+    if (*(int*)allocations_left == 0) {
+        return NULL;
+    }
+    (*(int*)allocations_left)--;
+    return countingAllocate(NULL, size);
+}
+
+bool testMapCreateWithAllocator() {
+    Allocator allocator = {countingAllocate, countingReallocate, countingDeallocate, NULL};
+    Allocator missing_function = {countingAllocate, NULL, countingDeallocate, NULL};
+    ASSERT_TEST(mapCreateWithAllocator(NULL) == NULL);
+    ASSERT_TEST(mapCreateWithAllocator(&missing_function) == NULL);
+    Map map = mapCreateWithAllocator(&allocator);
+    ASSERT_TEST(map != NULL);
+    char key[16];
+    for (int i = 0; i < 100; i++) {
+        sprintf(key, "%d", i);
+        ASSERT_TEST(mapPut(map, key, "value") == MAP_SUCCESS);
+    }
+    ASSERT_TEST(mapPut(map, "7", "another value") == MAP_SUCCESS);
+    Map copy = mapCopy(map);
+    ASSERT_TEST(copy != NULL);
+    ASSERT_TEST(strcmp(mapGet(copy, "7"), "another value") == 0);
+    ASSERT_TEST(live_blocks > 0);
+    ASSERT_TEST(mapGetMappedBytes(map) == 0); //only the default allocator maps pages
+    mapDestroy(map);
+    mapDestroy(copy);
+    ASSERT_TEST(live_blocks == 0);
+    return true;
+}
+
+static void sumValues(const char* key, const char* data, void* context) {
+    (void)key;
+    *(int*)context += atoi(data);
+}
+
+bool testMapForEachAndEntries() {
+    Map map = mapCreate();
+    ASSERT_TEST(mapPut(map, "a", "1") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "b", "20") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "c", "300") == MAP_SUCCESS);
+    ASSERT_TEST(mapRemove(map, "a") == MAP_SUCCESS);
+    int sum = 0;
+    ASSERT_TEST(mapForEach(NULL, sumValues, &sum) == MAP_NULL_ARGUMENT);
+    ASSERT_TEST(mapForEach(map, sumValues, &sum) == MAP_SUCCESS);
+    ASSERT_TEST(sum == 320);
+
+    const char* const* keys;
+    const char* const* data;
+    ASSERT_TEST(mapGetEntries(NULL, &keys, &data) == -1);
+    ASSERT_TEST(mapGetEntries(map, &keys, &data) == 2);
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TEST(strcmp(mapGet(map, keys[i]), data[i]) == 0);
+    }
+    mapDestroy(map);
+    return true;
+}
+
+#define HASHED_KEYS 100
+
+bool testHashKeyUsesSeed() {
+    int same_hashes = 0, other_seed_hashes = 0;
+    for (int i = 0; i < HASHED_KEYS; i++) { //hashKey needs no earlier call to hashGetSeed
+        char key[16];
+        sprintf(key, "%d", i);
+        uint32_t hash = hashKey(key, strlen(key), 1);
+        same_hashes += hashKey(key, strlen(key), 1) == hash;
+        other_seed_hashes += hashKey(key, strlen(key), 2) == hash;
+    }
+    ASSERT_TEST(same_hashes == HASHED_KEYS);
+    ASSERT_TEST(other_seed_hashes <= 1); //short keys too, whichever path this cpu takes
+    return true;
+}
+
+#define COLLIDING_KEYS 40
+/* the keys share the lowest 12 bits of their hash, so they share a bucket while the map is small */
+#define COLLISION_MASK 0xfff
+
+//fills keys with numbers whose hashes share the bits of COLLISION_MASK
+static void findCollidingKeys(char keys[][16], int count) {
+    int found = 0;
+    uint64_t seed = hashGetSeed();
+    for (int candidate = 0; found < count; candidate++) {
+        sprintf(keys[found], "%d", candidate);
+        if ((hashKey(keys[found], strlen(keys[found]), seed) & COLLISION_MASK) == 0) {
+            found++;
+        }
+    }
+}
 
+bool testMapCollidingKeysUseTree() {
+    char keys[COLLIDING_KEYS][16];
+    findCollidingKeys(keys, COLLIDING_KEYS);
+    Map map = mapCreate();
+    for (int i = 0; i < COLLIDING_KEYS; i++) {
+        ASSERT_TEST(mapPut(map, keys[i], keys[i]) == MAP_SUCCESS);
+    }
+    MapHashStats stats = mapGetHashStats(map);
+    ASSERT_TEST(stats.tree_buckets == 1);
+    ASSERT_TEST(stats.longest_chain > 8);
+    for (int i = 0; i < COLLIDING_KEYS; i++) {
+        ASSERT_TEST(strcmp(mapGet(map, keys[i]), keys[i]) == 0);
+    }
+    ASSERT_TEST(mapGet(map, "not a key") == NULL);
+    for (int i = 0; i < COLLIDING_KEYS - 3; i++) {
+        ASSERT_TEST(mapRemove(map, keys[i]) == MAP_SUCCESS);
+    }
+    ASSERT_TEST(mapGetHashStats(map).tree_buckets == 0);
+    ASSERT_TEST(mapGetSize(map) == 3);
+    for (int i = COLLIDING_KEYS - 3; i < COLLIDING_KEYS; i++) {
+        ASSERT_TEST(strcmp(mapGet(map, keys[i]), keys[i]) == 0);
+    }
+    mapDestroy(map);
+    return true;
+}
+
+//appends "+" to the data, or starts it at "+" when the key is missing
+static const char* appendPlus(const char* key, const char* data, void* context) {
+    char* buffer = context;
+    if (data == NULL) {
+        return "+";
+    }
+    sprintf(buffer, "%s+", data);
+    return buffer;
+}
+
+static const char* keepData(const char* key, const char* data, void* context) {
+    return NULL;
+}
+
+bool testMapGetOrInsertAndUpdate() {
+    Map map = mapCreate();
+    bool inserted = false;
+    const char* data = mapGetOrInsert(map, "key", "abc", &inserted);
+    ASSERT_TEST(data != NULL && inserted && strcmp(data, "abc") == 0);
+    ASSERT_TEST(mapPut(map, "key", "xbc") == MAP_SUCCESS); //the data changes through the map
+    data = mapGetOrInsert(map, "key", "other", &inserted);
+    ASSERT_TEST(!inserted && strcmp(data, "xbc") == 0);
+    ASSERT_TEST(strcmp(mapGet(map, "key"), "xbc") == 0);
+    ASSERT_TEST(mapGetOrInsert(NULL, "key", "abc", &inserted) == NULL);
+
+    char buffer[8];
+    ASSERT_TEST(mapUpdate(map, "counter", appendPlus, buffer) == MAP_SUCCESS);
+    ASSERT_TEST(mapUpdate(map, "counter", appendPlus, buffer) == MAP_SUCCESS);
+    ASSERT_TEST(strcmp(mapGet(map, "counter"), "++") == 0);
+    ASSERT_TEST(mapUpdate(map, "missing", keepData, NULL) == MAP_SUCCESS);
+    ASSERT_TEST(!mapContains(map, "missing"));
+    ASSERT_TEST(mapUpdate(map, "key", NULL, NULL) == MAP_NULL_ARGUMENT);
+    ASSERT_TEST(mapGetSize(map) == 2);
+    mapDestroy(map);
+    return true;
+}
+
+static void countEviction(const char* key, const char* data, void* context) {
+    (*(int*)context)++;
+}
+
+bool testMapBoundedCapacity() {
+    Map map = mapCreate();
+    int evictions = 0;
+    ASSERT_TEST(mapSetCapacity(map, -1, NULL, NULL) == MAP_ERROR);
+    ASSERT_TEST(mapSetCapacity(map, 3, countEviction, &evictions) == MAP_SUCCESS);
+    ASSERT_TEST(mapGetCapacity(map) == 3);
+    ASSERT_TEST(mapPut(map, "a", "1") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "b", "2") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "c", "3") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "d", "4") == MAP_SUCCESS); //the hand clears every bit, then evicts "a"
+    ASSERT_TEST(evictions == 1 && mapGetSize(map) == 3);
+    ASSERT_TEST(!mapContains(map, "a"));
+    ASSERT_TEST(mapGet(map, "c") != NULL); //"c" is used again, so "b" goes before it
+    ASSERT_TEST(mapPut(map, "e", "5") == MAP_SUCCESS);
+    ASSERT_TEST(!mapContains(map, "b"));
+    ASSERT_TEST(mapContains(map, "c") && mapContains(map, "d") && mapContains(map, "e"));
+    ASSERT_TEST(mapSetCapacity(map, 1, countEviction, &evictions) == MAP_SUCCESS);
+    ASSERT_TEST(mapGetSize(map) == 1 && evictions == 4);
+    ASSERT_TEST(mapSetCapacity(map, 0, NULL, NULL) == MAP_SUCCESS);
+    for (int i = 0; i < 20; i++) {
+        char key[4];
+        sprintf(key, "%d", i);
+        ASSERT_TEST(mapPut(map, key, key) == MAP_SUCCESS);
+    }
+    ASSERT_TEST(mapGetSize(map) == 21 && evictions == 4);
+    mapDestroy(map);
+
+    int allocations_left = 1000;
+    Allocator failing = {failingAllocate, countingReallocate, countingDeallocate, &allocations_left};
+    map = mapCreateWithAllocator(&failing);
+    ASSERT_TEST(mapSetCapacity(map, 2, countEviction, &evictions) == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "a", "1") == MAP_SUCCESS && mapPut(map, "b", "2") == MAP_SUCCESS);
+    for (int copies = 0; copies < 2; copies++) { //the data or the key can't be copied
+        allocations_left = copies;
+        ASSERT_TEST(mapPut(map, "c", "3") == MAP_OUT_OF_MEMORY);
+        ASSERT_TEST(evictions == 4 && mapContains(map, "a") && mapContains(map, "b")); //nothing was lost
+    }
+    allocations_left = 1000;
+    ASSERT_TEST(mapPut(map, "c", "3") == MAP_SUCCESS && evictions == 5);
+    mapDestroy(map);
+
+    char keys[COLLIDING_KEYS / 2 + 1][16]; //all in one bucket, which becomes a tree
+    findCollidingKeys(keys, COLLIDING_KEYS / 2 + 1);
+    map = mapCreateWithAllocator(&failing);
+    ASSERT_TEST(mapSetCapacity(map, COLLIDING_KEYS / 2, countEviction, &evictions) == MAP_SUCCESS);
+    for (int i = 0; i < COLLIDING_KEYS / 2; i++) {
+        ASSERT_TEST(mapPut(map, keys[i], keys[i]) == MAP_SUCCESS);
+    }
+    ASSERT_TEST(mapGetHashStats(map).tree_buckets == 1 && evictions == 5);
+    allocations_left = 2; //the copies are made, but not the node of the tree
+    ASSERT_TEST(mapPut(map, keys[COLLIDING_KEYS / 2], "x") == MAP_OUT_OF_MEMORY);
+    ASSERT_TEST(evictions == 5 && mapGetSize(map) == COLLIDING_KEYS / 2); //nothing was lost
+    for (int i = 0; i < COLLIDING_KEYS / 2; i++) {
+        ASSERT_TEST(mapContains(map, keys[i]));
+    }
+    allocations_left = 1000;
+    ASSERT_TEST(mapPut(map, keys[COLLIDING_KEYS / 2], "x") == MAP_SUCCESS && evictions == 6);
+    mapDestroy(map);
+    return true;
+}
+
+static bool isSortedNumerically(const char* const* keys, int count) {
+    for (int i = 1; i < count; i++) {
+        if (atoi(keys[i - 1]) >= atoi(keys[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testMapSortedKeys() {
+    Map map = mapCreate();
+    const char* const* keys;
+    ASSERT_TEST(mapGetSortedKeys(NULL, &keys) == -1);
+    ASSERT_TEST(mapGetSortedKeys(map, &keys) == 0);
+    for (int i = 0; i < 500; i++) { //a bulk load, sorted on the next read
+        char key[8];
+        sprintf(key, "%d", (i * 7919) % 1000);
+        ASSERT_TEST(mapPut(map, key, key) == MAP_SUCCESS);
+    }
+    ASSERT_TEST(mapGetSortedKeys(map, &keys) == 500);
+    ASSERT_TEST(isSortedNumerically(keys, 500));
+    ASSERT_TEST(mapPut(map, "5000", "x") == MAP_SUCCESS); //a few changes, patched in
+    ASSERT_TEST(mapPut(map, "1", "x") == MAP_SUCCESS);
+    ASSERT_TEST(mapRemove(map, "0") == MAP_SUCCESS);
+    ASSERT_TEST(mapGetSortedKeys(map, &keys) == 501);
+    ASSERT_TEST(isSortedNumerically(keys, 501));
+    ASSERT_TEST(strcmp(keys[500], "5000") == 0);
+    mapDestroy(map);
+    return true;
+}
+
+bool testMapMemoryUsage() {
+    MapMemoryUsage usage = mapMemoryUsage(NULL);
+    ASSERT_TEST(usage.total_bytes == 0);
+    Map map = mapCreate();
+    ASSERT_TEST(mapPut(map, "key", "value") == MAP_SUCCESS);
+    ASSERT_TEST(mapPut(map, "other key", "v") == MAP_SUCCESS);
+    usage = mapMemoryUsage(map);
+    ASSERT_TEST(usage.payload_bytes == strlen("keyvalueother keyv") + 4);
+    ASSERT_TEST(usage.slack_bytes > 0 && usage.slack_bytes < usage.structure_bytes);
+    ASSERT_TEST(usage.total_bytes == usage.payload_bytes + usage.structure_bytes + usage.overhead_bytes);
+    mapDestroy(map);
+    return true;
+}
 
 bool (*tests[]) (void) = {
                       testMapCreateDestroy,
                       testMapAddAndSize,
                       testMapGet,
-                      testIterator
+                      testIterator,
+                      testMapMappedBytes,
+                      testPageStorageResize,
+                      testMapNodesUseSlabs,
+                      testMapCreateWithAllocator,
+                      testMapForEachAndEntries,
+                      testHashKeyUsesSeed,
+                      testMapCollidingKeysUseTree,
+                      testMapGetOrInsertAndUpdate,
+                      testMapBoundedCapacity,
+                      testMapSortedKeys,
+                      testMapMemoryUsage
 };
 
 const char* testNames[] = {
                            "testMapCreateDestroy",
                            "testMapAddAndSize",
                            "testMapGet",
-                           "testIterator"
+                           "testIterator",
+                           "testMapMappedBytes",
+                           "testPageStorageResize",
+                           "testMapNodesUseSlabs",
+                           "testMapCreateWithAllocator",
+                           "testMapForEachAndEntries",
+                           "testHashKeyUsesSeed",
+                           "testMapCollidingKeysUseTree",
+                           "testMapGetOrInsertAndUpdate",
+                           "testMapBoundedCapacity",
+                           "testMapSortedKeys",
+                           "testMapMemoryUsage"
 };
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,199 @@
+#define _GNU_SOURCE //needed for mremap
+#include "pageStorage.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+/** The size of a huge page, mappings are rounded up to it */
+#define HUGE_PAGE_SIZE PAGE_STORAGE_THRESHOLD
+/** Mappings always start on a page boundary, heap fallback blocks never do */
+#define PAGE_ALIGNMENT 4096
+/** Alignment of heap fallback blocks (a cache line) */
+#define BLOCK_ALIGNMENT 64
+/** Extra bytes a heap fallback block needs for its alignment and its base pointer */
+#define HEAP_BLOCK_SLACK (2 * BLOCK_ALIGNMENT)
+
+static inline bool isLarge(size_t size) {
+    return size >= PAGE_STORAGE_THRESHOLD;
+}
+
+static inline size_t minSize(size_t first, size_t second) {
+    return first < second ? first : second;
+}
+
+//a large block is mapped if and only if it starts on a page boundary
+static inline bool isMapped(void* block) {
+    return (uintptr_t)block % PAGE_ALIGNMENT == 0;
+}
+
+//rounds the size of a block up to whole huge pages
+static size_t mappingSize(size_t size) {
+    return ((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+}
+
+#ifdef __linux__
+static void adviseHugePages(void* address, size_t length) {
+#ifdef MADV_HUGEPAGE
+    madvise(address, length, MADV_HUGEPAGE); //only a hint, failure is harmless
+#else
+    (void)address;
+    (void)length;
+#endif
+}
+#endif
+
+#ifdef __linux__
+//maps mapped_size bytes (whole huge pages) starting on a huge page, so every page of it can be a
+//huge page: a huge page more is mapped, and the parts before and after the aligned range are unmapped
+static void* mapAligned(size_t mapped_size) {
+    char* address = mmap(NULL, mapped_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+    if (address == MAP_FAILED) {
+        return NULL;
+    }
+    size_t head = (HUGE_PAGE_SIZE - (uintptr_t)address % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    if (head > 0) {
+        munmap(address, head);
+    }
+    munmap(address + head + mapped_size, HUGE_PAGE_SIZE - head);
+    return address + head;
+}
+#endif
+
+//creates a new mapping for a block of the given size, NULL if mapping is not possible
+static void* mapBlock(size_t size) {
+#ifdef __linux__
+    size_t mapped_size = mappingSize(size);
+    void* address = mapAligned(mapped_size);
+    if (address == NULL) {
+        return NULL;
+    }
+    assert(isMapped(address));
+    adviseHugePages(address, mapped_size);
+    return address;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+//resizes the mapping of a mapped block without copying it, NULL if it failed. the block stays on
+//a huge page: it is resized in place, or its pages are moved onto a new aligned mapping
+static void* remapBlock(void* block, size_t old_size, size_t new_size) {
+#if defined(__linux__) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+    size_t old_mapped_size = mappingSize(old_size), new_mapped_size = mappingSize(new_size);
+    if (old_mapped_size == new_mapped_size) {
+        return block;
+    }
+    void* address = mremap(block, old_mapped_size, new_mapped_size, 0); //shrinks, or grows into free pages
+    if (address == MAP_FAILED) {
+        void* target = mapAligned(new_mapped_size);
+        if (target == NULL) {
+            return NULL;
+        }
+        address = mremap(block, old_mapped_size, new_mapped_size, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+        if (address == MAP_FAILED) {
+            munmap(target, new_mapped_size);
+            return NULL;
+        }
+    }
+    adviseHugePages(address, new_mapped_size);
+    return address;
+#else
+    (void)block;
+    (void)old_size;
+    (void)new_size;
+    return NULL;
+#endif
+}
+
+//allocates a large block on the heap, aligned so that it never starts on a page boundary
+static void* allocateHeapBlock(size_t size) {
+    char* base = malloc(size + HEAP_BLOCK_SLACK);
+    if (base == NULL) {
+        return NULL;
+    }
+    char* block = base + BLOCK_ALIGNMENT - (uintptr_t)base % BLOCK_ALIGNMENT;
+    if (isMapped(block)) {
+        block += BLOCK_ALIGNMENT;
+    }
+    ((void**)block)[-1] = base; //remembers where the heap block really starts
+    return block;
+}
+
+static void releaseLarge(void* block, size_t size) {
+    if (!isMapped(block)) {
+        free(((void**)block)[-1]);
+        return;
+    }
+#ifdef __linux__
+    munmap(block, mappingSize(size));
+#endif
+}
+
+//allocates a large block, mapped if possible and on the heap otherwise
+static void* allocateLarge(size_t size) {
+    void* block = mapBlock(size);
+    if (block == NULL) {
+        block = allocateHeapBlock(size);
+    }
+    return block;
+}
+
+//resizes a large block into a large size
+static void* resizeLarge(void* block, size_t old_size, size_t new_size) {
+    if (isMapped(block)) {
+        return remapBlock(block, old_size, new_size);
+    }
+    void* new_block = allocateLarge(new_size); //a heap block gets another chance to be mapped
+    if (new_block == NULL) {
+        return NULL;
+    }
+    memcpy(new_block, block, minSize(old_size, new_size));
+    releaseLarge(block, old_size);
+    return new_block;
+}
+
+void* pageStorageResize(void* block, size_t old_size, size_t new_size) {
+    assert(new_size > 0);
+    if (block == NULL) {
+        old_size = 0;
+    }
+    if (!isLarge(old_size) && !isLarge(new_size)) {
+        return realloc(block, new_size);
+    }
+    if (isLarge(old_size) && isLarge(new_size)) {
+        return resizeLarge(block, old_size, new_size);
+    }
+    //the block moves between the heap and the large storage - copied once
+    void* new_block = isLarge(new_size) ? allocateLarge(new_size) : malloc(new_size);
+    if (new_block == NULL) {
+        return NULL;
+    }
+    if (block != NULL) {
+        memcpy(new_block, block, minSize(old_size, new_size));
+        pageStorageFree(block, old_size);
+    }
+    return new_block;
+}
+
+void pageStorageFree(void* block, size_t size) {
+    if (block == NULL) {
+        return;
+    }
+    if (!isLarge(size)) {
+        free(block);
+        return;
+    }
+    releaseLarge(block, size);
+}
+
+size_t pageStorageMappedSize(void* block, size_t size) {
+    if (block == NULL || !isLarge(size) || !isMapped(block)) {
+        return 0;
+    }
+    return mappingSize(size);
+}
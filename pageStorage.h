@@ -0,0 +1,63 @@
+#ifndef PAGE_STORAGE_H_
+#define PAGE_STORAGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+/**
+* Page storage
+*
+* Implements a storage policy for very large arrays.
+* Blocks of at least PAGE_STORAGE_THRESHOLD bytes are kept in anonymous memory
+* mappings of whole huge pages, which start on a huge page boundary (a huge
+* page more is mapped and trimmed) and are advised to use transparent huge
+* pages. They are grown with mremap, in place or onto a new aligned mapping,
+* so the kernel moves the pages instead of copying the contents.
+* Smaller blocks live on the heap. When a mapping cannot be created (or on
+* systems without mremap) large blocks silently fall back to the heap as well.
+*
+* All the functions expect the caller to pass the size the block was last
+* allocated or resized with.
+*
+* The following functions are available:
+*   pageStorageResize      - Allocates, grows or shrinks a block.
+*   pageStorageFree        - Deallocates a block.
+*   pageStorageMappedSize  - Returns the number of mapped bytes backing a block.
+*/
+
+/** Blocks of at least this size are candidates for mapped storage (2MB - a huge page) */
+#define PAGE_STORAGE_THRESHOLD ((size_t)2 * 1024 * 1024)
+
+/**
+* pageStorageResize: Resizes a block to new_size bytes, keeping the first
+* min(old_size, new_size) bytes of its contents.
+*
+* @param block - The block to resize. If NULL, a new block is allocated.
+* @param old_size - The current size of the block (0 if block is NULL).
+* @param new_size - The requested size of the block. Must be positive.
+* @return
+* 	NULL - if allocations failed, in that case the block is left untouched.
+* 	The resized block otherwise (the old pointer must not be used anymore).
+*/
+void* pageStorageResize(void* block, size_t old_size, size_t new_size);
+
+/**
+* pageStorageFree: Deallocates a block.
+*
+* @param block - The block to deallocate. If NULL nothing will be done.
+* @param size - The current size of the block.
+*/
+void pageStorageFree(void* block, size_t size);
+
+/**
+* pageStorageMappedSize: Returns the number of bytes of anonymous mapping
+* that back a block.
+*
+* @param block - The block to check.
+* @param size - The current size of the block.
+* @return
+* 	0 if the block is NULL or is kept on the heap.
+* 	The size of the mapping (rounded up to whole huge pages) otherwise.
+*/
+size_t pageStorageMappedSize(void* block, size_t size);
+
+#endif /* PAGE_STORAGE_H_ */
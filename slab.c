@@ -0,0 +1,336 @@
+#define _POSIX_C_SOURCE 200809L //needed for posix_memalign and pthread
+#include "slab.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+/** The size (and alignment) of a slab */
+#define SLAB_SIZE (64 * 1024)
+/** Size classes are multiples of this size */
+#define SIZE_CLASS_GRANULARITY 16
+#define NUMBER_OF_CLASSES (SLAB_MAX_OBJECT_SIZE / SIZE_CLASS_GRANULARITY)
+/** The number of free objects a thread can cache per size class */
+#define MAGAZINE_CAPACITY 64
+/** The number of objects moved between a magazine and the slabs at once */
+#define MAGAZINE_BATCH (MAGAZINE_CAPACITY / 2)
+
+//the header at the beginning of every slab, the objects follow it
+typedef struct Slab_t {
+    struct Slab_t* next; //links in the list of slabs (of the same class) with free objects
+    struct Slab_t* prev;
+    void* free_list; //free objects keep the pointer to the next free object in their first bytes
+    int free_count;
+    int capacity;
+    int class_index;
+} *Slab;
+
+typedef struct SlabClass_t {
+    Slab partial; //slabs with at least one free object
+    int slabs;
+    size_t total_objects;
+    size_t free_objects; //objects in the free lists of the slabs (not in magazines)
+} SlabClass;
+
+//a per-thread cache of free objects
+typedef struct Magazine_t {
+    struct Magazine_t* next; //links in the list of all magazines (for statistics)
+    struct Magazine_t* prev;
+    int counts[NUMBER_OF_CLASSES];
+    void* objects[NUMBER_OF_CLASSES][MAGAZINE_CAPACITY];
+} *Magazine;
+
+//the slabs and the list of magazines are guarded by depot_lock
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static SlabClass classes[NUMBER_OF_CLASSES];
+static Magazine magazines = NULL;
+
+static pthread_key_t magazine_key;
+static pthread_once_t magazine_key_once = PTHREAD_ONCE_INIT;
+static bool magazine_key_valid = false;
+
+static inline int classIndex(size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+    return (int)((size - 1) / SIZE_CLASS_GRANULARITY);
+}
+
+static inline size_t classSize(int class_index) {
+    return (size_t)(class_index + 1) * SIZE_CLASS_GRANULARITY;
+}
+
+static inline size_t firstObjectOffset() {
+    return ((sizeof(struct Slab_t) + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY)
+           * SIZE_CLASS_GRANULARITY;
+}
+
+//slabs are aligned to their size, so the slab of an object is found by masking its address
+static inline Slab slabOf(void* object) {
+    return (Slab)((uintptr_t)object & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+//the counts of a magazine are read by other threads for statistics
+static inline int magazineCount(Magazine magazine, int class_index) {
+    return __atomic_load_n(&magazine->counts[class_index], __ATOMIC_RELAXED);
+}
+
+static inline void magazineSetCount(Magazine magazine, int class_index, int count) {
+    __atomic_store_n(&magazine->counts[class_index], count, __ATOMIC_RELAXED);
+}
+
+static void linkPartial(SlabClass* slab_class, Slab slab) {
+    slab->prev = NULL;
+    slab->next = slab_class->partial;
+    if (slab_class->partial != NULL) {
+        slab_class->partial->prev = slab;
+    }
+    slab_class->partial = slab;
+}
+
+static void unlinkPartial(SlabClass* slab_class, Slab slab) {
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        slab_class->partial = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+//allocates a new slab for a class and threads all its objects into its free list (lock held)
+static Slab createSlab(int class_index) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, SLAB_SIZE, SLAB_SIZE) != 0) {
+        return NULL;
+    }
+    Slab slab = memory;
+    size_t object_size = classSize(class_index), offset = firstObjectOffset();
+    slab->capacity = (int)((SLAB_SIZE - offset) / object_size);
+    slab->free_count = slab->capacity;
+    slab->class_index = class_index;
+    slab->free_list = NULL;
+    for (int i = slab->capacity - 1; i >= 0; i--) { //lowest addresses are handed out first
+        void* object = (char*)memory + offset + (size_t)i * object_size;
+        *(void**)object = slab->free_list;
+        slab->free_list = object;
+    }
+    SlabClass* slab_class = &classes[class_index];
+    linkPartial(slab_class, slab);
+    slab_class->slabs++;
+    slab_class->total_objects += slab->capacity;
+    slab_class->free_objects += slab->capacity;
+    return slab;
+}
+
+//takes a free object of a class out of the slabs (lock held)
+static void* depotTake(int class_index) {
+    SlabClass* slab_class = &classes[class_index];
+    if (slab_class->partial == NULL && createSlab(class_index) == NULL) {
+        return NULL;
+    }
+    Slab slab = slab_class->partial;
+    void* object = slab->free_list;
+    slab->free_list = *(void**)object;
+    slab->free_count--;
+    slab_class->free_objects--;
+    if (slab->free_count == 0) {
+        unlinkPartial(slab_class, slab);
+    }
+    return object;
+}
+
+//returns a free object to its slab (lock held)
+static void depotPut(void* object) {
+    Slab slab = slabOf(object);
+    SlabClass* slab_class = &classes[slab->class_index];
+    *(void**)object = slab->free_list;
+    slab->free_list = object;
+    if (slab->free_count++ == 0) {
+        linkPartial(slab_class, slab);
+    }
+    slab_class->free_objects++;
+}
+
+//returns all the objects of a magazine to the slabs (lock held)
+static void flushMagazine(Magazine magazine) {
+    for (int class_index = 0; class_index < NUMBER_OF_CLASSES; class_index++) {
+        int count = magazineCount(magazine, class_index);
+        for (int i = 0; i < count; i++) {
+            depotPut(magazine->objects[class_index][i]);
+        }
+        magazineSetCount(magazine, class_index, 0);
+    }
+}
+
+//thread exit destructor of a magazine
+static void destroyMagazine(void* magazine_pointer) {
+    Magazine magazine = magazine_pointer;
+    pthread_mutex_lock(&depot_lock);
+    flushMagazine(magazine);
+    if (magazine->prev != NULL) {
+        magazine->prev->next = magazine->next;
+    } else {
+        magazines = magazine->next;
+    }
+    if (magazine->next != NULL) {
+        magazine->next->prev = magazine->prev;
+    }
+    pthread_mutex_unlock(&depot_lock);
+    free(magazine);
+}
+
+static void createMagazineKey() {
+    magazine_key_valid = pthread_key_create(&magazine_key, destroyMagazine) == 0;
+}
+
+//returns the magazine of the calling thread, creates it if needed. NULL if it can't be created
+static Magazine getMagazine(bool create) {
+    pthread_once(&magazine_key_once, createMagazineKey);
+    if (!magazine_key_valid) {
+        return NULL;
+    }
+    Magazine magazine = pthread_getspecific(magazine_key);
+    if (magazine != NULL || !create) {
+        return magazine;
+    }
+    magazine = calloc(1, sizeof(*magazine));
+    if (magazine == NULL) {
+        return NULL;
+    }
+    if (pthread_setspecific(magazine_key, magazine) != 0) {
+        free(magazine);
+        return NULL;
+    }
+    pthread_mutex_lock(&depot_lock);
+    magazine->prev = NULL;
+    magazine->next = magazines;
+    if (magazines != NULL) {
+        magazines->prev = magazine;
+    }
+    magazines = magazine;
+    pthread_mutex_unlock(&depot_lock);
+    return magazine;
+}
+
+void* slabAlloc(size_t size) {
+    if (size > SLAB_MAX_OBJECT_SIZE) {
+        return malloc(size);
+    }
+    int class_index = classIndex(size);
+    Magazine magazine = getMagazine(true);
+    if (magazine != NULL) {
+        int count = magazineCount(magazine, class_index);
+        if (count > 0) {
+            magazineSetCount(magazine, class_index, count - 1);
+            return magazine->objects[class_index][count - 1];
+        }
+    }
+    pthread_mutex_lock(&depot_lock);
+    void* object = depotTake(class_index);
+    if (object != NULL && magazine != NULL) { //refills the empty magazine in the same trip
+        int count = 0;
+        while (count < MAGAZINE_BATCH) {
+            void* extra = depotTake(class_index);
+            if (extra == NULL) {
+                break;
+            }
+            magazine->objects[class_index][count++] = extra;
+        }
+        magazineSetCount(magazine, class_index, count);
+    }
+    pthread_mutex_unlock(&depot_lock);
+    return object;
+}
+
+void slabFree(void* object, size_t size) {
+    if (object == NULL) {
+        return;
+    }
+    if (size > SLAB_MAX_OBJECT_SIZE) {
+        free(object);
+        return;
+    }
+    int class_index = classIndex(size);
+    Magazine magazine = getMagazine(true);
+    if (magazine == NULL) {
+        pthread_mutex_lock(&depot_lock);
+        depotPut(object);
+        pthread_mutex_unlock(&depot_lock);
+        return;
+    }
+    void** objects = magazine->objects[class_index];
+    int count = magazineCount(magazine, class_index);
+    if (count == MAGAZINE_CAPACITY) { //flushes the older half, keeps the recently freed (hot) objects
+        pthread_mutex_lock(&depot_lock);
+        for (int i = 0; i < MAGAZINE_BATCH; i++) {
+            depotPut(objects[i]);
+        }
+        pthread_mutex_unlock(&depot_lock);
+        memmove(objects, objects + MAGAZINE_BATCH, (MAGAZINE_CAPACITY - MAGAZINE_BATCH) * sizeof(void*));
+        count -= MAGAZINE_BATCH;
+    }
+    objects[count] = object;
+    magazineSetCount(magazine, class_index, count + 1);
+}
+
+void slabFlushThreadCache() {
+    Magazine magazine = getMagazine(false);
+    if (magazine == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&depot_lock);
+    flushMagazine(magazine);
+    pthread_mutex_unlock(&depot_lock);
+}
+
+void slabTrim() {
+    slabFlushThreadCache();
+    pthread_mutex_lock(&depot_lock);
+    for (int class_index = 0; class_index < NUMBER_OF_CLASSES; class_index++) {
+        SlabClass* slab_class = &classes[class_index];
+        Slab slab = slab_class->partial;
+        while (slab != NULL) {
+            Slab next = slab->next;
+            if (slab->free_count == slab->capacity) {
+                unlinkPartial(slab_class, slab);
+                slab_class->slabs--;
+                slab_class->total_objects -= slab->capacity;
+                slab_class->free_objects -= slab->capacity;
+                free(slab);
+            }
+            slab = next;
+        }
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+SlabStats slabGetStats() {
+    SlabStats stats = {0, 0, 0, 0, 0.0};
+    pthread_mutex_lock(&depot_lock);
+    for (int class_index = 0; class_index < NUMBER_OF_CLASSES; class_index++) {
+        SlabClass* slab_class = &classes[class_index];
+        size_t cached_objects = 0;
+        for (Magazine magazine = magazines; magazine != NULL; magazine = magazine->next) {
+            cached_objects += magazineCount(magazine, class_index);
+        }
+        size_t used_objects = slab_class->total_objects - slab_class->free_objects - cached_objects;
+        stats.slabs += slab_class->slabs;
+        stats.reserved_bytes += (size_t)slab_class->slabs * SLAB_SIZE;
+        stats.used_bytes += used_objects * classSize(class_index);
+        stats.cached_bytes += cached_objects * classSize(class_index);
+    }
+    pthread_mutex_unlock(&depot_lock);
+    if (stats.reserved_bytes > 0) {
+        stats.fragmentation = 1.0 - (double)stats.used_bytes / (double)stats.reserved_bytes;
+    }
+    return stats;
+}
+
+size_t slabGetObjectSize(size_t size) {
+    if (size > SLAB_MAX_OBJECT_SIZE) {
+        return size;
+    }
+    return classSize(classIndex(size));
+}
@@ -0,0 +1,84 @@
+#ifndef SLAB_H_
+#define SLAB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+/**
+* Slab allocator
+*
+* Implements a size-class allocator for small fixed-size objects (the nodes of
+* the map and the election containers).
+* Objects are carved out of aligned slabs, one size class per slab. Every
+* thread keeps a magazine of free objects per size class, so allocating and
+* freeing usually touches no lock; magazines are refilled from (and flushed to)
+* the shared slabs in bulk.
+* Requests larger than SLAB_MAX_OBJECT_SIZE are passed to malloc/free.
+*
+* Objects are freed with the size they were allocated with (sized free), so no
+* per-object header is needed.
+*
+* The following functions are available:
+*   slabAlloc             - Allocates an object of a given size.
+*   slabFree              - Deallocates an object of a given size.
+*   slabFlushThreadCache  - Returns the calling thread's magazines to the slabs.
+*   slabTrim              - Releases completely free slabs back to the system.
+*   slabGetStats          - Returns usage and fragmentation statistics.
+*   slabGetObjectSize     - Returns the size class a request is rounded to.
+*/
+
+/** The largest object size served from slabs */
+#define SLAB_MAX_OBJECT_SIZE 128
+
+/** Usage statistics of the slab allocator */
+typedef struct SlabStats_t {
+    int slabs;              // number of slabs currently held
+    size_t reserved_bytes;  // bytes of slabs obtained from the system
+    size_t used_bytes;      // bytes of objects currently allocated (rounded to their size class)
+    size_t cached_bytes;    // bytes of free objects waiting in thread magazines
+    double fragmentation;   // share of the reserved bytes not used by objects (0 - 1)
+} SlabStats;
+
+/**
+* slabAlloc: Allocates an object of the given size.
+*
+* @param size - The size of the object.
+* @return
+* 	NULL - if allocations failed.
+* 	A pointer to the new (uninitialized) object otherwise.
+*/
+void* slabAlloc(size_t size);
+
+/**
+* slabFree: Deallocates an object.
+*
+* @param object - The object to deallocate. If NULL nothing will be done.
+* @param size - The size the object was allocated with.
+*/
+void slabFree(void* object, size_t size);
+
+/**
+* slabFlushThreadCache: Returns all the objects cached in the calling thread's
+* magazines to their slabs. Called automatically when a thread exits.
+*/
+void slabFlushThreadCache();
+
+/**
+* slabTrim: Flushes the calling thread's magazines and releases every slab
+* whose objects are all free back to the system.
+*/
+void slabTrim();
+
+/**
+* slabGetStats: Returns the current usage statistics of the allocator.
+* Objects cached by other running threads are counted as cached, not used.
+*/
+SlabStats slabGetStats();
+
+/**
+* slabGetObjectSize: Returns the number of bytes an object of the given size
+* really takes in its slab (its size rounded up to its size class).
+* Sizes above SLAB_MAX_OBJECT_SIZE are returned as they are.
+*/
+size_t slabGetObjectSize(size_t size);
+
+#endif /* SLAB_H_ */
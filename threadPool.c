@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread
+#include "threadPool.h"
+#include <pthread.h>
+#include <assert.h>
+/** The bytes of a cache line, the queues of two workers never share one */
+#define CACHE_LINE 64
+
+//the tasks a worker has left: the range [begin, end). the owner takes from the
+//front, a thief takes the back half
+typedef struct WorkerQueue_t {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+    ThreadPool pool; //so a thread gets everything it needs from its queue
+    int worker;
+    char padding[CACHE_LINE];
+} WorkerQueue;
+
+struct ThreadPool_t {
+    Allocator allocator; //a copy of the allocator the pool is taken from
+    int worker_count;
+    pthread_t* threads; //the threads of workers 1 to worker_count - 1
+    int started_threads;
+    WorkerQueue* queues;
+    pthread_mutex_t lock; //guards the fields below
+    pthread_cond_t job_started;
+    pthread_cond_t job_finished;
+    unsigned long job; //the number of the current job, threads wait for it to change
+    int busy_threads; //the threads still running the current job
+    bool stopping;
+    ThreadPoolTaskFunction function;
+    void* context;
+};
+
+static bool takeTask(WorkerQueue* queue, int* task) {
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->begin < queue->end;
+    if (found) {
+        *task = queue->begin++;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+//moves the back half of the range of some other worker to an empty queue
+static bool stealTasks(ThreadPool pool, int worker) {
+    for (int i = 1; i < pool->worker_count; i++) {
+        WorkerQueue* victim = &pool->queues[(worker + i) % pool->worker_count];
+        pthread_mutex_lock(&victim->lock);
+        int stolen = (victim->end - victim->begin + 1) / 2;
+        int end = victim->end;
+        victim->end -= stolen;
+        pthread_mutex_unlock(&victim->lock);
+        if (stolen > 0) {
+            WorkerQueue* queue = &pool->queues[worker];
+            pthread_mutex_lock(&queue->lock);
+            queue->begin = end - stolen;
+            queue->end = end;
+            pthread_mutex_unlock(&queue->lock);
+            return true;
+        }
+    }
+    return false; //no tasks are left in any queue, the job ends once the running ones do
+}
+
+static void runTasks(ThreadPool pool, int worker) {
+    int task;
+    while (takeTask(&pool->queues[worker], &task) || (stealTasks(pool, worker)
+                                                       && takeTask(&pool->queues[worker], &task))) {
+        pool->function(task, worker, pool->context);
+    }
+}
+
+static void* workerThread(void* argument) {
+    WorkerQueue* queue = argument;
+    ThreadPool pool = queue->pool;
+    unsigned long last_job = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (pool->job == last_job && !pool->stopping) {
+            pthread_cond_wait(&pool->job_started, &pool->lock);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        last_job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        runTasks(pool, queue->worker);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy_threads == 0) {
+            pthread_cond_signal(&pool->job_finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool threadPoolCreate(int worker_count, const Allocator* allocator) {
+    if (worker_count <= 0 || !allocatorIsValid(allocator)) {
+        return NULL;
+    }
+    ThreadPool pool = allocator->allocate(allocator->context, sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->allocator = *allocator;
+    pool->worker_count = worker_count;
+    pool->threads = allocator->allocate(allocator->context, sizeof(*pool->threads) * worker_count);
+    pool->queues = allocator->allocate(allocator->context, sizeof(*pool->queues) * worker_count);
+    if (pool->threads == NULL || pool->queues == NULL) {
+        if (pool->threads != NULL) {
+            allocator->deallocate(allocator->context, pool->threads, sizeof(*pool->threads) * worker_count);
+        }
+        if (pool->queues != NULL) {
+            allocator->deallocate(allocator->context, pool->queues, sizeof(*pool->queues) * worker_count);
+        }
+        allocator->deallocate(allocator->context, pool, sizeof(*pool));
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_started, NULL);
+    pthread_cond_init(&pool->job_finished, NULL);
+    pool->job = 0;
+    pool->busy_threads = 0;
+    pool->stopping = false;
+    pool->function = NULL;
+    pool->context = NULL;
+    for (int worker = 0; worker < worker_count; worker++) {
+        WorkerQueue* queue = &pool->queues[worker];
+        pthread_mutex_init(&queue->lock, NULL);
+        queue->begin = 0;
+        queue->end = 0;
+        queue->pool = pool;
+        queue->worker = worker;
+    }
+    for (int worker = 1; worker < worker_count; worker++) {
+        if (pthread_create(&pool->threads[worker], NULL, workerThread, &pool->queues[worker]) != 0) {
+            pool->started_threads = worker - 1; //destroy stops only the threads that started
+            threadPoolDestroy(pool);
+            return NULL;
+        }
+    }
+    pool->started_threads = worker_count - 1;
+    return pool;
+}
+
+void threadPoolDestroy(ThreadPool pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->job_started);
+    pthread_mutex_unlock(&pool->lock);
+    for (int worker = 1; worker <= pool->started_threads; worker++) {
+        pthread_join(pool->threads[worker], NULL);
+    }
+    for (int worker = 0; worker < pool->worker_count; worker++) {
+        pthread_mutex_destroy(&pool->queues[worker].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->job_started);
+    pthread_cond_destroy(&pool->job_finished);
+    Allocator allocator = pool->allocator; //the pool holds the allocator, keep it until the end
+    allocator.deallocate(allocator.context, pool->threads, sizeof(*pool->threads) * pool->worker_count);
+    allocator.deallocate(allocator.context, pool->queues, sizeof(*pool->queues) * pool->worker_count);
+    allocator.deallocate(allocator.context, pool, sizeof(*pool));
+}
+
+int threadPoolGetSize(ThreadPool pool) {
+    if (pool == NULL) {
+        return -1;
+    }
+    return pool->worker_count;
+}
+
+bool threadPoolRun(ThreadPool pool, int task_count, ThreadPoolTaskFunction function, void* context) {
+    if (pool == NULL || function == NULL || task_count < 0) {
+        return false;
+    }
+    pthread_mutex_lock(&pool->lock);
+    assert(pool->busy_threads == 0); //one job at a time
+    pool->function = function;
+    pool->context = context;
+    for (int worker = 0; worker < pool->worker_count; worker++) { //the threads are waiting, no lock needed
+        pool->queues[worker].begin = (int)((long long)task_count * worker / pool->worker_count);
+        pool->queues[worker].end = (int)((long long)task_count * (worker + 1) / pool->worker_count);
+    }
+    pool->busy_threads = pool->worker_count - 1;
+    pool->job++;
+    pthread_cond_broadcast(&pool->job_started);
+    pthread_mutex_unlock(&pool->lock);
+    runTasks(pool, 0);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy_threads > 0) {
+        pthread_cond_wait(&pool->job_finished, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include "allocator.h"
+#include <stdbool.h>
+/**
+* Thread Pool
+*
+* Implements a pool of worker threads that run a job: a number of independent
+* tasks, numbered 0 to task_count - 1, passed to the same function.
+* Every worker (the thread that runs the job is worker 0) starts with an equal
+* range of the tasks and takes them from the front of its range. A worker that
+* runs out steals the back half of the range of another worker, so uneven tasks
+* keep all the workers busy until the job is done.
+* The threads wait between jobs, so a pool can run many jobs. A pool runs one
+* job at a time.
+*
+* The following functions are available:
+*   threadPoolCreate		- Creates a new pool and starts its threads.
+*   threadPoolDestroy		- Stops the threads and deletes the pool.
+*   threadPoolGetSize		- Returns the number of workers of a pool.
+*   threadPoolRun			- Runs a job on all the workers and waits for it.
+*/
+
+/** Type for defining the thread pool */
+typedef struct ThreadPool_t* ThreadPool;
+
+/**
+* Type of the function of a job, called once for every task. worker is the
+* index of the worker running the task (0 to the pool size - 1), so every
+* worker can keep results of its own in context.
+*/
+typedef void (*ThreadPoolTaskFunction)(int task, int worker, void* context);
+
+/**
+* threadPoolCreate: Creates a new pool of worker_count workers, which starts
+* worker_count - 1 threads (the thread that runs a job is a worker too).
+*
+* @param worker_count - The number of workers, at least 1.
+* @param allocator - The allocator to take the pool from. It is only used by
+* 		threadPoolCreate and threadPoolDestroy, so it needs no locking.
+* @return
+* 	NULL - if worker_count is not positive, the allocator is not valid, or
+* 	allocations or starting a thread failed.
+* 	A new ThreadPool in case of success.
+*/
+ThreadPool threadPoolCreate(int worker_count, const Allocator* allocator);
+
+/**
+* threadPoolDestroy: Stops the threads of a pool (after the job they run, if
+* any) and deallocates it.
+*
+* @param pool - Target pool to be deallocated. If pool is NULL nothing will be done.
+*/
+void threadPoolDestroy(ThreadPool pool);
+
+/**
+* threadPoolGetSize: Returns the number of workers of a pool, -1 if a NULL pointer was sent.
+*/
+int threadPoolGetSize(ThreadPool pool);
+
+/**
+* threadPoolRun: Runs task_count tasks of a job on all the workers, and returns
+* once all of them are done. The function is called concurrently, it must only
+* change memory of its own task or worker.
+*
+* @param pool - The pool to run the job on.
+* @param task_count - The number of tasks.
+* @param function - Called with every task.
+* @param context - Passed as is to every call of the function.
+* @return
+* 	false if a NULL pointer was sent or task_count is negative (nothing is run).
+* 	true otherwise.
+*/
+bool threadPoolRun(ThreadPool pool, int task_count, ThreadPoolTaskFunction function, void* context);
+
+#endif /* THREAD_POOL_H_ */
@@ -0,0 +1,1274 @@
+#define _POSIX_C_SOURCE 200809L //needed for pthread
+#include "voteMatrix.h"
+#include "argmax.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+/** The initial number of areas the rows array can hold */
+#define INITIAL_SIZE 8
+/** The factor by which to expand the arrays when needed */
+#define EXPAND_FACTOR 2
+/** The bytes of a cache line, the matrix and each of its rows start at one */
+#define CACHE_LINE 64
+/** The ints of a cache line, the row length is a multiple of it */
+#define CACHE_LINE_INTS ((int)(CACHE_LINE / sizeof(int)))
+/** A row is sparse until it has votes of at least this many tribes... */
+#define SPARSE_ROW_LIMIT 8
+/** ...and of at least 1/DENSE_FILL_DIVISOR of all the tribes with a column */
+#define DENSE_FILL_DIVISOR 4
+#define NOT_DENSE -1
+#define FREE_COLUMN -1
+#define NO_LEADER -1
+/** A missing child of a node of the standings, or standings without nodes */
+#define NO_NODE -1
+/** The node of a row's tree that holds the column of the whole row's leader */
+#define TREE_ROOT 1
+#define ELEMENT_NOT_FOUND -1
+/** The areas marked by every word of a bitmask */
+#define MARK_BITS 64
+/** The fields a winner is read from (a sparse row's leader, a dense row's counters and tree) are
+* written and read whole, so threads may read winners while the row's own writer changes it */
+#define LOAD_WHOLE(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE_WHOLE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+//what a column keeps of its tribe besides its counters. a column in use is also a node of the
+//standings: a treap of the columns ordered by their totals, each subtree counting its nodes
+typedef struct TribeColumn_t {
+    IntMap areas; //the areas the tribe has votes in (area id -> 0), NULL before the first
+    long long total; //the votes of the tribe in all the areas
+    long long ranked_total; //the total the node is ordered by, total as of the last repair
+    int left; //the children of the node, NO_NODE if none
+    int right;
+    int size; //the nodes of the subtree of the node
+    bool stale; //total changed since ranked_total was taken, so the column is in stale_columns
+} TribeColumn;
+
+//a row of the matrix: either the index of a dense row, or a sparse map (NULL until the first vote)
+typedef struct VoteRow_t {
+    int area_id;
+    int dense; //the index of the row in the matrix, or NOT_DENSE
+    IntMap sparse; //tribe id -> votes, for a row that is not dense
+    int leader; //the leading tribe of a sparse row, or NO_LEADER if it has no votes
+    int leader_votes;
+    long long total; //the votes of all the tribes in the area
+} VoteRow;
+
+struct VoteMatrix_t {
+    Allocator allocator; //a copy of the allocator the matrix is taken from
+    IntMap area_rows; //area id -> index in rows
+    VoteRow* rows;
+    int rows_capacity;
+    int row_count;
+    IntMap tribe_columns; //tribe id -> column
+    int* column_tribes; //column -> tribe id, or FREE_COLUMN
+    int column_tribes_capacity;
+    int column_count; //the columns ever given, in use or free
+    int* free_columns; //a stack of the columns of removed tribes
+    int free_columns_capacity;
+    int free_column_count;
+    TribeColumn* columns; //column -> the areas and the total of its tribe
+    int columns_capacity;
+    int standings; //the root of the standings, NO_NODE if no column is in use
+    int* stale_columns; //the columns whose totals changed since the standings were last repaired
+    int stale_columns_capacity;
+    int stale_count;
+    pthread_mutex_t standings_lock; //votes of different areas may mark columns stale at once
+    void* block; //the matrix as allocated, counters is its first cache line
+    size_t block_size;
+    int* counters; //dense_capacity rows of 2 * stride ints, see denseRow
+    int stride; //the counters of a row, a power of 2 and a multiple of CACHE_LINE_INTS, at least column_count
+    int dense_capacity;
+    int dense_count;
+    int* dense_areas; //dense row -> area id
+    int dense_areas_capacity;
+};
+
+static void* growArray(VoteMatrix matrix, void* array, size_t item_size, int capacity, int new_capacity) {
+    return matrix->allocator.reallocate(matrix->allocator.context, array, (size_t)capacity * item_size,
+                                        (size_t)new_capacity * item_size);
+}
+
+static void freeArray(VoteMatrix matrix, void* array, size_t item_size, int capacity) {
+    if (array != NULL) {
+        matrix->allocator.deallocate(matrix->allocator.context, array, (size_t)capacity * item_size);
+    }
+}
+
+//a dense row is stride counters (all the unused ones are 0) followed by a tournament tree over
+//them: node n (1 <= n < stride) holds the leading column of its children 2n and 2n+1, where a
+//child c >= stride is the column c - stride itself. the leader of the row is at TREE_ROOT
+static inline int* denseRow(VoteMatrix matrix, int dense) {
+    return matrix->counters + (size_t)dense * 2 * matrix->stride;
+}
+
+//the leading column of two: more votes, then the lower tribe id. columns without votes never lead
+static inline int leadingColumn(VoteMatrix matrix, const int* counters, int first, int second) {
+    if (counters[first] != counters[second]) {
+        return counters[first] > counters[second] ? first : second;
+    }
+    if (counters[first] == 0) {
+        return first;
+    }
+    return matrix->column_tribes[first] < matrix->column_tribes[second] ? first : second;
+}
+
+static inline int treeChild(VoteMatrix matrix, const int* tree, int child) {
+    return child >= matrix->stride ? child - matrix->stride : tree[child];
+}
+
+static inline void updateTreeNode(VoteMatrix matrix, int* row, int node) {
+    int* tree = row + matrix->stride;
+    STORE_WHOLE(tree[node], leadingColumn(matrix, row, treeChild(matrix, tree, 2 * node),
+                                          treeChild(matrix, tree, 2 * node + 1)));
+}
+
+//repairs the tree after the counter of a column changed, O(log stride)
+static void updateTree(VoteMatrix matrix, int* row, int column) {
+    for (int node = (matrix->stride + column) / 2; node >= TREE_ROOT; node /= 2) {
+        updateTreeNode(matrix, row, node);
+    }
+}
+
+static void buildTree(VoteMatrix matrix, int* row) {
+    for (int node = matrix->stride - 1; node >= TREE_ROOT; node--) {
+        updateTreeNode(matrix, row, node);
+    }
+}
+
+//the standings change with the structure of the matrix (a column taken or freed), or in a repair under
+//standings_lock, so national queries running at once never change them together
+
+//the priority of a column's node: a fixed hash of the column, unrelated to the totals that order the nodes
+static uint32_t nodePriority(int column) {
+    uint32_t priority = (uint32_t)column * 0x9E3779B1u;
+    priority ^= priority >> 15;
+    priority *= 0x85EBCA6Bu;
+    return priority ^ (priority >> 13);
+}
+
+static inline int nodeSize(VoteMatrix matrix, int node) {
+    return node == NO_NODE ? 0 : matrix->columns[node].size;
+}
+
+static void updateNodeSize(VoteMatrix matrix, int node) {
+    TribeColumn* column = &matrix->columns[node];
+    column->size = 1 + nodeSize(matrix, column->left) + nodeSize(matrix, column->right);
+}
+
+//whether a column places before another in the standings: a larger ranked total, then the lower tribe id
+static bool placesBefore(VoteMatrix matrix, int column, int other) {
+    long long total = matrix->columns[column].ranked_total, other_total = matrix->columns[other].ranked_total;
+    return total > other_total
+           || (total == other_total && matrix->column_tribes[column] < matrix->column_tribes[other]);
+}
+
+//splits a subtree into the nodes that place before a column and the rest
+static void splitStandings(VoteMatrix matrix, int node, int column, int* before, int* after) {
+    if (node == NO_NODE) {
+        *before = NO_NODE;
+        *after = NO_NODE;
+        return;
+    }
+    if (placesBefore(matrix, node, column)) {
+        splitStandings(matrix, matrix->columns[node].right, column, &matrix->columns[node].right, after);
+        *before = node;
+    } else {
+        splitStandings(matrix, matrix->columns[node].left, column, before, &matrix->columns[node].left);
+        *after = node;
+    }
+    updateNodeSize(matrix, node);
+}
+
+//joins two subtrees, all the nodes of before placing before those of after. returns the root
+static int mergeStandings(VoteMatrix matrix, int before, int after) {
+    if (before == NO_NODE || after == NO_NODE) {
+        return before == NO_NODE ? after : before;
+    }
+    if (nodePriority(before) > nodePriority(after)) {
+        matrix->columns[before].right = mergeStandings(matrix, matrix->columns[before].right, after);
+        updateNodeSize(matrix, before);
+        return before;
+    }
+    matrix->columns[after].left = mergeStandings(matrix, before, matrix->columns[after].left);
+    updateNodeSize(matrix, after);
+    return after;
+}
+
+//puts a column in the standings by its ranked total, O(log tribes)
+static void insertStanding(VoteMatrix matrix, int column) {
+    matrix->columns[column].left = NO_NODE;
+    matrix->columns[column].right = NO_NODE;
+    matrix->columns[column].size = 1;
+    int before, after;
+    splitStandings(matrix, matrix->standings, column, &before, &after);
+    matrix->standings = mergeStandings(matrix, mergeStandings(matrix, before, column), after);
+}
+
+//takes a column out of a subtree of the standings, O(log tribes). returns the root of the subtree
+static int removeStanding(VoteMatrix matrix, int node, int column) {
+    TribeColumn* current = &matrix->columns[node];
+    if (node == column) {
+        return mergeStandings(matrix, current->left, current->right);
+    }
+    if (placesBefore(matrix, column, node)) {
+        current->left = removeStanding(matrix, current->left, column);
+    } else {
+        current->right = removeStanding(matrix, current->right, column);
+    }
+    updateNodeSize(matrix, node);
+    return node;
+}
+
+//queues a column whose total changed for the next repair of the standings. only the first change
+//since the last repair takes the lock, the rest see the column is queued already
+static void markStale(VoteMatrix matrix, int column) {
+    TribeColumn* node = &matrix->columns[column];
+    if (__atomic_load_n(&node->stale, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+    pthread_mutex_lock(&matrix->standings_lock);
+    if (!node->stale) {
+        __atomic_store_n(&node->stale, true, __ATOMIC_SEQ_CST);
+        matrix->stale_columns[matrix->stale_count++] = column; //a column is queued once, there is room
+    }
+    pthread_mutex_unlock(&matrix->standings_lock);
+}
+
+//moves every queued column to the place of its current total, O(log tribes) each. the caller holds
+//standings_lock. a column is unmarked before its total is read, so a vote meanwhile queues it again
+static void repairStandings(VoteMatrix matrix) {
+    while (matrix->stale_count > 0) {
+        int column = matrix->stale_columns[--matrix->stale_count];
+        TribeColumn* node = &matrix->columns[column];
+        __atomic_store_n(&node->stale, false, __ATOMIC_SEQ_CST);
+        if (matrix->column_tribes[column] == FREE_COLUMN) { //left the standings with its tribe
+            continue;
+        }
+        matrix->standings = removeStanding(matrix, matrix->standings, column);
+        node->ranked_total = __atomic_load_n(&node->total, __ATOMIC_SEQ_CST);
+        insertStanding(matrix, column);
+    }
+}
+
+//moves the matrix to a new block of capacity rows of stride counters. every array tracks
+//its own capacity, so a failed expand leaves the matrix valid
+static VoteMatrixResult resizeMatrix(VoteMatrix matrix, int stride, int capacity) {
+    assert(stride >= matrix->stride && capacity >= matrix->dense_count);
+    if (matrix->dense_areas_capacity < capacity) {
+        int* dense_areas = growArray(matrix, matrix->dense_areas, sizeof(*dense_areas),
+                                     matrix->dense_areas_capacity, capacity);
+        if (dense_areas == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        matrix->dense_areas = dense_areas;
+        matrix->dense_areas_capacity = capacity;
+    }
+    size_t counters_size = 2 * (size_t)stride * capacity * sizeof(int);
+    size_t block_size = counters_size + CACHE_LINE; //room to start at a cache line
+    void* block = matrix->allocator.allocate(matrix->allocator.context, block_size);
+    if (block == NULL) {
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    int* counters = (int*)(((uintptr_t)block + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+    memset(counters, 0, counters_size);
+    int old_stride = matrix->stride;
+    for (int dense = 0; dense < matrix->dense_count; dense++) { //the trees are copied too, if they fit
+        memcpy(counters + (size_t)dense * 2 * stride, denseRow(matrix, dense),
+               (size_t)(stride == old_stride ? 2 * old_stride : old_stride) * sizeof(int));
+    }
+    if (matrix->block != NULL) {
+        matrix->allocator.deallocate(matrix->allocator.context, matrix->block, matrix->block_size);
+    }
+    matrix->block = block;
+    matrix->block_size = block_size;
+    matrix->counters = counters;
+    matrix->stride = stride;
+    matrix->dense_capacity = capacity;
+    if (stride != old_stride) { //wider rows have deeper trees
+        for (int dense = 0; dense < matrix->dense_count; dense++) {
+            buildTree(matrix, denseRow(matrix, dense));
+        }
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//makes room for one more column: in the column arrays, and in every dense row
+static VoteMatrixResult reserveColumn(VoteMatrix matrix) {
+    int needed = matrix->column_count + 1;
+    if (matrix->column_tribes_capacity < needed) {
+        int new_capacity = EXPAND_FACTOR * matrix->column_tribes_capacity;
+        int* column_tribes = growArray(matrix, matrix->column_tribes, sizeof(*column_tribes),
+                                       matrix->column_tribes_capacity, new_capacity);
+        if (column_tribes == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        matrix->column_tribes = column_tribes;
+        matrix->column_tribes_capacity = new_capacity;
+    }
+    if (matrix->free_columns_capacity < needed) { //every column may be freed some day
+        int new_capacity = EXPAND_FACTOR * matrix->free_columns_capacity;
+        int* free_columns = growArray(matrix, matrix->free_columns, sizeof(*free_columns),
+                                      matrix->free_columns_capacity, new_capacity);
+        if (free_columns == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        matrix->free_columns = free_columns;
+        matrix->free_columns_capacity = new_capacity;
+    }
+    if (matrix->stale_columns_capacity < needed) { //every column may be queued at once
+        int new_capacity = EXPAND_FACTOR * matrix->stale_columns_capacity;
+        int* stale_columns = growArray(matrix, matrix->stale_columns, sizeof(*stale_columns),
+                                       matrix->stale_columns_capacity, new_capacity);
+        if (stale_columns == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        matrix->stale_columns = stale_columns;
+        matrix->stale_columns_capacity = new_capacity;
+    }
+    if (matrix->columns_capacity < needed) {
+        int new_capacity = EXPAND_FACTOR * matrix->columns_capacity;
+        TribeColumn* columns = growArray(matrix, matrix->columns, sizeof(*columns), matrix->columns_capacity,
+                                         new_capacity);
+        if (columns == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        memset(columns + matrix->columns_capacity, 0,
+               (size_t)(new_capacity - matrix->columns_capacity) * sizeof(*columns));
+        matrix->columns = columns;
+        matrix->columns_capacity = new_capacity;
+    }
+    if (matrix->stride < needed) {
+        if (matrix->block == NULL) { //no rows to widen yet
+            matrix->stride *= EXPAND_FACTOR;
+            return VOTE_MATRIX_SUCCESS;
+        }
+        return resizeMatrix(matrix, EXPAND_FACTOR * matrix->stride, matrix->dense_capacity);
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//returns the column of a tribe, giving it one if it has none. -1 if allocations failed
+static int findOrAddColumn(VoteMatrix matrix, int tribe_id) {
+    bool inserted = false;
+    int* column = intMapGetOrInsert(matrix->tribe_columns, tribe_id, FREE_COLUMN, &inserted);
+    if (column == NULL) {
+        return FREE_COLUMN;
+    }
+    if (!inserted) {
+        return *column;
+    }
+    if (matrix->free_column_count > 0) {
+        *column = matrix->free_columns[--matrix->free_column_count];
+    } else {
+        if (reserveColumn(matrix) != VOTE_MATRIX_SUCCESS) {
+            intMapRemove(matrix->tribe_columns, tribe_id);
+            return FREE_COLUMN;
+        }
+        *column = matrix->column_count++;
+    }
+    matrix->column_tribes[*column] = tribe_id;
+    matrix->columns[*column].ranked_total = matrix->columns[*column].total; //0, a freed column's total was cleared
+    insertStanding(matrix, *column);
+    return *column;
+}
+
+static VoteRow* findRow(VoteMatrix matrix, int area_id) {
+    int* row_index = intMapGet(matrix->area_rows, area_id);
+    return row_index == NULL ? NULL : &matrix->rows[*row_index];
+}
+
+//records that the tribe of a column got votes in an area. false if allocations failed
+static bool addPosting(VoteMatrix matrix, int column, int area_id) {
+    if (matrix->columns[column].areas == NULL) {
+        matrix->columns[column].areas = intMapCreate(&matrix->allocator);
+        if (matrix->columns[column].areas == NULL) {
+            return false;
+        }
+    }
+    return intMapPut(matrix->columns[column].areas, area_id, 0) == INT_MAP_SUCCESS;
+}
+
+//records that the tribe of a column has no votes in an area any more
+static void removePosting(VoteMatrix matrix, int column, int area_id) {
+    intMapRemove(matrix->columns[column].areas, area_id);
+}
+
+//counts votes added to (or removed from, if negative) a row and a column in their totals. rows change
+//under their own writer, but a column's total is shared by all the areas
+static void addToTotals(VoteMatrix matrix, VoteRow* row, int column, long long votes) {
+    STORE_WHOLE(row->total, row->total + votes);
+    __atomic_fetch_add(&matrix->columns[column].total, votes, __ATOMIC_SEQ_CST); //before the mark is checked
+    markStale(matrix, column);
+}
+
+//removes an area from the postings and the totals of all the tribes with votes in its row
+static void removeRowFromColumns(VoteMatrix matrix, const VoteRow* row) {
+    if (row->dense != NOT_DENSE) {
+        const int* counters = denseRow(matrix, row->dense);
+        for (int column = 0; column < matrix->column_count; column++) {
+            if (counters[column] > 0) {
+                removePosting(matrix, column, row->area_id);
+                matrix->columns[column].total -= counters[column];
+                markStale(matrix, column);
+            }
+        }
+        return;
+    }
+    const int* tribes;
+    const int* votes;
+    int number_of_tribes = row->sparse == NULL ? 0 : intMapGetEntries(row->sparse, &tribes, &votes);
+    for (int i = 0; i < number_of_tribes; i++) {
+        int column = *intMapGet(matrix->tribe_columns, tribes[i]);
+        removePosting(matrix, column, row->area_id);
+        matrix->columns[column].total -= votes[i];
+        markStale(matrix, column);
+    }
+}
+
+//moves a sparse row into the matrix. if allocations fail the row just stays sparse
+static void makeDense(VoteMatrix matrix, VoteRow* row) {
+    assert(row->dense == NOT_DENSE && row->sparse != NULL);
+    if (matrix->dense_count == matrix->dense_capacity) {
+        int capacity = matrix->dense_capacity > 0 ? EXPAND_FACTOR * matrix->dense_capacity : INITIAL_SIZE;
+        if (resizeMatrix(matrix, matrix->stride, capacity) != VOTE_MATRIX_SUCCESS) {
+            return;
+        }
+    }
+    int* counters = denseRow(matrix, matrix->dense_count);
+    const int* tribes;
+    const int* votes;
+    int number_of_tribes = intMapGetEntries(row->sparse, &tribes, &votes);
+    for (int i = 0; i < number_of_tribes; i++) {
+        counters[*intMapGet(matrix->tribe_columns, tribes[i])] = votes[i]; //every tribe with votes has a column
+    }
+    buildTree(matrix, counters);
+    intMapDestroy(row->sparse);
+    row->sparse = NULL;
+    row->dense = matrix->dense_count;
+    matrix->dense_areas[matrix->dense_count++] = row->area_id;
+}
+
+//makes a tribe the leader of a sparse row if it leads with its new number of votes
+static void offerSparseLeader(VoteRow* row, int tribe_id, int votes) {
+    if (row->leader == NO_LEADER || votes > row->leader_votes
+        || (votes == row->leader_votes && tribe_id < row->leader)) {
+        STORE_WHOLE(row->leader, tribe_id);
+        row->leader_votes = votes;
+    }
+}
+
+//finds the leader of a sparse row again, only needed after the leader lost votes
+static void findSparseLeader(VoteRow* row) {
+    const int* tribes = NULL;
+    const int* votes = NULL;
+    int number_of_tribes = row->sparse == NULL ? 0 : intMapGetEntries(row->sparse, &tribes, &votes);
+    int leader = argmaxFind(votes, tribes, number_of_tribes); //the votes and the tribes are contiguous
+    STORE_WHOLE(row->leader, leader == ELEMENT_NOT_FOUND ? NO_LEADER : tribes[leader]);
+    row->leader_votes = leader == ELEMENT_NOT_FOUND ? 0 : votes[leader];
+}
+
+static int rowWinner(VoteMatrix matrix, const VoteRow* row, int default_tribe) {
+    if (row->dense == NOT_DENSE) {
+        int leader = LOAD_WHOLE(row->leader);
+        return leader == NO_LEADER ? default_tribe : leader;
+    }
+    int* counters = denseRow(matrix, row->dense);
+    int column = LOAD_WHOLE(counters[matrix->stride + TREE_ROOT]);
+    return LOAD_WHOLE(counters[column]) > 0 ? matrix->column_tribes[column] : default_tribe;
+}
+
+VoteMatrix voteMatrixCreate(const Allocator* allocator) {
+    if (!allocatorIsValid(allocator)) {
+        return NULL;
+    }
+    VoteMatrix matrix = allocator->allocate(allocator->context, sizeof(*matrix));
+    if (matrix == NULL) {
+        return NULL;
+    }
+    memset(matrix, 0, sizeof(*matrix));
+    matrix->allocator = *allocator;
+    matrix->stride = CACHE_LINE_INTS;
+    matrix->area_rows = intMapCreate(allocator);
+    matrix->tribe_columns = intMapCreate(allocator);
+    matrix->rows = allocator->allocate(allocator->context, INITIAL_SIZE * sizeof(*matrix->rows));
+    matrix->column_tribes = allocator->allocate(allocator->context, INITIAL_SIZE * sizeof(int));
+    matrix->free_columns = allocator->allocate(allocator->context, INITIAL_SIZE * sizeof(int));
+    matrix->columns = allocator->allocate(allocator->context, INITIAL_SIZE * sizeof(TribeColumn));
+    matrix->stale_columns = allocator->allocate(allocator->context, INITIAL_SIZE * sizeof(int));
+    matrix->standings = NO_NODE;
+    pthread_mutex_init(&matrix->standings_lock, NULL);
+    matrix->rows_capacity = matrix->rows == NULL ? 0 : INITIAL_SIZE;
+    matrix->column_tribes_capacity = matrix->column_tribes == NULL ? 0 : INITIAL_SIZE;
+    matrix->free_columns_capacity = matrix->free_columns == NULL ? 0 : INITIAL_SIZE;
+    matrix->columns_capacity = matrix->columns == NULL ? 0 : INITIAL_SIZE;
+    matrix->stale_columns_capacity = matrix->stale_columns == NULL ? 0 : INITIAL_SIZE;
+    if (matrix->columns != NULL) {
+        memset(matrix->columns, 0, INITIAL_SIZE * sizeof(TribeColumn));
+    }
+    if (matrix->area_rows == NULL || matrix->tribe_columns == NULL || matrix->rows == NULL
+        || matrix->column_tribes == NULL || matrix->free_columns == NULL || matrix->columns == NULL
+        || matrix->stale_columns == NULL) {
+        voteMatrixDestroy(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+void voteMatrixDestroy(VoteMatrix matrix) {
+    if (matrix == NULL) {
+        return;
+    }
+    for (int i = 0; i < matrix->row_count; i++) {
+        intMapDestroy(matrix->rows[i].sparse);
+    }
+    for (int i = 0; i < matrix->columns_capacity; i++) {
+        intMapDestroy(matrix->columns[i].areas);
+    }
+    intMapDestroy(matrix->area_rows);
+    intMapDestroy(matrix->tribe_columns);
+    freeArray(matrix, matrix->rows, sizeof(*matrix->rows), matrix->rows_capacity);
+    freeArray(matrix, matrix->column_tribes, sizeof(int), matrix->column_tribes_capacity);
+    freeArray(matrix, matrix->free_columns, sizeof(int), matrix->free_columns_capacity);
+    freeArray(matrix, matrix->columns, sizeof(TribeColumn), matrix->columns_capacity);
+    freeArray(matrix, matrix->dense_areas, sizeof(int), matrix->dense_areas_capacity);
+    freeArray(matrix, matrix->stale_columns, sizeof(int), matrix->stale_columns_capacity);
+    pthread_mutex_destroy(&matrix->standings_lock);
+    Allocator allocator = matrix->allocator; //the matrix holds the allocator, keep it until the end
+    if (matrix->block != NULL) {
+        allocator.deallocate(allocator.context, matrix->block, matrix->block_size);
+    }
+    allocator.deallocate(allocator.context, matrix, sizeof(*matrix));
+}
+
+VoteMatrixResult voteMatrixAddArea(VoteMatrix matrix, int area_id) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    if (matrix->row_count == matrix->rows_capacity) {
+        int new_capacity = EXPAND_FACTOR * matrix->rows_capacity;
+        VoteRow* rows = growArray(matrix, matrix->rows, sizeof(*rows), matrix->rows_capacity, new_capacity);
+        if (rows == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        matrix->rows = rows;
+        matrix->rows_capacity = new_capacity;
+    }
+    bool inserted = false;
+    int* row_index = intMapGetOrInsert(matrix->area_rows, area_id, matrix->row_count, &inserted);
+    if (row_index == NULL) {
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    if (!inserted) {
+        return VOTE_MATRIX_AREA_ALREADY_EXISTS;
+    }
+    VoteRow* row = &matrix->rows[matrix->row_count++];
+    row->area_id = area_id;
+    row->dense = NOT_DENSE;
+    row->sparse = NULL;
+    row->leader = NO_LEADER;
+    row->leader_votes = 0;
+    row->total = 0;
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//slides the dense rows left down over the removed ones (those moved to NOT_DENSE). moves[dense] is
+//set to the new index of every row left
+static void compactDense(VoteMatrix matrix, int* moves) {
+    int kept = 0;
+    for (int dense = 0; dense < matrix->dense_count; dense++) {
+        if (moves[dense] == NOT_DENSE) {
+            continue;
+        }
+        if (kept != dense) {
+            memcpy(denseRow(matrix, kept), denseRow(matrix, dense), 2 * (size_t)matrix->stride * sizeof(int));
+            matrix->dense_areas[kept] = matrix->dense_areas[dense];
+        }
+        moves[dense] = kept++;
+    }
+    for (int dense = kept; dense < matrix->dense_count; dense++) {
+        memset(denseRow(matrix, dense), 0, (size_t)matrix->column_count * sizeof(int)); //the tree is built when reused
+    }
+    matrix->dense_count = kept;
+}
+
+VoteMatrixResult voteMatrixRemoveAreas(VoteMatrix matrix, int count, const int* area_ids, const uint64_t* marks) {
+    if (matrix == NULL || (count > 0 && (area_ids == NULL || marks == NULL))) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    int words = matrix->row_count / MARK_BITS + 1;
+    int moves_size = matrix->dense_count + 1;
+    uint64_t* removed_rows = growArray(matrix, NULL, sizeof(*removed_rows), 0, words);
+    int* dense_moves = growArray(matrix, NULL, sizeof(*dense_moves), 0, moves_size);
+    if (removed_rows == NULL || dense_moves == NULL) {
+        freeArray(matrix, removed_rows, sizeof(*removed_rows), words);
+        freeArray(matrix, dense_moves, sizeof(*dense_moves), moves_size);
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    memset(removed_rows, 0, (size_t)words * sizeof(*removed_rows));
+    memset(dense_moves, 0, (size_t)moves_size * sizeof(*dense_moves));
+    for (int word = 0; word * MARK_BITS < count; word++) { //only the set bits are visited
+        for (uint64_t bits = marks[word]; bits != 0; bits &= bits - 1) {
+            int i = word * MARK_BITS + __builtin_ctzll(bits);
+            int* row_index = i < count ? intMapGet(matrix->area_rows, area_ids[i]) : NULL;
+            if (row_index == NULL || ((removed_rows[*row_index / MARK_BITS] >> (*row_index % MARK_BITS)) & 1)) {
+                continue; //not in the matrix, or marked twice
+            }
+            VoteRow* row = &matrix->rows[*row_index];
+            removed_rows[*row_index / MARK_BITS] |= (uint64_t)1 << (*row_index % MARK_BITS);
+            removeRowFromColumns(matrix, row); //while a dense row still has its counters
+            if (row->dense != NOT_DENSE) {
+                dense_moves[row->dense] = NOT_DENSE;
+            }
+        }
+    }
+    compactDense(matrix, dense_moves);
+    int kept = 0;
+    for (int index = 0; index < matrix->row_count; index++) {
+        VoteRow* row = &matrix->rows[index];
+        if ((removed_rows[index / MARK_BITS] >> (index % MARK_BITS)) & 1) {
+            intMapDestroy(row->sparse);
+            intMapRemove(matrix->area_rows, row->area_id);
+            continue;
+        }
+        if (row->dense != NOT_DENSE) {
+            row->dense = dense_moves[row->dense];
+        }
+        if (kept != index) { //slides down over the removed rows
+            matrix->rows[kept] = *row;
+            *intMapGet(matrix->area_rows, row->area_id) = kept;
+        }
+        kept++;
+    }
+    matrix->row_count = kept;
+    freeArray(matrix, removed_rows, sizeof(*removed_rows), words);
+    freeArray(matrix, dense_moves, sizeof(*dense_moves), moves_size);
+    return VOTE_MATRIX_SUCCESS;
+}
+
+VoteMatrixResult voteMatrixRemoveTribe(VoteMatrix matrix, int tribe_id) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    int* column_pointer = intMapGet(matrix->tribe_columns, tribe_id);
+    if (column_pointer == NULL) { //no votes were ever given to the tribe
+        return VOTE_MATRIX_SUCCESS;
+    }
+    int column = *column_pointer;
+    const int* area_ids;
+    const int* values;
+    IntMap areas = matrix->columns[column].areas;
+    int number_of_areas = areas == NULL ? 0 : intMapGetEntries(areas, &area_ids, &values);
+    for (int i = 0; i < number_of_areas; i++) { //only the rows the tribe has votes in
+        VoteRow* row = findRow(matrix, area_ids[i]);
+        if (row->dense != NOT_DENSE) {
+            int* counters = denseRow(matrix, row->dense);
+            row->total -= counters[column];
+            counters[column] = 0; //the column is reused by the next new tribe
+            updateTree(matrix, counters, column);
+        } else {
+            row->total -= *intMapGet(row->sparse, tribe_id);
+            intMapRemove(row->sparse, tribe_id);
+            if (row->leader == tribe_id) {
+                findSparseLeader(row);
+            }
+        }
+    }
+    intMapDestroy(areas);
+    matrix->standings = removeStanding(matrix, matrix->standings, column); //before the tribe id is dropped
+    matrix->columns[column].areas = NULL;
+    matrix->columns[column].total = 0;
+    intMapRemove(matrix->tribe_columns, tribe_id);
+    matrix->column_tribes[column] = FREE_COLUMN;
+    matrix->free_columns[matrix->free_column_count++] = column;
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//adds votes of a tribe to a row. a dense row's tree is repaired only if repair_tree, otherwise
+//the caller rebuilds it
+static VoteMatrixResult addRowVotes(VoteMatrix matrix, VoteRow* row, int tribe_id, int votes, bool repair_tree) {
+    int column = findOrAddColumn(matrix, tribe_id);
+    if (column == FREE_COLUMN) {
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    if (row->dense != NOT_DENSE) {
+        int* counters = denseRow(matrix, row->dense);
+        if (counters[column] == 0 && !addPosting(matrix, column, row->area_id)) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+        STORE_WHOLE(counters[column], counters[column] + votes);
+        addToTotals(matrix, row, column, votes);
+        if (repair_tree) {
+            updateTree(matrix, counters, column);
+        }
+        return VOTE_MATRIX_SUCCESS;
+    }
+    if (row->sparse == NULL) {
+        row->sparse = intMapCreate(&matrix->allocator);
+        if (row->sparse == NULL) {
+            return VOTE_MATRIX_OUT_OF_MEMORY;
+        }
+    }
+    bool inserted = false;
+    int* tribe_votes = intMapGetOrInsert(row->sparse, tribe_id, 0, &inserted);
+    if (tribe_votes == NULL) {
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    if (inserted && !addPosting(matrix, column, row->area_id)) {
+        intMapRemove(row->sparse, tribe_id);
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    *tribe_votes += votes;
+    addToTotals(matrix, row, column, votes);
+    offerSparseLeader(row, tribe_id, *tribe_votes);
+    int row_tribes = intMapGetSize(row->sparse);
+    if (row_tribes >= SPARSE_ROW_LIMIT
+        && row_tribes * DENSE_FILL_DIVISOR >= matrix->column_count - matrix->free_column_count) {
+        makeDense(matrix, row);
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//removes votes of a tribe from a row, repairing a dense row's tree only if repair_tree. returns
+//true if the tribe led a sparse row, whose leader must then be found again
+static bool removeRowVotes(VoteMatrix matrix, VoteRow* row, int tribe_id, int votes, bool repair_tree) {
+    if (row->dense != NOT_DENSE) {
+        int* column = intMapGet(matrix->tribe_columns, tribe_id);
+        if (column != NULL) {
+            int* counters = denseRow(matrix, row->dense);
+            int removed = counters[*column] < votes ? counters[*column] : votes;
+            if (removed > 0 && removed == counters[*column]) {
+                removePosting(matrix, *column, row->area_id);
+            }
+            STORE_WHOLE(counters[*column], counters[*column] - removed);
+            addToTotals(matrix, row, *column, -(long long)removed);
+            if (repair_tree) {
+                updateTree(matrix, counters, *column);
+            }
+        }
+        return false;
+    }
+    int* tribe_votes = intMapGet(row->sparse, tribe_id);
+    if (tribe_votes == NULL) {
+        return false;
+    }
+    int column = *intMapGet(matrix->tribe_columns, tribe_id);
+    if (*tribe_votes <= votes) { //a tribe without votes is simply not in the map
+        addToTotals(matrix, row, column, -(long long)*tribe_votes);
+        intMapRemove(row->sparse, tribe_id);
+        removePosting(matrix, column, row->area_id);
+    } else {
+        *tribe_votes -= votes;
+        addToTotals(matrix, row, column, -(long long)votes);
+    }
+    return row->leader == tribe_id;
+}
+
+//whether changing count counters of a row is cheaper with one rebuild of its tree (O(stride))
+//than with a repair after every change (O(log stride) each)
+static bool rebuildsTree(VoteMatrix matrix, const VoteRow* row, int count) {
+    if (row->dense == NOT_DENSE) {
+        return false;
+    }
+    int depth = 0;
+    for (int width = matrix->stride; width > 1; width /= 2) {
+        depth++;
+    }
+    return (long long)count * depth >= matrix->stride;
+}
+
+VoteMatrixResult voteMatrixAddVotes(VoteMatrix matrix, int area_id, int tribe_id, int votes) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    return addRowVotes(matrix, row, tribe_id, votes, true);
+}
+
+VoteMatrixResult voteMatrixRemoveVotes(VoteMatrix matrix, int area_id, int tribe_id, int votes) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    if (removeRowVotes(matrix, row, tribe_id, votes, true)) {
+        findSparseLeader(row);
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+VoteMatrixResult voteMatrixAddTribe(VoteMatrix matrix, int tribe_id) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    return findOrAddColumn(matrix, tribe_id) == FREE_COLUMN ? VOTE_MATRIX_OUT_OF_MEMORY : VOTE_MATRIX_SUCCESS;
+}
+
+VoteMatrixResult voteMatrixAddVotesShared(VoteMatrix matrix, int area_id, int tribe_id, int votes) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    int* column = intMapGet(matrix->tribe_columns, tribe_id);
+    if (column == NULL) {
+        return VOTE_MATRIX_NEEDS_EXCLUSIVE;
+    }
+    //the first votes of the tribe in the area change the tribe's postings, shared with other areas
+    if (row->dense != NOT_DENSE ? denseRow(matrix, row->dense)[*column] == 0
+                                : row->sparse == NULL || !intMapContains(row->sparse, tribe_id)) {
+        return VOTE_MATRIX_NEEDS_EXCLUSIVE;
+    }
+    if (row->dense == NOT_DENSE) { //the same test addRowVotes makes after adding the votes
+        int row_tribes = intMapGetSize(row->sparse);
+        if (row_tribes >= SPARSE_ROW_LIMIT
+            && row_tribes * DENSE_FILL_DIVISOR >= matrix->column_count - matrix->free_column_count) {
+            return VOTE_MATRIX_NEEDS_EXCLUSIVE;
+        }
+    }
+    return addRowVotes(matrix, row, tribe_id, votes, true);
+}
+
+VoteMatrixResult voteMatrixRemoveVotesShared(VoteMatrix matrix, int area_id, int tribe_id, int votes) {
+    if (matrix == NULL) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    int tribe_votes = voteMatrixGetVotes(matrix, area_id, tribe_id);
+    if (tribe_votes == 0) {
+        return VOTE_MATRIX_SUCCESS;
+    }
+    if (tribe_votes <= votes) { //the tribe leaves the area's postings
+        return VOTE_MATRIX_NEEDS_EXCLUSIVE;
+    }
+    if (removeRowVotes(matrix, row, tribe_id, votes, true)) {
+        findSparseLeader(row);
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+VoteMatrixResult voteMatrixAddAreaVotes(VoteMatrix matrix, int area_id, int count, const int* tribe_ids,
+                                        const int* votes) {
+    if (matrix == NULL || (count > 0 && (tribe_ids == NULL || votes == NULL))) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    bool rebuild = rebuildsTree(matrix, row, count);
+    VoteMatrixResult result = VOTE_MATRIX_SUCCESS;
+    for (int i = 0; i < count && result == VOTE_MATRIX_SUCCESS; i++) {
+        result = addRowVotes(matrix, row, tribe_ids[i], votes[i], !rebuild);
+    }
+    if (rebuild) { //the row was dense from the start, so it still is
+        buildTree(matrix, denseRow(matrix, row->dense));
+    }
+    return result;
+}
+
+VoteMatrixResult voteMatrixRemoveAreaVotes(VoteMatrix matrix, int area_id, int count, const int* tribe_ids,
+                                           const int* votes) {
+    if (matrix == NULL || (count > 0 && (tribe_ids == NULL || votes == NULL))) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    bool rebuild = rebuildsTree(matrix, row, count);
+    bool leader_lost = false;
+    for (int i = 0; i < count; i++) {
+        leader_lost = removeRowVotes(matrix, row, tribe_ids[i], votes[i], !rebuild) || leader_lost;
+    }
+    if (rebuild) {
+        buildTree(matrix, denseRow(matrix, row->dense));
+    }
+    if (leader_lost) { //once for the whole batch
+        findSparseLeader(row);
+    }
+    return VOTE_MATRIX_SUCCESS;
+}
+
+int voteMatrixGetVotes(VoteMatrix matrix, int area_id, int tribe_id) {
+    if (matrix == NULL) {
+        return 0;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return 0;
+    }
+    if (row->dense != NOT_DENSE) {
+        int* column = intMapGet(matrix->tribe_columns, tribe_id);
+        return column == NULL ? 0 : denseRow(matrix, row->dense)[*column];
+    }
+    int* tribe_votes = intMapGet(row->sparse, tribe_id);
+    return tribe_votes == NULL ? 0 : *tribe_votes;
+}
+
+long long voteMatrixGetAreaTotal(VoteMatrix matrix, int area_id) {
+    if (matrix == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    return row == NULL ? ELEMENT_NOT_FOUND : LOAD_WHOLE(row->total);
+}
+
+long long voteMatrixGetTribeTotal(VoteMatrix matrix, int tribe_id) {
+    if (matrix == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    int* column = intMapGet(matrix->tribe_columns, tribe_id);
+    return column == NULL ? 0 : __atomic_load_n(&matrix->columns[*column].total, __ATOMIC_RELAXED);
+}
+
+//the order of a top list: more votes, then the lower tribe id
+static inline bool placesAhead(const int* tribe_ids, const long long* votes, int first, int second) {
+    return votes[first] > votes[second] || (votes[first] == votes[second] && tribe_ids[first] < tribe_ids[second]);
+}
+
+static void swapPlaces(int* tribe_ids, long long* votes, int first, int second) {
+    int tribe_id = tribe_ids[first];
+    long long tribe_votes = votes[first];
+    tribe_ids[first] = tribe_ids[second];
+    votes[first] = votes[second];
+    tribe_ids[second] = tribe_id;
+    votes[second] = tribe_votes;
+}
+
+//moves an entry down a heap of the first size places, where every parent places behind its children
+static void siftLast(int* tribe_ids, long long* votes, int size, int position) {
+    while (2 * position + 1 < size) {
+        int child = 2 * position + 1;
+        if (child + 1 < size && placesAhead(tribe_ids, votes, child, child + 1)) {
+            child++;
+        }
+        if (!placesAhead(tribe_ids, votes, position, child)) {
+            break;
+        }
+        swapPlaces(tribe_ids, votes, position, child);
+        position = child;
+    }
+}
+
+//the top list of a sparse row: the best k seen so far are a heap with the last of them first, so a
+//tribe replaces it or is dropped in O(log k). the heap is then sorted best first. O(n log k)
+static void sparseTopTribes(const VoteRow* row, int k, int* tribe_ids, long long* votes, int* count) {
+    const int* tribes;
+    const int* tribe_votes;
+    int number_of_tribes = row->sparse == NULL ? 0 : intMapGetEntries(row->sparse, &tribes, &tribe_votes);
+    for (int i = 0; i < number_of_tribes && k > 0; i++) {
+        int position = *count < k ? (*count)++ : k;
+        if (position == k) { //a full list: the tribe replaces the last of it, or places behind all of it
+            if (tribe_votes[i] < votes[0] || (tribe_votes[i] == votes[0] && tribes[i] > tribe_ids[0])) {
+                continue;
+            }
+            tribe_ids[0] = tribes[i];
+            votes[0] = tribe_votes[i];
+            siftLast(tribe_ids, votes, k, 0);
+            continue;
+        }
+        tribe_ids[position] = tribes[i];
+        votes[position] = tribe_votes[i];
+        while (position > 0 && placesAhead(tribe_ids, votes, (position - 1) / 2, position)) {
+            swapPlaces(tribe_ids, votes, position, (position - 1) / 2);
+            position = (position - 1) / 2;
+        }
+    }
+    for (int size = *count - 1; size > 0; size--) { //the last place goes to the end of what is left
+        swapPlaces(tribe_ids, votes, 0, size);
+        siftLast(tribe_ids, votes, size, 0);
+    }
+}
+
+//a node (or, at stride and above, a leaf) of a dense row's tree is a candidate for the next
+//place of a top list with the leading column under it. the heap keeps the best candidate first
+static bool candidateLeads(VoteMatrix matrix, const int* row, int first, int second) {
+    const int* tree = row + matrix->stride;
+    int first_column = treeChild(matrix, tree, first);
+    return leadingColumn(matrix, row, first_column, treeChild(matrix, tree, second)) == first_column;
+}
+
+static void pushCandidate(VoteMatrix matrix, const int* row, int* heap, int* size, int node) {
+    int position = (*size)++;
+    while (position > 0 && candidateLeads(matrix, row, node, heap[(position - 1) / 2])) {
+        heap[position] = heap[(position - 1) / 2];
+        position = (position - 1) / 2;
+    }
+    heap[position] = node;
+}
+
+static int popCandidate(VoteMatrix matrix, const int* row, int* heap, int* size) {
+    int best = heap[0];
+    int last = heap[--(*size)];
+    int position = 0;
+    while (2 * position + 1 < *size) {
+        int child = 2 * position + 1;
+        if (child + 1 < *size && candidateLeads(matrix, row, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!candidateLeads(matrix, row, heap[child], last)) {
+            break;
+        }
+        heap[position] = heap[child];
+        position = child;
+    }
+    heap[position] = last;
+    return best;
+}
+
+//the top list of a dense row, from its tree: the best candidate is the next place, and the
+//siblings on the way down to its column are the candidates it leaves. O(k log stride)
+static VoteMatrixResult denseTopTribes(VoteMatrix matrix, const int* row, int k, int* tribe_ids, long long* votes,
+                                       int* count) {
+    int depth = 0;
+    for (int width = matrix->stride; width > 1; width /= 2) {
+        depth++;
+    }
+    size_t heap_size = ((size_t)k * depth + 1) * sizeof(int);
+    int* heap = matrix->allocator.allocate(matrix->allocator.context, heap_size);
+    if (heap == NULL) {
+        return VOTE_MATRIX_OUT_OF_MEMORY;
+    }
+    const int* tree = row + matrix->stride;
+    int size = 0;
+    pushCandidate(matrix, row, heap, &size, TREE_ROOT);
+    while (*count < k && size > 0) {
+        int node = popCandidate(matrix, row, heap, &size);
+        int column = treeChild(matrix, tree, node);
+        if (row[column] == 0) { //the rest have no votes either
+            break;
+        }
+        tribe_ids[*count] = matrix->column_tribes[column];
+        votes[(*count)++] = row[column];
+        while (node < matrix->stride) { //down to the column, the other child of every node is a candidate
+            int left = 2 * node;
+            bool left_leads = treeChild(matrix, tree, left) == column;
+            pushCandidate(matrix, row, heap, &size, left_leads ? left + 1 : left);
+            node = left_leads ? left : left + 1;
+        }
+    }
+    matrix->allocator.deallocate(matrix->allocator.context, heap, heap_size);
+    return VOTE_MATRIX_SUCCESS;
+}
+
+VoteMatrixResult voteMatrixGetTopTribes(VoteMatrix matrix, int area_id, int k, int* tribe_ids, long long* votes,
+                                        int* count) {
+    if (matrix == NULL || count == NULL || (k > 0 && (tribe_ids == NULL || votes == NULL))) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return VOTE_MATRIX_AREA_DOES_NOT_EXIST;
+    }
+    *count = 0;
+    k = k < matrix->column_count ? k : matrix->column_count; //no more places than tribes with votes
+    if (row->dense != NOT_DENSE) {
+        return k <= 0 ? VOTE_MATRIX_SUCCESS : denseTopTribes(matrix, denseRow(matrix, row->dense), k, tribe_ids,
+                                                               votes, count);
+    }
+    sparseTopTribes(row, k, tribe_ids, votes, count);
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//the places of the standings in order, until k are listed or the rest have no votes
+static void collectStandings(VoteMatrix matrix, int node, int k, int* tribe_ids, long long* totals, int* count) {
+    if (node == NO_NODE || *count >= k) {
+        return;
+    }
+    const TribeColumn* column = &matrix->columns[node];
+    collectStandings(matrix, column->left, k, tribe_ids, totals, count);
+    if (*count >= k || column->ranked_total <= 0) {
+        return;
+    }
+    tribe_ids[*count] = matrix->column_tribes[node];
+    totals[(*count)++] = column->ranked_total;
+    collectStandings(matrix, column->right, k, tribe_ids, totals, count);
+}
+
+VoteMatrixResult voteMatrixGetTopTotals(VoteMatrix matrix, int k, int* tribe_ids, long long* totals, int* count) {
+    if (matrix == NULL || count == NULL || (k > 0 && (tribe_ids == NULL || totals == NULL))) {
+        return VOTE_MATRIX_NULL_ARGUMENT;
+    }
+    *count = 0;
+    pthread_mutex_lock(&matrix->standings_lock);
+    repairStandings(matrix);
+    collectStandings(matrix, matrix->standings, k, tribe_ids, totals, count);
+    pthread_mutex_unlock(&matrix->standings_lock);
+    return VOTE_MATRIX_SUCCESS;
+}
+
+//the columns of a dense row with more than some votes. a subtree whose leader has no more is skipped
+//whole, so only the nodes above those columns are visited: O(rank log stride)
+static int countAbove(VoteMatrix matrix, const int* row, int node, int votes) {
+    int column = treeChild(matrix, row + matrix->stride, node);
+    if (row[column] <= votes) {
+        return 0;
+    }
+    if (node >= matrix->stride) { //a leaf, the column itself
+        return 1;
+    }
+    return countAbove(matrix, row, 2 * node, votes) + countAbove(matrix, row, 2 * node + 1, votes);
+}
+
+int voteMatrixGetRank(VoteMatrix matrix, int area_id, int tribe_id) {
+    if (matrix == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    VoteRow* row = findRow(matrix, area_id);
+    if (row == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    int tribe_votes = voteMatrixGetVotes(matrix, area_id, tribe_id);
+    if (row->dense != NOT_DENSE) {
+        return 1 + countAbove(matrix, denseRow(matrix, row->dense), TREE_ROOT, tribe_votes);
+    }
+    int rank = 1;
+    const int* tribes;
+    const int* votes;
+    int number_of_tribes = row->sparse == NULL ? 0 : intMapGetEntries(row->sparse, &tribes, &votes);
+    for (int i = 0; i < number_of_tribes; i++) {
+        rank += votes[i] > tribe_votes;
+    }
+    return rank;
+}
+
+int voteMatrixGetTotalRank(VoteMatrix matrix, int tribe_id) {
+    if (matrix == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    int* column = intMapGet(matrix->tribe_columns, tribe_id);
+    int rank = 1;
+    pthread_mutex_lock(&matrix->standings_lock);
+    repairStandings(matrix);
+    long long tribe_total = column == NULL ? 0 : matrix->columns[*column].ranked_total;
+    int node = matrix->standings;
+    while (node != NO_NODE) { //down to where the total would be, counting the nodes with more on the way
+        const TribeColumn* current = &matrix->columns[node];
+        if (current->ranked_total > tribe_total) {
+            rank += 1 + nodeSize(matrix, current->left);
+            node = current->right;
+        } else {
+            node = current->left;
+        }
+    }
+    pthread_mutex_unlock(&matrix->standings_lock);
+    return rank;
+}
+
+bool voteMatrixForEachWinner(VoteMatrix matrix, int default_tribe, VoteMatrixWinnerFunction function,
+                             void* context) {
+    if (matrix == NULL || function == NULL) {
+        return false;
+    }
+    for (int i = 0; i < matrix->row_count; i++) { //every row keeps its leader, no votes are read
+        if (!function(matrix->rows[i].area_id, rowWinner(matrix, &matrix->rows[i], default_tribe), context)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int voteMatrixGetAreaCount(VoteMatrix matrix) {
+    if (matrix == NULL) {
+        return ELEMENT_NOT_FOUND;
+    }
+    return matrix->row_count;
+}
+
+bool voteMatrixGetWinners(VoteMatrix matrix, int first, int count, int default_tribe, int* area_ids, int* winners) {
+    if (matrix == NULL || area_ids == NULL || winners == NULL) {
+        return false;
+    }
+    if (first < 0 || count < 0 || count > matrix->row_count - first) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        const VoteRow* row = &matrix->rows[first + i];
+        area_ids[i] = row->area_id;
+        winners[i] = rowWinner(matrix, row, default_tribe);
+    }
+    return true;
+}
+
+static void addMapMemoryUsage(MapMemoryUsage* total, MapMemoryUsage usage) {
+    total->payload_bytes += usage.payload_bytes;
+    total->structure_bytes += usage.structure_bytes;
+    total->slack_bytes += usage.slack_bytes;
+    total->overhead_bytes += usage.overhead_bytes;
+    total->total_bytes += usage.total_bytes;
+}
+
+//adds an index array of the matrix, all structure, its unused part slack
+static void addArrayUsage(VoteMatrix matrix, MapMemoryUsage* usage, const void* array,
+                          size_t capacity_bytes, size_t used_bytes) {
+    usage->structure_bytes += capacity_bytes;
+    usage->slack_bytes += capacity_bytes - used_bytes;
+    usage->overhead_bytes += array == NULL ? 0 : allocatorEstimateOverhead(&matrix->allocator, array, capacity_bytes);
+}
+
+static void updateLargestRow(VoteMatrixMemoryUsage* usage, int area_id, size_t bytes) {
+    if (usage->largest_row_area == ELEMENT_NOT_FOUND || bytes > usage->largest_row_bytes) {
+        usage->largest_row_area = area_id;
+        usage->largest_row_bytes = bytes;
+    }
+}
+
+VoteMatrixMemoryUsage voteMatrixMemoryUsage(VoteMatrix matrix) {
+    VoteMatrixMemoryUsage usage;
+    memset(&usage, 0, sizeof(usage));
+    usage.largest_row_area = ELEMENT_NOT_FOUND;
+    if (matrix == NULL) {
+        return usage;
+    }
+    MapMemoryUsage* tallies = &usage.tallies;
+    addMapMemoryUsage(tallies, intMapMemoryUsage(matrix->area_rows));
+    addMapMemoryUsage(tallies, intMapMemoryUsage(matrix->tribe_columns));
+    tallies->structure_bytes += sizeof(*matrix);
+    tallies->overhead_bytes += allocatorEstimateOverhead(&matrix->allocator, matrix, sizeof(*matrix));
+    addArrayUsage(matrix, tallies, matrix->rows, (size_t)matrix->rows_capacity * sizeof(*matrix->rows),
+                  (size_t)matrix->row_count * sizeof(*matrix->rows));
+    addArrayUsage(matrix, tallies, matrix->column_tribes, (size_t)matrix->column_tribes_capacity * sizeof(int),
+                  (size_t)matrix->column_count * sizeof(int));
+    addArrayUsage(matrix, tallies, matrix->free_columns, (size_t)matrix->free_columns_capacity * sizeof(int),
+                  (size_t)matrix->free_column_count * sizeof(int));
+    addArrayUsage(matrix, tallies, matrix->columns, (size_t)matrix->columns_capacity * sizeof(TribeColumn),
+                  (size_t)matrix->column_count * sizeof(TribeColumn));
+    for (int column = 0; column < matrix->column_count; column++) {
+        addMapMemoryUsage(tallies, intMapMemoryUsage(matrix->columns[column].areas));
+    }
+    addArrayUsage(matrix, tallies, matrix->dense_areas, (size_t)matrix->dense_areas_capacity * sizeof(int),
+                  (size_t)matrix->dense_count * sizeof(int));
+    addArrayUsage(matrix, tallies, matrix->stale_columns, (size_t)matrix->stale_columns_capacity * sizeof(int),
+                  (size_t)matrix->stale_count * sizeof(int));
+    size_t dense_payload = (size_t)matrix->dense_count * matrix->column_count * sizeof(int);
+    tallies->payload_bytes += dense_payload;
+    tallies->structure_bytes += matrix->block_size - dense_payload;
+    tallies->slack_bytes += matrix->block_size - dense_payload;
+    if (matrix->block != NULL) {
+        tallies->overhead_bytes += allocatorEstimateOverhead(&matrix->allocator, matrix->block, matrix->block_size);
+    }
+    for (int i = 0; i < matrix->row_count; i++) {
+        VoteRow* row = &matrix->rows[i];
+        if (row->dense != NOT_DENSE) {
+            updateLargestRow(&usage, row->area_id, 2 * (size_t)matrix->stride * sizeof(int));
+            continue;
+        }
+        MapMemoryUsage row_usage = intMapMemoryUsage(row->sparse); //all zeros for a row without votes
+        addMapMemoryUsage(tallies, row_usage);
+        updateLargestRow(&usage, row->area_id, row_usage.total_bytes);
+    }
+    tallies->total_bytes = tallies->payload_bytes + tallies->structure_bytes + tallies->overhead_bytes;
+    return usage;
+}
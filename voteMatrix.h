@@ -0,0 +1,345 @@
+#ifndef VOTE_MATRIX_H_
+#define VOTE_MATRIX_H_
+
+#include "intMap.h"
+#include <stdbool.h>
+#include <stdint.h>
+/**
+* Vote Matrix
+*
+* Implements the vote tallies of an election: the votes of every tribe in
+* every area.
+* Every area has a row and every tribe that got votes has a column, so the
+* sparse ids are compacted to dense indices (a removed tribe's column is
+* reused by the next new tribe). A row starts sparse - an IntMap of tribe id
+* to votes, allocated with the first vote - and once it holds votes of a
+* large enough part of the tribes it moves into the matrix: one contiguous,
+* cache line aligned block of int counters, a row per area. A vote to a dense
+* row is an indexed add.
+* Every row keeps its leading tribe as the votes change: a sparse row holds it
+* (and looks for it again only when the leader loses votes), and a dense row
+* has a tournament tree over its counters, repaired in O(log tribes) after
+* every change. Finding the winner of an area reads no votes.
+* Every column also keeps the areas its tribe has votes in, updated when a
+* tribe gets its first votes in an area or loses its last, so removing a tribe
+* visits only those areas. The total votes of every row and every column are
+* kept as the votes change, so they are read in O(1).
+* The columns are also the standings: a treap ordered by the tribes' totals,
+* every node counting its subtree, from which the national top list and places
+* are read. A vote only marks its column (once until the next national query),
+* and the next national query moves the marked columns to their places in
+* O(log tribes) each, so votes in different areas never wait on the standings.
+* A matrix may be shared by threads: changes to different areas may run at
+* once with voteMatrixAddVotesShared and voteMatrixRemoveVotesShared, and
+* winners may be read meanwhile, as long as nothing else changes the matrix
+* (see voteMatrixAddVotesShared).
+*
+* The following functions are available:
+*   voteMatrixCreate		- Creates a new empty matrix.
+*   voteMatrixDestroy		- Deletes an existing matrix and frees all resources.
+*   voteMatrixAddArea		- Adds an area without votes.
+*   voteMatrixRemoveAreas	- Removes many areas and their votes in one sweep.
+*   voteMatrixRemoveTribe	- Removes the votes of a tribe in all the areas.
+*   voteMatrixAddTribe		- Gives a tribe a column before its first votes.
+*   voteMatrixAddVotes		- Adds votes of a tribe in an area.
+*   voteMatrixAddVotesShared	- Adds votes of a tribe in an area, if no other area is affected.
+*   voteMatrixRemoveVotes	- Removes votes of a tribe in an area.
+*   voteMatrixRemoveVotesShared	- Removes votes of a tribe in an area, if no other area is affected.
+*   voteMatrixAddAreaVotes	- Adds votes of many tribes in one area.
+*   voteMatrixRemoveAreaVotes	- Removes votes of many tribes in one area.
+*   voteMatrixGetVotes		- Returns the votes of a tribe in an area.
+*   voteMatrixGetAreaTotal	- Returns the votes of all the tribes in an area.
+*   voteMatrixGetTribeTotal	- Returns the votes of a tribe in all the areas.
+*   voteMatrixGetTopTribes	- Returns the k tribes with the most votes in an area.
+*   voteMatrixGetTopTotals	- Returns the k tribes with the most votes in all the areas.
+*   voteMatrixGetRank		- Returns the place of a tribe in an area.
+*   voteMatrixGetTotalRank	- Returns the place of a tribe in all the areas.
+*   voteMatrixForEachWinner	- Calls a function with the winner of every area.
+*   voteMatrixGetAreaCount	- Returns the number of areas.
+*   voteMatrixGetWinners	- Fills arrays with a range of the areas and their winners.
+*   voteMatrixMemoryUsage	- Returns a breakdown of the memory the matrix holds.
+*/
+
+/** Type for defining the vote matrix */
+typedef struct VoteMatrix_t* VoteMatrix;
+
+/** Type used for returning error codes from vote matrix functions */
+typedef enum VoteMatrixResult_t {
+    VOTE_MATRIX_SUCCESS,
+    VOTE_MATRIX_OUT_OF_MEMORY,
+    VOTE_MATRIX_NULL_ARGUMENT,
+    VOTE_MATRIX_AREA_ALREADY_EXISTS,
+    VOTE_MATRIX_AREA_DOES_NOT_EXIST,
+    VOTE_MATRIX_NEEDS_EXCLUSIVE
+} VoteMatrixResult;
+
+/**
+* Type of a function called by voteMatrixForEachWinner with an area and its
+* winning tribe. Returning false stops the iteration.
+*/
+typedef bool (*VoteMatrixWinnerFunction)(int area_id, int tribe_id, void* context);
+
+/** A breakdown of the memory held by a matrix, see voteMatrixMemoryUsage */
+typedef struct VoteMatrixMemoryUsage_t {
+    MapMemoryUsage tallies;     // the matrix, the sparse rows and the id indices, all together
+    int largest_row_area;       // the area with the largest row, -1 if there are no areas
+    size_t largest_row_bytes;   // the bytes of that row
+} VoteMatrixMemoryUsage;
+
+/**
+* voteMatrixCreate: Allocates a new empty matrix.
+*
+* @param allocator - The allocator to take the matrix from. It is copied, but
+* 		its context must stay valid for as long as the matrix exists.
+* @return
+* 	NULL - if the allocator is not valid or allocations failed.
+* 	A new VoteMatrix in case of success.
+*/
+VoteMatrix voteMatrixCreate(const Allocator* allocator);
+
+/**
+* voteMatrixDestroy: Deallocates an existing matrix.
+*
+* @param matrix - Target matrix to be deallocated. If matrix is NULL nothing will be done.
+*/
+void voteMatrixDestroy(VoteMatrix matrix);
+
+/**
+* voteMatrixAddArea: Adds an area without votes.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_ALREADY_EXISTS if the area is in the matrix already.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed (the matrix is left as it was).
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixAddArea(VoteMatrix matrix, int area_id);
+
+/**
+* voteMatrixRemoveAreas: Removes the marked areas of an array and all their
+* votes: area_ids[i] is removed if bit i % 64 of marks[i / 64] is set. Areas
+* that are not in the matrix are skipped. The rows and the dense rows left are
+* compacted in one sweep each, keeping their order.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed (the matrix is left as it was).
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixRemoveAreas(VoteMatrix matrix, int count, const int* area_ids, const uint64_t* marks);
+
+/**
+* voteMatrixRemoveTribe: Removes the votes of a tribe in all the areas and
+* frees its column. O(the areas the tribe has votes in).
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_SUCCESS otherwise (also if the tribe has no votes).
+*/
+VoteMatrixResult voteMatrixRemoveTribe(VoteMatrix matrix, int tribe_id);
+
+/**
+* voteMatrixAddTribe: Gives a tribe a column (if it has none) before its first
+* votes, so voteMatrixAddVotesShared never has to.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed (the matrix is left as it was).
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixAddTribe(VoteMatrix matrix, int tribe_id);
+
+/**
+* voteMatrixAddVotes: Adds votes of a tribe in an area.
+*
+* @param matrix - The matrix to change.
+* @param area_id - The area, must be in the matrix.
+* @param tribe_id - The tribe, any id; it gets a column with its first votes.
+* @param votes - The number of votes to add, must be positive.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_DOES_NOT_EXIST if the area is not in the matrix.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed (the matrix is left as it was).
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixAddVotes(VoteMatrix matrix, int area_id, int tribe_id, int votes);
+
+/**
+* voteMatrixAddVotesShared: Adds votes of a tribe in an area, as
+* voteMatrixAddVotes does, changing nothing but the area's own row - unless the
+* votes need a change of the matrix itself (a column for the tribe, the tribe's
+* first votes in the area, or the move of the row into the matrix), which it
+* leaves to voteMatrixAddVotes.
+* So it may run on many threads at once (with voteMatrixRemoveVotesShared, and with
+* threads that read winners) as long as no two of them change the same area
+* and nothing else changes the matrix meanwhile. The allocator must be thread safe.
+* @return
+* 	VOTE_MATRIX_NEEDS_EXCLUSIVE if the votes need voteMatrixAddVotes (nothing is changed).
+* 	Otherwise the results of voteMatrixAddVotes.
+*/
+VoteMatrixResult voteMatrixAddVotesShared(VoteMatrix matrix, int area_id, int tribe_id, int votes);
+
+/**
+* voteMatrixRemoveVotes: Removes votes of a tribe in an area. Removing more
+* votes than the tribe has leaves it with 0.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_DOES_NOT_EXIST if the area is not in the matrix.
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixRemoveVotes(VoteMatrix matrix, int area_id, int tribe_id, int votes);
+
+/**
+* voteMatrixRemoveVotesShared: Removes votes of a tribe in an area, as
+* voteMatrixRemoveVotes does, unless they are all the tribe's votes in the area
+* (the tribe leaves the area's postings), which it leaves to
+* voteMatrixRemoveVotes. May run on many threads at once, see
+* voteMatrixAddVotesShared.
+* @return
+* 	VOTE_MATRIX_NEEDS_EXCLUSIVE if the votes need voteMatrixRemoveVotes (nothing is changed).
+* 	Otherwise the results of voteMatrixRemoveVotes.
+*/
+VoteMatrixResult voteMatrixRemoveVotesShared(VoteMatrix matrix, int area_id, int tribe_id, int votes);
+
+/**
+* voteMatrixAddAreaVotes: Adds votes of many tribes (a tribe may repeat) in one
+* area, as voteMatrixAddVotes would one by one. The area is looked up once, and
+* a dense row that gets enough votes has its tree rebuilt once at the end
+* instead of repaired after every vote.
+*
+* @param matrix - The matrix to change.
+* @param area_id - The area, must be in the matrix.
+* @param count - The number of votes.
+* @param tribe_ids - The tribe of every vote.
+* @param votes - The number of votes to add to each tribe, every one positive.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_DOES_NOT_EXIST if the area is not in the matrix.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed (the votes before the one
+* 	that failed are added).
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixAddAreaVotes(VoteMatrix matrix, int area_id, int count, const int* tribe_ids,
+                                        const int* votes);
+
+/**
+* voteMatrixRemoveAreaVotes: Removes votes of many tribes in one area, as
+* voteMatrixRemoveVotes would one by one. The area is looked up once, and the
+* leader of the area is found again at most once.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_DOES_NOT_EXIST if the area is not in the matrix.
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixRemoveAreaVotes(VoteMatrix matrix, int area_id, int count, const int* tribe_ids,
+                                           const int* votes);
+
+/**
+* voteMatrixGetVotes: Returns the votes of a tribe in an area, 0 if a NULL
+* pointer was sent or the area or the tribe have no votes.
+*/
+int voteMatrixGetVotes(VoteMatrix matrix, int area_id, int tribe_id);
+
+/**
+* voteMatrixGetAreaTotal: Returns the votes of all the tribes in an area, -1 if
+* a NULL pointer was sent or the area is not in the matrix.
+*/
+long long voteMatrixGetAreaTotal(VoteMatrix matrix, int area_id);
+
+/**
+* voteMatrixGetTribeTotal: Returns the votes of a tribe in all the areas, 0 if
+* the tribe has no votes, -1 if a NULL pointer was sent.
+*/
+long long voteMatrixGetTribeTotal(VoteMatrix matrix, int tribe_id);
+
+/**
+* voteMatrixGetTopTribes: Sets arrays to the k tribes with the most votes in an
+* area, in order: more votes first, then the lower tribe id. Tribes without
+* votes are not listed, so there may be fewer than k. A dense row is read from
+* its tree in O(k log tribes), a sparse row in one pass over its tribes that
+* keeps the best k in a heap, O(tribes in the area * log k).
+*
+* @param matrix - The matrix to read.
+* @param area_id - The area.
+* @param k - The most tribes to list.
+* @param tribe_ids - Set to the listed tribes, room for k.
+* @param votes - Set to their votes, room for k.
+* @param count - Set to the number of tribes listed.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_AREA_DOES_NOT_EXIST if the area is not in the matrix.
+* 	VOTE_MATRIX_OUT_OF_MEMORY if an allocation failed.
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixGetTopTribes(VoteMatrix matrix, int area_id, int k, int* tribe_ids, long long* votes,
+                                        int* count);
+
+/**
+* voteMatrixGetTopTotals: Sets arrays to the k tribes with the most votes in all
+* the areas, as voteMatrixGetTopTribes does for an area, read off the standings
+* in O(k + log tribes), after moving the columns whose totals changed since the
+* last national query: O(log tribes) for each.
+* @return
+* 	VOTE_MATRIX_NULL_ARGUMENT if a NULL pointer was sent.
+* 	VOTE_MATRIX_SUCCESS otherwise.
+*/
+VoteMatrixResult voteMatrixGetTopTotals(VoteMatrix matrix, int k, int* tribe_ids, long long* totals, int* count);
+
+/**
+* voteMatrixGetRank: Returns the place of a tribe in an area: 1 and the number
+* of tribes with more votes there (so tied tribes share a place, and a tribe
+* without votes comes after all the tribes with votes). A dense row is read from
+* its tree, visiting only the nodes above the tribes with more votes:
+* O(rank * log tribes). A sparse row takes one pass over its tribes. -1 if a
+* NULL pointer was sent or the area is not in the matrix.
+*/
+int voteMatrixGetRank(VoteMatrix matrix, int area_id, int tribe_id);
+
+/**
+* voteMatrixGetTotalRank: Returns the place of a tribe in all the areas, as
+* voteMatrixGetRank does for an area, from the standings in O(log tribes) (and
+* O(log tribes) for each column whose total changed since the last national
+* query, as in voteMatrixGetTopTotals). -1 if a NULL pointer was sent.
+*/
+int voteMatrixGetTotalRank(VoteMatrix matrix, int tribe_id);
+
+/**
+* voteMatrixForEachWinner: Calls a function with every area and its winner: the
+* tribe with the most votes in the area, of tribes with the same votes the one
+* with the lowest id, or default_tribe if nobody voted there. O(areas).
+*
+* @return
+* 	false if a NULL pointer was sent or the function returned false.
+* 	true otherwise.
+*/
+bool voteMatrixForEachWinner(VoteMatrix matrix, int default_tribe, VoteMatrixWinnerFunction function,
+                             void* context);
+
+/**
+* voteMatrixGetAreaCount: Returns the number of areas in the matrix, -1 if a NULL pointer was sent.
+*/
+int voteMatrixGetAreaCount(VoteMatrix matrix);
+
+/**
+* voteMatrixGetWinners: Fills arrays with the areas first to first + count - 1
+* (in the order voteMatrixForEachWinner visits them) and their winners (see
+* voteMatrixForEachWinner). It only reads the matrix, so it may run on many threads
+* at once, as long as nothing changes the matrix meanwhile.
+*
+* @param matrix - The matrix to read.
+* @param first - The position of the first area, 0 to the number of areas.
+* @param count - The number of areas, up to the number of areas from first.
+* @param default_tribe - The winner of an area nobody voted in.
+* @param area_ids - Set to the areas, must hold count ints.
+* @param winners - Set to the winners of the areas, must hold count ints.
+* @return
+* 	false if a NULL pointer was sent or the range is not in the matrix.
+* 	true otherwise.
+*/
+bool voteMatrixGetWinners(VoteMatrix matrix, int first, int count, int default_tribe, int* area_ids, int* winners);
+
+/**
+* voteMatrixMemoryUsage: Returns a breakdown of the memory held by the matrix
+* (the counters are its payload) and its largest row. See mapMemoryUsage.
+* @return
+* 	All zeros (and no largest area) if a NULL pointer was sent, the breakdown otherwise.
+*/
+VoteMatrixMemoryUsage voteMatrixMemoryUsage(VoteMatrix matrix);
+
+#endif /* VOTE_MATRIX_H_ */